@@ -1178,6 +1178,73 @@ hsa_status_t HSA_API hsa_amd_svm_prefetch_async(void* ptr, size_t size, hsa_agen
   return amdExtTable->hsa_amd_svm_prefetch_async_fn(ptr, size, agent, num_dep_signals, dep_signals, completion_signal);
 }
 
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_enable(bool enable) {
+  return amdExtTable->hsa_amd_runtime_counters_enable_fn(enable);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_get(uint32_t num_counters, uint64_t* values) {
+  return amdExtTable->hsa_amd_runtime_counters_get_fn(num_counters, values);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_get_histogram(hsa_amd_runtime_histogram_t histogram,
+                                                            uint32_t num_buckets, uint64_t* buckets) {
+  return amdExtTable->hsa_amd_runtime_counters_get_histogram_fn(histogram, num_buckets, buckets);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_reset() {
+  return amdExtTable->hsa_amd_runtime_counters_reset_fn();
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_profiling_convert_ticks_to_system_domain(hsa_agent_t agent_handle, uint32_t count,
+                                                                      const uint64_t* agent_ticks, uint64_t* system_ticks) {
+  return amdExtTable->hsa_amd_profiling_convert_ticks_to_system_domain_fn(agent_handle, count, agent_ticks, system_ticks);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_queue_latency_get_histogram(const hsa_queue_t* queue, hsa_amd_queue_latency_t latency,
+                                                         uint32_t num_buckets, uint64_t* buckets) {
+  return amdExtTable->hsa_amd_queue_latency_get_histogram_fn(queue, latency, num_buckets, buckets);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_config_set(const char* name, uint64_t value) {
+  return amdExtTable->hsa_amd_runtime_config_set_fn(name, value);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_config_get(const char* name, uint64_t* value) {
+  return amdExtTable->hsa_amd_runtime_config_get_fn(name, value);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_memory_lock_cache_flush(void* host_ptr, size_t size) {
+  return amdExtTable->hsa_amd_memory_lock_cache_flush_fn(host_ptr, size);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_memory_fill_async(void* ptr, uint32_t value, size_t count,
+                                               uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
+                                               hsa_signal_t completion_signal) {
+  return amdExtTable->hsa_amd_memory_fill_async_fn(ptr, value, count, num_dep_signals, dep_signals, completion_signal);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_queue_cu_set_mask_batch(uint32_t num_queues, const hsa_queue_t* const* queues,
+                                                     uint32_t num_cu_mask_count, const uint32_t* cu_mask) {
+  return amdExtTable->hsa_amd_queue_cu_set_mask_batch_fn(num_queues, queues, num_cu_mask_count, cu_mask);
+}
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_executable_get_kernel_dispatch_info(hsa_executable_t executable, uint32_t* num_kernels,
+                                                                 hsa_amd_kernel_dispatch_info_t* kernels) {
+  return amdExtTable->hsa_amd_executable_get_kernel_dispatch_info_fn(executable, num_kernels, kernels);
+}
+
 // Tools only table interfaces.
 namespace rocr {
 
@@ -208,10 +208,16 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   /// @brief Enable use of GWS from this queue.
   hsa_status_t EnableGWS(int gws_slot_count);
 
+  /// @brief Release a ring buffer allocated by AllocRegisteredRingBuffer for agent.
+  static void FreeRingBuffer(GpuAgent* agent, void* ring_buf, uint32_t ring_buf_alloc_bytes);
+
  protected:
   bool _IsA(Queue::rtti_t id) const override { return id == &rtti_id_; }
 
  private:
+  /// @brief Returns 1 if agent's ring buffers must be double mapped, see the constructor.
+  static uint32_t QueueFullWorkaround(const GpuAgent* agent);
+
   uint32_t ComputeRingBufferMinPkts();
   uint32_t ComputeRingBufferMaxPkts();
 
@@ -219,10 +225,6 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   void AllocRegisteredRingBuffer(uint32_t queue_size_pkts);
   void FreeRegisteredRingBuffer();
 
-  /// @brief Abstracts the file handle use for double mapping queues.
-  void CloseRingBufferFD(const char* ring_buf_shm_path, int fd) const;
-  int CreateRingBufferFD(const char* ring_buf_shm_path, uint32_t ring_buf_phys_size_bytes) const;
-
   /// @brief Define the Scratch Buffer Descriptor and related parameters
   /// that enable kernel access scratch memory
   void InitScratchSRD();
@@ -289,8 +291,9 @@ class AqlQueue : public core::Queue, private core::LocalSignal, public core::Doo
   // CU mask lock
   KernelMutex mask_lock_;
 
-  // Current CU mask
-  std::vector<uint32_t> cu_mask_;
+  // Current CU mask and its length in dwords, 0 until a mask has been applied.
+  GpuAgent::CUMask cu_mask_;
+  uint32_t cu_mask_dwords_;
 
   // Shared event used for queue errors
   static HsaEvent* queue_event_;
@@ -45,6 +45,7 @@
 #ifndef HSA_RUNTIME_CORE_INC_AMD_GPU_AGENT_H_
 #define HSA_RUNTIME_CORE_INC_AMD_GPU_AGENT_H_
 
+#include <atomic>
 #include <vector>
 #include <map>
 
@@ -56,6 +57,7 @@
 #include "core/inc/signal.h"
 #include "core/inc/cache.h"
 #include "core/inc/scratch_cache.h"
+#include "core/util/bitmask.h"
 #include "core/util/small_heap.h"
 #include "core/util/locks.h"
 #include "core/util/lazy_ptr.h"
@@ -130,6 +132,14 @@ class GpuAgentInt : public core::Agent {
   // @param [out] time Timestamp in agent domain.
   virtual uint64_t TranslateTime(uint64_t tick) = 0;
 
+  // @brief Translate an array of timestamps from agent domain to host domain
+  // using a single clock calibration snapshot.
+  //
+  // @param [in] ticks Timestamps in agent domain.
+  // @param [out] system_ticks Timestamps in host domain.
+  // @param [in] count Number of entries in @p ticks and @p system_ticks.
+  virtual void TranslateTime(const uint64_t* ticks, uint64_t* system_ticks, size_t count) = 0;
+
   // @brief Invalidate caches on the agent which may hold code object data.
   virtual void InvalidateCodeCaches() = 0;
 
@@ -268,6 +278,9 @@ class GpuAgent : public GpuAgentInt {
   // @brief Override from AMD::GpuAgentInt.
   uint64_t TranslateTime(uint64_t tick) override;
 
+  // @brief Override from amd::GpuAgentInt.
+  void TranslateTime(const uint64_t* ticks, uint64_t* system_ticks, size_t count) override;
+
   // @brief Override from AMD::GpuAgentInt.
   void InvalidateCodeCaches() override;
 
@@ -326,6 +339,29 @@ class GpuAgent : public GpuAgentInt {
   // GPU devices.
   __forceinline uint32_t enumeration_index() const { return enum_index_; }
 
+  // @brief Assign the enumeration index.  Used when agents are constructed out
+  // of order and their final position is only known at registration.
+  void enumeration_index(uint32_t index) { enum_index_ = index; }
+
+  // @brief Queue CU mask with room for the largest supported CU count.
+  typedef Bitmask<1024> CUMask;
+
+  // @brief Dwords needed to cover the physical CUs.
+  uint32_t cu_mask_dwords() const { return cu_mask_dwords_; }
+
+  // @brief Mask of all physical CUs.
+  const CUMask& physical_cu_mask() const { return physical_cu_mask_; }
+
+  // @brief HSA_CU_MASK restriction for this agent, valid for global_cu_mask_dwords() dwords.
+  const CUMask& global_cu_mask() const { return global_cu_mask_; }
+
+  // @brief Length of the HSA_CU_MASK restriction in dwords, 0 when there is none.
+  uint32_t global_cu_mask_dwords() const { return global_cu_mask_dwords_; }
+
+  // @brief Precompute the physical and HSA_CU_MASK CU masks used by queues.  Must run after
+  // HSA_CU_MASK has been parsed, which needs the final enumeration of all GPUs.
+  void InitCUMask();
+
   void Trim() override;
 
   const std::function<void*(size_t size, size_t align, core::MemoryRegion::AllocateFlags flags)>&
@@ -335,6 +371,23 @@ class GpuAgent : public GpuAgentInt {
 
   const std::function<void(void*)>& system_deallocator() const { return system_deallocator_; }
 
+  // @brief Buffers of a destroyed AQL queue kept for reuse by a queue of the same size.
+  struct ParkedQueue {
+    uint32_t size_pkts;
+    void* ring_buf;
+    uint32_t ring_buf_alloc_bytes;
+    void* pm4_ib_buf;
+  };
+
+  // @brief Keep a destroyed queue's buffers.  Returns false if the pool is full or closed.
+  bool ParkQueue(const ParkedQueue& parked);
+
+  // @brief Take parked buffers for a queue of size_pkts packets.  Returns false if none match.
+  bool UnparkQueue(uint32_t size_pkts, ParkedQueue& parked);
+
+  // @brief Free all parked buffers.  A closed pool accepts no further buffers.
+  void DrainQueuePool(bool close);
+
  protected:
   static const uint32_t minAqlSize_ = 0x1000;   // 4KB min
   static const uint32_t maxAqlSize_ = 0x20000;  // 8MB max
@@ -373,9 +426,25 @@ class GpuAgent : public GpuAgentInt {
       hsa_status_t (*callback)(hsa_region_t region, void* data),
       void* data) const;
 
-  // @brief Update ::t1_ tick count.
+  // @brief Update ::t1_ tick count and publish it to the clock snapshot.
+  // Caller must hold ::t1_lock_.
   void SyncClocks();
 
+  // @brief Calibration pair published for lock free readers of ::t1_.
+  struct ClockSnapshot {
+    uint64_t gpu;
+    uint64_t system;
+  };
+
+  // @brief Read a consistent copy of the published calibration pair.
+  void LoadClockSnapshot(ClockSnapshot& clocks) const;
+
+  // @brief Translate @p tick using @p clocks without synchronizing clocks.
+  // Returns false if @p tick lies outside the error bounded extrapolation
+  // window, in which case the locked path in ::TranslateTime must be used.
+  bool TranslateTimeFast(uint64_t tick, const ClockSnapshot& clocks, int64_t max_extrapolation,
+                         uint64_t& system_tick) const;
+
   // @brief Binds the second-level trap handler to this node.
   void BindTrapHandler();
 
@@ -446,6 +515,14 @@ class GpuAgent : public GpuAgentInt {
 
   double historical_clock_ratio_;
 
+  // @brief Sequence counter guarding ::clock_gpu_ and ::clock_system_.  Odd
+  // while SyncClocks is publishing a new calibration pair.
+  std::atomic<uint32_t> clock_seq_;
+
+  // @brief Published copy of ::t1_ for lock free timestamp translation.
+  std::atomic<uint64_t> clock_gpu_;
+  std::atomic<uint64_t> clock_system_;
+
   // @brief Array of GPU cache property.
   std::vector<HsaCacheProperties> cache_props_;
 
@@ -479,6 +556,12 @@ class GpuAgent : public GpuAgentInt {
   // @brief Enumeration index
   uint32_t enum_index_;
 
+  // @brief Precomputed CU masks, see InitCUMask.
+  uint32_t cu_mask_dwords_;
+  uint32_t global_cu_mask_dwords_;
+  CUMask physical_cu_mask_;
+  CUMask global_cu_mask_;
+
   // @brief HDP flush registers
   hsa_amd_hdp_flush_t HDP_flush_ = {nullptr, nullptr};
 
@@ -490,6 +573,17 @@ class GpuAgent : public GpuAgentInt {
   // agent.
   void InitScratchPool();
 
+  // @brief Reserve the scratch pool and bind the trap handler if that was
+  // deferred from PostToolsInit (HSA_LAZY_AGENT_INIT).  Safe to call
+  // concurrently; only the first caller performs the initialization.
+  void InitDeviceState() {
+    if (device_state_ready_.load(std::memory_order_acquire)) return;
+    InitDeviceStateBody();
+  }
+
+  // @brief Separated from InitDeviceState to improve inlining.
+  void InitDeviceStateBody();
+
   // @brief Query the driver to get the cache properties.
   void InitCacheList();
 
@@ -533,6 +627,20 @@ class GpuAgent : public GpuAgentInt {
   // @brief Alternative aperture size. Only on KV.
   size_t ape1_size_;
 
+  // @brief Guards deferred scratch pool and trap handler initialization.
+  KernelMutex device_state_lock_;
+
+  // @brief Set once the scratch pool is reserved and the trap handler bound.
+  std::atomic<bool> device_state_ready_;
+
+  // @brief Protects ::queue_pool_ and ::queue_pool_closed_.
+  KernelMutex queue_pool_lock_;
+
+  // @brief Parked AQL queue buffers, most recently parked last.
+  std::vector<ParkedQueue> queue_pool_;
+
+  bool queue_pool_closed_;
+
   // @brief Queue with GWS access.
   struct {
     lazy_ptr<core::Queue> queue_;
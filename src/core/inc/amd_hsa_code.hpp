@@ -48,10 +48,13 @@
 #include "inc/amd_hsa_kernel_code.h"
 #include "inc/hsa.h"
 #include "inc/hsa_ext_finalize.h"
+#include "amd_hsa_locks.hpp"
 #include <memory>
 #include <sstream>
 #include <cassert>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
 
 namespace rocr {
 namespace amd {
@@ -360,10 +363,41 @@ namespace code {
       Section* AddHsaHlDebug(const std::string& name, const void* data, size_t size);
     };
 
+    // Registry of parsed legacy code objects. Each handle is parsed at most
+    // once even under concurrent first lookups, and handles whose ELF images
+    // are byte-identical share a single parsed AmdHsaCode. The shared image is
+    // a private copy, so it outlives any one handle's buffer; it is released
+    // when the last handle referring to it is destroyed. Lookups of parsed
+    // handles only take the reader side of handleLock.
     class AmdHsaCodeManager {
     private:
-      typedef std::unordered_map<uint64_t, AmdHsaCode*> CodeMap;
-      CodeMap codeMap;
+      struct Entry {
+        Entry() : hash(0), size(0), refs(0) {}
+        uint64_t hash;
+        size_t size;
+        size_t refs;
+        std::unique_ptr<char[]> image;
+        std::unique_ptr<AmdHsaCode> code;
+      };
+
+      struct Slot {
+        Slot() : entry(nullptr), destroyed(false) {}
+        std::mutex parseLock;  // serializes parsing of this handle
+        std::atomic<Entry*> entry;
+        bool destroyed;        // guarded by parseLock
+      };
+
+      typedef std::unordered_map<uint64_t, std::shared_ptr<Slot>> HandleMap;
+      typedef std::unordered_multimap<uint64_t, std::unique_ptr<Entry>> ContentMap;
+
+      amd::hsa::common::ReaderWriterLock handleLock;  // guards handleMap
+      HandleMap handleMap;
+      std::mutex lock;  // guards contentMap and Entry::refs
+      ContentMap contentMap;
+
+      Entry* FindContent(uint64_t hash, const void* buffer, size_t size);
+      Entry* Parse(const void* buffer);
+      void Release(Entry* entry);
 
     public:
       AmdHsaCode* FromHandle(hsa_code_object_t handle);
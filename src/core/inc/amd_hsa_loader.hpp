@@ -47,6 +47,7 @@
 #include <cstdint>
 #include "inc/hsa.h"
 #include "inc/hsa_ext_image.h"
+#include "inc/hsa_ext_amd.h"
 #include "inc/hsa_ven_amd_loader.h"
 #include "inc/amd_hsa_elf.h"
 #include <string>
@@ -176,6 +177,24 @@ public:
 
   virtual bool SegmentFreeze(amdgpu_hsa_elf_segment_t segment, hsa_agent_t agent, void* seg, size_t size) = 0;
 
+  struct SegmentFreezeRequest {
+    amdgpu_hsa_elf_segment_t segment;
+    hsa_agent_t agent;
+    void* seg;
+    size_t size;
+    bool frozen;  // Set on return.
+  };
+
+  /// @brief Freezes the segments of an executable together.  Contexts able to
+  /// overlap segment uploads override this, by default each segment is frozen
+  /// in turn.
+  virtual void SegmentsFreeze(SegmentFreezeRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      requests[i].frozen = SegmentFreeze(requests[i].segment, requests[i].agent,
+                                         requests[i].seg, requests[i].size);
+    }
+  }
+
   virtual bool ImageExtensionSupported() = 0;
 
   virtual hsa_status_t ImageCreate(
@@ -409,6 +428,10 @@ public:
     size_t total_num_segment_descriptors,
     size_t first_empty_segment_descriptor) = 0;
 
+  /// @brief same as hsa_amd_executable_get_kernel_dispatch_info.
+  virtual void GetKernelDispatchInfo(
+    uint32_t *num_kernels, hsa_amd_kernel_dispatch_info_t *kernels) = 0;
+
   virtual uint64_t FindHostAddress(uint64_t device_address) = 0;
 
   virtual void Print(std::ostream& out) = 0;
@@ -70,6 +70,8 @@ public:
 
   bool SegmentFreeze(amdgpu_hsa_elf_segment_t segment, hsa_agent_t agent, void* seg, size_t size) override;
 
+  void SegmentsFreeze(SegmentFreezeRequest* requests, size_t count) override;
+
   bool ImageExtensionSupported() override;
 
   hsa_status_t ImageCreate(hsa_agent_t agent, hsa_access_permission_t image_permission,
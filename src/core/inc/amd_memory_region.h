@@ -45,9 +45,13 @@
 #ifndef HSA_RUNTIME_CORE_INC_AMD_MEMORY_REGION_H_
 #define HSA_RUNTIME_CORE_INC_AMD_MEMORY_REGION_H_
 
+#include <atomic>
+#include <set>
+
 #include "hsakmt.h"
 
 #include "core/inc/agent.h"
+#include "core/inc/amd_pinned_memory_cache.h"
 #include "core/inc/runtime.h"
 #include "core/inc/memory_region.h"
 #include "core/util/simple_heap.h"
@@ -127,6 +131,14 @@ class MemoryRegion : public core::MemoryRegion {
 
   hsa_status_t Unlock(void* host_ptr) const;
 
+  /// @brief Set the pinned bytes budget for unlocked registrations, 0 disables
+  /// registration caching.
+  static void SetPinnedCacheBudget(size_t bytes) { pinned_cache_.budget(bytes); }
+
+  /// @brief Release cached registrations overlapping [ptr, ptr + size), or all
+  /// of them if @p ptr is null.
+  static void FlushPinnedCache(const void* ptr, size_t size) { pinned_cache_.Flush(ptr, size); }
+
   HSAuint64 GetBaseAddress() const { return mem_props_.VirtualBaseAddress; }
 
   HSAuint64 GetPhysicalSize() const { return mem_props_.SizeInBytes; }
@@ -183,8 +195,37 @@ class MemoryRegion : public core::MemoryRegion {
   // Used to collect total system memory
   static size_t max_sysmem_alloc_size_;
 
+  // Registrations made by Lock, shared by all system regions since Unlock is routed through a
+  // single region.
+  static PinnedMemoryCache pinned_cache_;
+
+  // Register and map host memory for Lock.
+  hsa_status_t PinAndMap(void* host_ptr, size_t size, const std::vector<HSAuint32>& nodes,
+                         void** agent_ptr) const;
+
   HSAuint64 virtual_size_;
 
+  // Bytes currently allocated through Allocate, and the part of them under the huge page policy.
+  mutable std::atomic<size_t> allocated_bytes_;
+  mutable std::atomic<size_t> huge_page_bytes_;
+
+  static const size_t kHugePageSize_ = 2 * 1024 * 1024;
+
+  // True if a system allocation of size bytes is advised to use huge pages.
+  bool UseHugePages(size_t size) const;
+
+  // Maps system memory on the host and applies the huge page and interleave policies while it is
+  // untouched, then registers it and maps it to GPUs.  Returns nullptr if any step fails or the
+  // GPUs would address the memory differently from the host.
+  void* AllocatePlaced(const HsaMemFlags& flags, AllocateFlags alloc_flags, size_t size,
+                       bool huge_pages, bool interleave) const;
+
+  // Releases ptr and returns true if it was allocated by AllocatePlaced.
+  bool FreePlaced(void* ptr, size_t size) const;
+
+  // Bases of allocations made by AllocatePlaced, guarded by the owner's agent_memory_lock_.
+  mutable std::set<const void*> placed_;
+
   // Protects against concurrent allow_access calls to fragments of the same block by virtue of all
   // fragments of the block routing to the same MemoryRegion.
   mutable KernelMutex access_lock_;
@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_AMD_PINNED_MEMORY_CACHE_H_
+#define HSA_RUNTIME_CORE_INC_AMD_PINNED_MEMORY_CACHE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "core/util/locks.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+
+/// @brief Reference counted cache of host memory registrations made by
+/// hsa_amd_memory_lock.
+///
+/// A lock is served by any live registration of the same owner which covers
+/// the requested byte range and is mapped to a superset of the requested GPU
+/// nodes.  Unlocked registrations stay pinned on an LRU list until the idle
+/// pinned bytes exceed the budget, or until they are flushed.  Callers must
+/// flush a range before the memory is unmapped or freed.
+///
+/// The thunk is reached only through the register and deregister callbacks.
+class PinnedMemoryCache {
+ public:
+  /// @brief Register and map [ptr, ptr + size) to @p nodes with the flags of
+  /// @p owner.  Returns the agent address of @p ptr, or nullptr on failure.
+  typedef std::function<void*(const void* owner, void* ptr, size_t size,
+                              const std::vector<uint32_t>& nodes)>
+      RegisterFn;
+
+  /// @brief Unmap and deregister a registration made at @p ptr.
+  typedef std::function<void(void* ptr)> DeregisterFn;
+
+  PinnedMemoryCache(RegisterFn do_register, DeregisterFn do_deregister)
+      : register_(do_register), deregister_(do_deregister), budget_(0), idle_bytes_(0),
+        max_span_(0) {}
+
+  // Registrations are not released here, the thunk may already be closed.  Flush before
+  // closing the kernel driver.
+  ~PinnedMemoryCache() {}
+
+  /// @brief Bytes of unlocked registrations kept pinned.  0 disables the cache.
+  void budget(size_t bytes);
+  size_t budget() const { return budget_; }
+
+  bool enabled() const { return budget_ != 0; }
+
+  /// @brief Lock [host_ptr, host_ptr + size) for @p nodes, which must be
+  /// sorted.  Returns nullptr if registration failed.
+  void* Lock(const void* owner, void* host_ptr, size_t size, const std::vector<uint32_t>& nodes);
+
+  /// @brief Drop one lock of @p host_ptr.  Returns false if @p host_ptr was
+  /// not locked through the cache.
+  bool Unlock(void* host_ptr);
+
+  /// @brief Deregister unlocked registrations overlapping the pages of
+  /// [ptr, ptr + size).  A null @p ptr flushes every unlocked registration.
+  void Flush(const void* ptr, size_t size);
+
+ private:
+  struct Entry {
+    const void* owner;
+    void* host_ptr;
+    size_t size;
+    std::vector<uint32_t> nodes;
+    void* agent_ptr;
+    uint32_t refcount;
+    std::list<Entry*>::iterator lru;
+  };
+
+  typedef std::multimap<uintptr_t, Entry*> EntryMap;
+
+  Entry* Find(const void* owner, uintptr_t begin, uintptr_t end,
+              const std::vector<uint32_t>& nodes);
+
+  // Deregister idle entries overlapping the pages of [begin, end).
+  void FlushRange(uintptr_t begin, uintptr_t end);
+
+  void Evict(EntryMap::iterator it);
+
+  void Trim();
+
+  RegisterFn register_;
+  DeregisterFn deregister_;
+
+  KernelMutex lock_;
+
+  // Live registrations keyed by start address.
+  EntryMap entries_;
+
+  // Registration backing each outstanding lock, keyed by the locked address.
+  std::multimap<void*, Entry*> locks_;
+
+  // Unlocked registrations, most recently used first.
+  std::list<Entry*> idle_;
+
+  size_t budget_;
+  size_t idle_bytes_;
+
+  // Largest registration size, bounds the backwards interval search.
+  size_t max_span_;
+
+  DISALLOW_COPY_AND_ASSIGN(PinnedMemoryCache);
+};
+
+}  // namespace AMD
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_AMD_PINNED_MEMORY_CACHE_H_
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Built-in binary API tracing.  When enabled the runtime's core and AMD
+// extension API tables are patched with thin wrappers which record each call
+// into a per-thread ring buffer.  A background thread drains the buffers to a
+// file.  When disabled the API tables are not modified.
+
+#ifndef HSA_RUNTIME_CORE_INC_HSA_API_TRACE_BUFFER_H_
+#define HSA_RUNTIME_CORE_INC_HSA_API_TRACE_BUFFER_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "core/inc/hsa_api_trace_int.h"
+
+namespace rocr {
+namespace core {
+
+// Trace file layout, all fields little endian:
+//   ApiTraceHeader
+//   api_count name entries: uint32_t id, uint32_t length, char name[length]
+//   ApiTraceRecord stream until end of file
+struct ApiTraceHeader {
+  char magic[8];               // "HSATRACE"
+  uint32_t version;            // kApiTraceVersion
+  uint32_t api_count;          // Number of name entries which follow.
+  uint64_t timestamp_frequency;  // Timestamp ticks per second.
+};
+
+static const uint32_t kApiTraceVersion = 1;
+
+struct ApiTraceRecord {
+  uint32_t api_id;     // Core APIs are numbered from 0 in CoreApiTable order, AMD extension APIs
+                       // follow in AmdExtTable order.
+  uint32_t thread_id;  // Sequential id of the calling thread.
+  uint64_t start;      // Timestamps on entry and exit.
+  uint64_t end;
+  uint64_t arg;        // Raw bits of the first argument.
+  uint64_t ret;        // Raw bits of the return value, 0 for void APIs.
+};
+
+// Install tracing wrappers into table and start writing records to path.  Returns false if
+// path could not be opened, leaving table unmodified.
+bool StartApiTrace(const std::string& path, HsaApiTable& table);
+
+// Stop the writer thread and flush all buffered records.  The caller is responsible for
+// restoring the API table.
+void StopApiTrace();
+
+}  // namespace core
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_HSA_API_TRACE_BUFFER_H_
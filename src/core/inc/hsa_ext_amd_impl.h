@@ -265,6 +265,49 @@ hsa_status_t HSA_API hsa_amd_svm_prefetch_async(void* ptr, size_t size, hsa_agen
                                         uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
                                         hsa_signal_t completion_signal);
 
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_enable(bool enable);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_get(uint32_t num_counters, uint64_t* values);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_get_histogram(hsa_amd_runtime_histogram_t histogram,
+                                                            uint32_t num_buckets, uint64_t* buckets);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_counters_reset();
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_profiling_convert_ticks_to_system_domain(hsa_agent_t agent_handle, uint32_t count,
+                                                                      const uint64_t* agent_ticks, uint64_t* system_ticks);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_queue_latency_get_histogram(const hsa_queue_t* queue, hsa_amd_queue_latency_t latency,
+                                                         uint32_t num_buckets, uint64_t* buckets);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_config_set(const char* name, uint64_t value);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_runtime_config_get(const char* name, uint64_t* value);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_memory_lock_cache_flush(void* host_ptr, size_t size);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_memory_fill_async(void* ptr, uint32_t value, size_t count,
+                                               uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
+                                               hsa_signal_t completion_signal);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_queue_cu_set_mask_batch(uint32_t num_queues, const hsa_queue_t* const* queues,
+                                                     uint32_t num_cu_mask_count, const uint32_t* cu_mask);
+
+// Mirrors Amd Extension Apis
+hsa_status_t HSA_API hsa_amd_executable_get_kernel_dispatch_info(hsa_executable_t executable, uint32_t* num_kernels,
+                                                                 hsa_amd_kernel_dispatch_info_t* kernels);
+
 }  // namespace amd
 }  // namespace rocr
 
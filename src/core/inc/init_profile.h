@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_INIT_PROFILE_H_
+#define HSA_RUNTIME_CORE_INC_INIT_PROFILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "core/util/timer.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace core {
+
+/// @brief Phase timing of runtime initialization.
+///
+/// Phases are scoped objects placed along the hsa_init path.  They cost a
+/// relaxed load unless profiling was started by Runtime::Load, which happens
+/// when HSA_INIT_TIMING=1 (report to stderr) or HSA_INIT_PROFILE_FILE is set
+/// (one JSON line appended per hsa_init).
+class InitProfile {
+ public:
+  class Phase {
+   public:
+    /// @brief Time a phase.  @p node tags per agent phases with the agent's
+    /// node id.  Phases nest under the enclosing phase of the same thread,
+    /// or under @p parent, which is needed for phases run on worker threads.
+    explicit Phase(const char* name, int32_t node = -1, const Phase* parent = nullptr);
+    ~Phase() { End(); }
+
+    /// @brief Close the phase before the end of its scope.
+    void End();
+
+   private:
+    const char* name_;
+    int32_t node_;
+    uint32_t depth_;
+    uint32_t saved_depth_;
+    bool active_;
+    timer::fast_clock::time_point start_;
+
+    DISALLOW_COPY_AND_ASSIGN(Phase);
+  };
+
+  /// @brief Begin collecting phases.  The report goes to stderr if
+  /// @p report_stderr and is appended to @p path if not empty.
+  static void Start(bool report_stderr, const std::string& path);
+
+  /// @brief Stop collecting and write the report.
+  static void Finish();
+};
+
+}  // namespace core
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_INIT_PROFILE_H_
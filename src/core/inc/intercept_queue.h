@@ -51,6 +51,7 @@
 #include "core/inc/queue.h"
 #include "core/inc/signal.h"
 #include "core/inc/interrupt_signal.h"
+#include "core/inc/queue_latency.h"
 #include "core/inc/exceptions.h"
 #include "core/util/locks.h"
 
@@ -205,6 +206,18 @@ class InterceptQueue : public QueueProxy, private LocalSignal, public DoorbellSi
     return wrapped->Inactivate();
   }
 
+  // @brief Start collecting dispatch latency histograms for this queue.
+  // Enables profiling on the underlying queue.
+  void EnableLatencyStats(AMD::GpuAgentInt* agent) {
+    assert(latency_stats_ == nullptr && "Queue latency stats already enabled.");
+    wrapped->SetProfiling(true);
+    latency_stats_.reset(new QueueLatencyStats(agent));
+    AddInterceptor(QueueLatencyStats::Intercept, latency_stats_.get());
+  }
+
+  // @brief Dispatch latency histograms, nullptr unless EnableLatencyStats was called.
+  const QueueLatencyStats* latency_stats() const { return latency_stats_.get(); }
+
  private:
   // Serialize packet interception processing.
   KernelMutex lock_;
@@ -228,6 +241,9 @@ class InterceptQueue : public QueueProxy, private LocalSignal, public DoorbellSi
   // Proxy packet buffer
   SharedArray<AqlPacket, 4096> buffer_;
 
+  // Dispatch latency histograms, shared with in flight dispatches.
+  std::shared_ptr<QueueLatencyStats> latency_stats_;
+
   // Packet transform callbacks
   std::vector<std::pair<AMD::callback_t<hsa_amd_queue_intercept_handler>, void*>> interceptors;
 
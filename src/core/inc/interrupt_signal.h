@@ -45,6 +45,7 @@
 #ifndef HSA_RUNTME_CORE_INC_INTERRUPT_SIGNAL_H_
 #define HSA_RUNTME_CORE_INC_INTERRUPT_SIGNAL_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -73,21 +74,47 @@ class InterruptSignal : private LocalSignal, public Signal {
     };
     using unique_event_ptr = ::std::unique_ptr<HsaEvent, Deleter>;
 
-    EventPool() : allEventsAllocated(false) {}
+    EventPool()
+        : allEventsAllocated(false), next_shared_(0), live_(0), peak_(0) {}
+
+    /// @brief Returns a dedicated event if one can be obtained, otherwise one of the shared
+    /// events.  shared is set when the returned event is multiplexed between signals.
+    HsaEvent* alloc(bool& shared);
+    void free(HsaEvent* evt, bool shared);
+
+    /// @brief Creates the shared fallback events and pre-creates up to count dedicated events
+    /// so that signal creation does not need to enter the driver.
+    void reserve(uint32_t count);
 
-    HsaEvent* alloc();
-    void free(HsaEvent* evt);
     void clear() {
+      ScopedAcquire<KernelMutex> lock(&lock_);
       events_.clear();
+      shared_events_.clear();
       allEventsAllocated = false;
+      next_shared_ = 0;
+      live_ = 0;
+      peak_ = 0;
     }
 
    private:
+    /// @brief Number of events signals are spread across once dedicated events run out.
+    static const uint32_t kSharedEvents = 4;
+
     KernelMutex lock_;
     std::vector<unique_event_ptr> events_;
+    std::vector<unique_event_ptr> shared_events_;
     bool allEventsAllocated;
+    uint32_t next_shared_;
+    /// @brief Dedicated events held by signals and their high water mark.  Reported through the
+    /// InterruptEvent runtime counters.
+    size_t live_;
+    size_t peak_;
   };
 
+  /// @brief Upper bound on a single sleep on a shared event.  A wake up for one signal may be
+  /// consumed by a waiter of another signal on the same event so waiters recheck their value.
+  static const uint32_t kSharedEventWaitMs = 1;
+
   static HsaEvent* CreateEvent(HSA_EVENTTYPE type, bool manual_reset);
   static void DestroyEvent(HsaEvent* evt);
 
@@ -190,6 +217,9 @@ class InterruptSignal : private LocalSignal, public Signal {
   /// @brief See base class Signal.
   __forceinline HsaEvent* EopEvent() { return event_; }
 
+  /// @brief True if event_ is multiplexed with other signals.
+  bool SharedEvent() const { return shared_event_; }
+
  protected:
   bool _IsA(rtti_t id) const { return id == &rtti_id_; }
 
@@ -201,6 +231,9 @@ class InterruptSignal : private LocalSignal, public Signal {
   /// closes or not.
   bool free_event_;
 
+  /// @variable Indicates event_ is one of the event pool's shared events.
+  bool shared_event_;
+
   /// Used to obtain a globally unique value (address) for rtti.
   static int rtti_id_;
 
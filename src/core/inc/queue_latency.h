@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_QUEUE_LATENCY_H_
+#define HSA_RUNTIME_CORE_INC_QUEUE_LATENCY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "inc/hsa.h"
+#include "inc/hsa_api_trace.h"
+#include "core/util/counters.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace AMD {
+class GpuAgentInt;
+}  // namespace AMD
+
+namespace core {
+
+class Signal;
+
+/// @brief Per queue histograms of kernel dispatch latency.
+///
+/// Installed as a packet interceptor on an InterceptQueue.  Each kernel
+/// dispatch is redirected to an internal completion signal whose async
+/// handler harvests the dispatch timestamps, records the latencies and then
+/// forwards timestamps and completion to the application's signal.  The
+/// underlying queue must have profiling enabled.
+class QueueLatencyStats : public std::enable_shared_from_this<QueueLatencyStats> {
+ public:
+  /// @brief Order must match hsa_amd_queue_latency_t.
+  enum Latency : uint32_t {
+    SubmitToStart,  // Host doorbell ring to kernel start.
+    StartToEnd,     // Kernel start to kernel end.
+    LatencyCount
+  };
+
+  explicit QueueLatencyStats(AMD::GpuAgentInt* agent);
+
+  /// @brief Packet interceptor, @p data is the QueueLatencyStats.
+  static void Intercept(const void* pkts, uint64_t pkt_count, uint64_t user_pkt_index, void* data,
+                        hsa_amd_queue_intercept_packet_writer writer);
+
+  /// @brief Copies min(num_buckets, counters::kHistogramBuckets) nanosecond
+  /// buckets of histogram @p id.
+  void Read(Latency id, uint32_t num_buckets, uint64_t* buckets) const;
+
+ private:
+  struct Dispatch {
+    std::shared_ptr<QueueLatencyStats> stats;
+    hsa_signal_t signal;
+    Signal* completion;
+    uint64_t submit;
+  };
+
+  /// @brief Returns the completion signal to submit in place of @p completion.
+  hsa_signal_t Track(hsa_signal_t completion, uint64_t submit);
+
+  static bool HandleCompletion(hsa_signal_value_t value, void* arg);
+
+  /// @brief Current host time in system timestamp domain ticks.
+  uint64_t Now() const;
+
+  void Record(Latency id, uint64_t ticks) {
+    uint64_t ns = uint64_t(double(ticks) * ticks_to_ns_);
+    histograms_[id][counters::HistogramBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  AMD::GpuAgentInt* agent_;
+
+  // Host accurate clock to system timestamp domain conversion.
+  double host_to_system_;
+  int64_t host_offset_;
+
+  // System timestamp domain ticks to nanoseconds.
+  double ticks_to_ns_;
+
+  std::atomic<uint64_t> histograms_[LatencyCount][counters::kHistogramBuckets];
+
+  DISALLOW_COPY_AND_ASSIGN(QueueLatencyStats);
+};
+
+}  // namespace core
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_QUEUE_LATENCY_H_
@@ -60,6 +60,7 @@
 #include "core/inc/memory_region.h"
 #include "core/inc/signal.h"
 #include "core/inc/interrupt_signal.h"
+#include "core/inc/timeline.h"
 #include "core/util/flag.h"
 #include "core/util/locks.h"
 #include "core/util/os.h"
@@ -235,6 +236,24 @@ class Runtime {
   /// @retval ::HSA_STATUS_SUCCESS if memory fill is successful and completed.
   hsa_status_t FillMemory(void* ptr, uint32_t value, size_t count);
 
+  /// @brief Fill the first @p count of uint32_t in ptr with value once all dependency signals
+  /// reach zero, then decrement @p completion_signal.
+  ///
+  /// The range is validated before returning.  The fill itself runs on a worker thread, and a
+  /// failure sets @p completion_signal to a negative value.
+  ///
+  /// @param [in] ptr Memory address to be filled.
+  /// @param [in] value The value/pattern that will be used to set @p ptr.
+  /// @param [in] count Number of uint32_t element to be set.
+  /// @param [in] num_dep_signals Number of dependency signals.
+  /// @param [in] dep_signals Signals which must reach zero before the fill starts.
+  /// @param [in] completion_signal Signal decremented after the fill, may have a zero handle.
+  ///
+  /// @retval ::HSA_STATUS_SUCCESS if the fill was scheduled.
+  /// @retval ::HSA_STATUS_ERROR_INVALID_ALLOCATION if the range is not within one allocation.
+  hsa_status_t FillMemoryAsync(void* ptr, uint32_t value, size_t count, uint32_t num_dep_signals,
+                               const hsa_signal_t* dep_signals, hsa_signal_t completion_signal);
+
   /// @brief Set agents as the whitelist to access ptr.
   ///
   /// @param [in] num_agents The number of agent handles in @p agents array.
@@ -306,6 +325,16 @@ class Runtime {
   hsa_status_t SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent, uint32_t num_dep_signals,
                            const hsa_signal_t* dep_signals, hsa_signal_t completion_signal);
 
+  // A page range destined for one node.
+  struct PrefetchSpan {
+    uintptr_t base;
+    size_t bytes;
+    uint32_t node_id;
+  };
+
+  // Sorts spans and merges adjacent or overlapping spans to the same node.
+  static void CoalescePrefetchSpans(std::vector<PrefetchSpan>& spans);
+
   const std::vector<Agent*>& cpu_agents() { return cpu_agents_; }
 
   const std::vector<Agent*>& gpu_agents() { return gpu_agents_; }
@@ -339,6 +368,14 @@ class Runtime {
 
   const Flag& flag() const { return flag_; }
 
+  /// @brief True while the copy and fill timeline is being collected.
+  bool timeline_enabled() const { return timeline_.enabled(); }
+
+  /// @brief Update a runtime adjustable flag, see Flag::SetTunable.
+  hsa_status_t SetTunable(const std::string& name, uint64_t value) {
+    return flag_.SetTunable(name, value);
+  }
+
   ExtensionEntryPoints extensions_;
 
   hsa_status_t SetCustomSystemEventHandler(hsa_amd_system_event_callback_t callback,
@@ -366,23 +403,78 @@ class Runtime {
  protected:
   static void AsyncEventsLoop(void*);
 
+  // Issues an asynchronous copy, see CopyMemory.
+  hsa_status_t IssueCopy(void* dst, core::Agent& dst_agent, const void* src,
+                         core::Agent& src_agent, size_t size,
+                         std::vector<core::Signal*>& dep_signals,
+                         core::Signal& completion_signal);
+
+  // Records a completed timeline copy and forwards completion to the caller's signal.
+  static bool TimelineCopyHandler(hsa_signal_value_t value, void* arg);
+
   struct AllocationRegion {
     AllocationRegion() : region(NULL), size(0), user_ptr(nullptr) {}
     AllocationRegion(const MemoryRegion* region_arg, size_t size_arg)
         : region(region_arg), size(size_arg), user_ptr(nullptr) {}
 
-    struct notifier_t {
-      void* ptr;
-      AMD::callback_t<hsa_amd_deallocation_callback_t> callback;
-      void* user_data;
-    };
-
     const MemoryRegion* region;
     size_t size;
     void* user_ptr;
-    std::unique_ptr<std::vector<notifier_t>> notifiers;
   };
 
+  struct ReleaseNotifier {
+    void* ptr;
+    AMD::callback_t<hsa_amd_deallocation_callback_t> callback;
+    void* user_data;
+  };
+
+  // Deallocation notifiers of the allocations whose base hashes to this shard.
+  struct NotifierShard {
+    KernelMutex lock;
+    std::map<const void*, std::vector<ReleaseNotifier>> notifiers;
+  };
+
+  static const size_t kNotifierShards = 16;
+
+  NotifierShard& notifier_shard(const void* base) {
+    return notifier_shards_[(uintptr_t(base) >> 12) % kNotifierShards];
+  }
+
+  // Returns the base of the region allocation containing ptr, nullptr if there is none.
+  // memory_lock_ must be held.
+  const void* FindAllocationBase(const void* ptr) const;
+
+  // Identifies an IPC import: the exporter's handle without fragment bits and
+  // the sorted GPU node set it is mapped to.
+  struct IPCImportKey {
+    uint32_t handle[8];
+    std::vector<HSAuint32> nodes;
+
+    bool operator<(const IPCImportKey& rhs) const {
+      int cmp = memcmp(handle, rhs.handle, sizeof(handle));
+      if (cmp != 0) return cmp < 0;
+      return nodes < rhs.nodes;
+    }
+  };
+
+  struct IPCImport {
+    void* address;
+    HSAuint64 size;
+    uint32_t ref_count;
+  };
+
+  typedef std::map<IPCImportKey, IPCImport> ipc_import_map_t;
+
+  // An address returned by IPCAttach.  Fragments of one import share the import.
+  struct IPCMapping {
+    ipc_import_map_t::iterator import;
+    uint32_t ref_count;
+    bool fragment;
+  };
+
+  // Import and map a handle which is not in ::ipc_imports_.
+  hsa_status_t IPCImportHandle(const IPCImportKey& key, IPCImport& import);
+
   struct AsyncEventsControl {
     AsyncEventsControl() : async_events_thread_(NULL) {}
     void Shutdown();
@@ -420,7 +512,6 @@ class Runtime {
     void* base;
     size_t size;
     uint32_t node_id;
-    int remaining_deps;
     hsa_signal_t completion;
     std::vector<hsa_signal_t> dep_signals;
     prefetch_map_t::iterator prefetch_map_entry;
@@ -435,6 +526,42 @@ class Runtime {
     prefetch_map_t::iterator next;
   };
 
+  // Async handler advancing through a prefetch's dependency signals.
+  static bool PrefetchDepsHandler(hsa_signal_value_t value, void* arg);
+
+  // Picks the GPU which fills [ptr, ptr + count * 4), or nullptr when the host fills it.
+  hsa_status_t FillAgent(void* ptr, size_t count, core::Agent*& fill_agent);
+
+  // Fills with the agent chosen by FillAgent.
+  hsa_status_t IssueFill(core::Agent* fill_agent, void* ptr, uint32_t value, size_t count);
+
+  struct FillOp {
+    core::Agent* agent;
+    void* ptr;
+    uint32_t value;
+    size_t count;
+    hsa_signal_t completion;
+    std::vector<hsa_signal_t> dep_signals;
+  };
+
+  // Async handler advancing through a fill's dependency signals.
+  static bool FillDepsHandler(hsa_signal_value_t value, void* arg);
+
+  // Pops satisfied signals off the back of deps.  Returns true once deps is empty, otherwise
+  // registers handler on the first unsatisfied signal and returns false.
+  bool AwaitDependencies(std::vector<hsa_signal_t>& deps, hsa_amd_signal_handler handler,
+                         void* arg);
+
+  // Queue a prefetch whose dependencies are satisfied.  The first op queued posts a drain to the
+  // async events thread, so prefetches released in the same pass are issued together.
+  hsa_status_t IssuePrefetch(PrefetchOp* op);
+
+  // Async function issuing every queued prefetch.
+  static void DrainPrefetches(void* unused);
+
+  // Unlink a prefetch's ranges from ::prefetch_map_.  prefetch_lock_ must be held.
+  void RemovePrefetchRanges(PrefetchOp* op);
+
   // Will be created before any user could call hsa_init but also could be
   // destroyed before incorrectly written programs call hsa_shutdown.
   static KernelMutex bootstrap_lock_;
@@ -532,10 +659,30 @@ class Runtime {
   // Contains the region, address, and size of previously allocated memory.
   std::map<const void*, AllocationRegion> allocation_map_;
 
+  // Deallocation notifiers keyed by allocation base.  Shard locks nest inside memory_lock_, which
+  // registration only takes shared.
+  NotifierShard notifier_shards_[kNotifierShards];
+
+  // Serializes IPC attach and detach, protects ::ipc_imports_, ::ipc_mappings_ and
+  // ::ipc_page_size_.
+  KernelMutex ipc_lock_;
+
+  // Live IPC imports.  Repeated attaches of the same handle to the same agents share one import.
+  ipc_import_map_t ipc_imports_;
+
+  // Outstanding IPCAttach results by returned address.
+  std::map<const void*, IPCMapping> ipc_mappings_;
+
+  // Handles which could only be mapped with 4KB pages, so later imports skip the 64KB attempt.
+  std::map<IPCImportKey, HSA_PAGE_SIZE> ipc_page_size_;
+
   // Pending prefetch containers.
   KernelMutex prefetch_lock_;
   prefetch_map_t prefetch_map_;
 
+  // Prefetches with satisfied dependencies, issued together by one posted drain.
+  std::vector<PrefetchOp*> prefetch_ready_;
+
   // Allocator using ::system_region_
   std::function<void*(size_t size, size_t align, MemoryRegion::AllocateFlags flags)> system_allocator_;
 
@@ -551,6 +698,9 @@ class Runtime {
 
   AsyncEvents new_async_events_;
 
+  // Copy and fill timeline, enabled by HSA_TIMELINE_FILE.
+  Timeline timeline_;
+
   // System clock frequency.
   uint64_t sys_clock_freq_;
 
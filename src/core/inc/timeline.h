@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_INC_TIMELINE_H_
+#define HSA_RUNTIME_CORE_INC_TIMELINE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+
+#include "core/util/locks.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace core {
+
+/// @brief Writes completed runtime operations (copies and fills) as Chrome
+/// trace events, viewable in chrome://tracing or the Perfetto UI.  Events are
+/// written to the file as they are recorded.
+class Timeline {
+ public:
+  Timeline() : file_(nullptr), enabled_(false), timestamp_frequency_(1) {}
+
+  ~Timeline() { Stop(); }
+
+  /// @brief Open @p path and start accepting events.  Timestamps passed to
+  /// Record are system domain ticks at @p timestamp_frequency Hz.
+  bool Start(const std::string& path, uint64_t timestamp_frequency);
+
+  /// @brief Terminate the trace and close the file.
+  void Stop();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /// @brief Record a completed operation.  @p track groups events in the
+  /// viewer, the runtime uses the node id of the agent which executed the
+  /// operation.
+  void Record(const char* name, uint64_t start, uint64_t end, uint32_t track, size_t size,
+              const void* dst, const void* src);
+
+ private:
+  KernelMutex lock_;
+  FILE* file_;
+  std::atomic<bool> enabled_;
+  uint64_t timestamp_frequency_;
+
+  DISALLOW_COPY_AND_ASSIGN(Timeline);
+};
+
+}  // namespace core
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_INC_TIMELINE_H_
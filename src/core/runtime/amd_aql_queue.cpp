@@ -42,14 +42,6 @@
 
 #include "core/inc/amd_aql_queue.h"
 
-#ifdef __linux__
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/syscall.h>
-#include <unistd.h>
-#endif
-
 #ifdef _WIN32
 #include <Windows.h>
 #endif
@@ -73,6 +65,9 @@ namespace AMD {
 // Queue::amd_queue_ is cache-aligned for performance.
 const uint32_t kAmdQueueAlignBytes = 0x40;
 
+// Double mapped rings at least this large are backed by huge pages when available.
+const uint32_t kRingBufHugePageBytes = 2 * 1024 * 1024;
+
 HsaEvent* AqlQueue::queue_event_ = nullptr;
 std::atomic<uint32_t> AqlQueue::queue_count_(0);
 KernelMutex AqlQueue::queue_lock_;
@@ -98,18 +93,15 @@ AqlQueue::AqlQueue(GpuAgent* agent, size_t req_size_pkts, HSAuint32 node_id, Scr
       exceptionState(0),
       suspended_(false),
       priority_(HSA_QUEUE_PRIORITY_NORMAL),
-      exception_signal_(nullptr) {
+      exception_signal_(nullptr),
+      cu_mask_dwords_(0) {
   // When queue_full_workaround_ is set to 1, the ring buffer is internally
   // doubled in size. Virtual addresses in the upper half of the ring allocation
   // are mapped to the same set of pages backing the lower half.
   // Values written to the HW doorbell are modulo the doubled size.
   // This allows the HW to accept (doorbell == last_doorbell + queue_size).
   // This workaround is required for GFXIP 7 and GFXIP 8 ASICs.
-  const core::Isa* isa = agent_->isa();
-  queue_full_workaround_ =
-      (isa->GetMajorVersion() == 7 || isa->GetMajorVersion() == 8)
-          ? 1
-          : 0;
+  queue_full_workaround_ = QueueFullWorkaround(agent_);
 
   // Identify doorbell semantics for this agent.
   doorbell_type_ = agent->properties().Capability.ui32.DoorbellType;
@@ -128,10 +120,21 @@ AqlQueue::AqlQueue(GpuAgent* agent, size_t req_size_pkts, HSAuint32 node_id, Scr
     throw AMD::hsa_exception(HSA_STATUS_ERROR_INVALID_QUEUE_CREATION,
                              "Requested queue with non-power of two packet capacity.\n");
 
-  // Allocate the AQL packet ring buffer.
-  AllocRegisteredRingBuffer(queue_size_pkts);
-  if (ring_buf_ == nullptr) throw std::bad_alloc();
-  MAKE_NAMED_SCOPE_GUARD(RingGuard, [&]() { FreeRegisteredRingBuffer(); });
+  // Reuse the ring buffer and PM4 IB of a destroyed queue of the same size, else allocate the AQL
+  // packet ring buffer.
+  GpuAgent::ParkedQueue parked;
+  if (agent_->UnparkQueue(queue_size_pkts, parked)) {
+    ring_buf_ = parked.ring_buf;
+    ring_buf_alloc_bytes_ = parked.ring_buf_alloc_bytes;
+    pm4_ib_buf_ = parked.pm4_ib_buf;
+  } else {
+    AllocRegisteredRingBuffer(queue_size_pkts);
+    if (ring_buf_ == nullptr) throw std::bad_alloc();
+  }
+  MAKE_NAMED_SCOPE_GUARD(RingGuard, [&]() {
+    FreeRegisteredRingBuffer();
+    if (pm4_ib_buf_ != nullptr) agent_->system_deallocator()(pm4_ib_buf_);
+  });
 
   // Fill the ring buffer with invalid packet headers.
   // Leave packet content uninitialized to help track errors.
@@ -305,19 +308,18 @@ AqlQueue::AqlQueue(GpuAgent* agent, size_t req_size_pkts, HSAuint32 node_id, Scr
   }
 
   // Allocate IB for icache flushes.
-  pm4_ib_buf_ =
-      agent_->system_allocator()(pm4_ib_size_b_, 0x1000, core::MemoryRegion::AllocateExecutable);
-  if (pm4_ib_buf_ == nullptr)
-    throw AMD::hsa_exception(HSA_STATUS_ERROR_OUT_OF_RESOURCES, "PM4 IB allocation failed.\n");
-
-  MAKE_NAMED_SCOPE_GUARD(PM4IBGuard, [&]() { agent_->system_deallocator()(pm4_ib_buf_); });
+  if (pm4_ib_buf_ == nullptr) {
+    pm4_ib_buf_ =
+        agent_->system_allocator()(pm4_ib_size_b_, 0x1000, core::MemoryRegion::AllocateExecutable);
+    if (pm4_ib_buf_ == nullptr)
+      throw AMD::hsa_exception(HSA_STATUS_ERROR_OUT_OF_RESOURCES, "PM4 IB allocation failed.\n");
+  }
 
   // Set initial CU mask
   if (!core::Runtime::runtime_singleton_->flag().cu_mask_skip_init()) SetCUMasking(0, nullptr);
 
   active_ = true;
 
-  PM4IBGuard.Dismiss();
   RingGuard.Dismiss();
   QueueGuard.Dismiss();
   EventGuard.Dismiss();
@@ -343,7 +345,6 @@ AqlQueue::~AqlQueue() {
 
   Inactivate();
   agent_->ReleaseQueueScratch(queue_scratch_);
-  FreeRegisteredRingBuffer();
   exception_signal_->DestroySignal();
   HSA::hsa_signal_destroy(amd_queue_.queue_inactive_signal);
   if (core::g_use_interrupt_wait) {
@@ -354,7 +355,14 @@ AqlQueue::~AqlQueue() {
       queue_event_ = nullptr;
     }
   }
-  agent_->system_deallocator()(pm4_ib_buf_);
+
+  // The KFD queue is gone, so the ring buffer and IB can be handed to a later queue.
+  GpuAgent::ParkedQueue parked = {amd_queue_.hsa_queue.size, ring_buf_, ring_buf_alloc_bytes_,
+                                  pm4_ib_buf_};
+  if (!agent_->ParkQueue(parked)) {
+    FreeRegisteredRingBuffer();
+    agent_->system_deallocator()(pm4_ib_buf_);
+  }
 }
 
 void AqlQueue::Destroy() {
@@ -545,130 +553,12 @@ void AqlQueue::AllocRegisteredRingBuffer(uint32_t queue_size_pkts) {
     // Compute the physical and virtual size of the queue.
     uint32_t ring_buf_phys_size_bytes =
         uint32_t(queue_size_pkts * sizeof(core::AqlPacket));
-    ring_buf_alloc_bytes_ = 2 * ring_buf_phys_size_bytes;
-
-#ifdef __linux__
-    // Create a system-unique shared memory path for this thread.
-    char ring_buf_shm_path[16];
-    pid_t sys_unique_tid = pid_t(syscall(__NR_gettid));
-    sprintf(ring_buf_shm_path, "/%u", sys_unique_tid);
-
-    int ring_buf_shm_fd = -1;
-    void* reserve_va = NULL;
-
-    ring_buf_shm_fd = CreateRingBufferFD(ring_buf_shm_path, ring_buf_phys_size_bytes);
-
-    if (ring_buf_shm_fd == -1) {
-      return;
-    }
-
-    // Reserve a VA range twice the size of the physical backing store.
-    reserve_va = mmap(NULL, ring_buf_alloc_bytes_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    assert(reserve_va != MAP_FAILED && "mmap failed");
-
-    // Remap the lower and upper halves of the VA range.
-    // Map both halves to the shared memory backing store.
-    // If the GPU device is KV, do not set PROT_EXEC flag.
-    void* ring_buf_lower_half = NULL;
-    void* ring_buf_upper_half = NULL;
-    if (is_kv_queue_) {
-      ring_buf_lower_half = mmap(reserve_va, ring_buf_phys_size_bytes, PROT_READ | PROT_WRITE,
-                                 MAP_SHARED | MAP_FIXED, ring_buf_shm_fd, 0);
-      assert(ring_buf_lower_half != MAP_FAILED && "mmap failed");
-
-      ring_buf_upper_half =
-          mmap((void*)(uintptr_t(reserve_va) + ring_buf_phys_size_bytes), ring_buf_phys_size_bytes,
-               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, ring_buf_shm_fd, 0);
-      assert(ring_buf_upper_half != MAP_FAILED && "mmap failed");
-      } else {
-        ring_buf_lower_half = mmap(reserve_va, ring_buf_phys_size_bytes,
-                                   PROT_READ | PROT_WRITE | PROT_EXEC,
-                                   MAP_SHARED | MAP_FIXED, ring_buf_shm_fd, 0);
-        assert(ring_buf_lower_half != MAP_FAILED && "mmap failed");
-
-        ring_buf_upper_half =
-            mmap((void*)(uintptr_t(reserve_va) + ring_buf_phys_size_bytes),
-                 ring_buf_phys_size_bytes, PROT_READ | PROT_WRITE | PROT_EXEC,
-                 MAP_SHARED | MAP_FIXED, ring_buf_shm_fd, 0);
-        assert(ring_buf_upper_half != MAP_FAILED && "mmap failed");
-      }
-
-      // Successfully created mapping.
-      ring_buf_ = ring_buf_lower_half;
-
-      // Release explicit reference to shared memory object.
-      CloseRingBufferFD(ring_buf_shm_path, ring_buf_shm_fd);
-      return;
-#endif
-#ifdef _WIN32
-    HANDLE ring_buf_mapping = INVALID_HANDLE_VALUE;
-    void* ring_buf_lower_half = NULL;
-    void* ring_buf_upper_half = NULL;
-
-    do {
-      // Create a page file mapping to back the ring buffer.
-      ring_buf_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
-                                           PAGE_EXECUTE_READWRITE | SEC_COMMIT,
-                                           0, ring_buf_phys_size_bytes, NULL);
-      if (ring_buf_mapping == NULL) {
-        break;
-      }
-
-      // Retry until obtaining an appropriate virtual address mapping.
-      for (int num_attempts = 0; num_attempts < 1000; ++num_attempts) {
-        // Find a virtual address range twice the size of the file mapping.
-        void* reserve_va =
-            VirtualAllocEx(GetCurrentProcess(), NULL, ring_buf_alloc_bytes_,
-                           MEM_TOP_DOWN | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
-        if (reserve_va == NULL) {
-          break;
-        }
-        VirtualFree(reserve_va, 0, MEM_RELEASE);
-
-        // Map the ring buffer into the free virtual range.
-        // This may fail: another thread can allocate in this range.
-        ring_buf_lower_half = MapViewOfFileEx(
-            ring_buf_mapping, FILE_MAP_ALL_ACCESS | FILE_MAP_EXECUTE, 0, 0,
-            ring_buf_phys_size_bytes, reserve_va);
-
-        if (ring_buf_lower_half == NULL) {
-          // Virtual range allocated by another thread, try again.
-          continue;
-        }
-
-        ring_buf_upper_half = MapViewOfFileEx(
-            ring_buf_mapping, FILE_MAP_ALL_ACCESS | FILE_MAP_EXECUTE, 0, 0,
-            ring_buf_phys_size_bytes,
-            (void*)(uintptr_t(reserve_va) + ring_buf_phys_size_bytes));
-
-        if (ring_buf_upper_half == NULL) {
-          // Virtual range allocated by another thread, try again.
-          UnmapViewOfFile(ring_buf_lower_half);
-          continue;
-        }
-
-        // Successfully created mapping.
-        ring_buf_ = ring_buf_lower_half;
-        break;
-      }
-
-      if (ring_buf_ == NULL) {
-        break;
-      }
-
-      // Release file mapping (reference counted by views).
-      CloseHandle(ring_buf_mapping);
 
-      // Don't register the memory: causes a failure in the KFD.
-      // Instead use implicit registration to access the ring buffer.
-      return;
-    } while (false);
-
-    // Resource cleanup on failure.
-    UnmapViewOfFile(ring_buf_upper_half);
-    UnmapViewOfFile(ring_buf_lower_half);
-    CloseHandle(ring_buf_mapping);
-#endif
+    // Map both halves of a VA range twice the size of the physical backing store to the same
+    // pages.  If the GPU device is KV, do not set PROT_EXEC flag.
+    ring_buf_ = os::AllocateDoubleMapped(ring_buf_phys_size_bytes, !is_kv_queue_,
+                                         ring_buf_phys_size_bytes >= kRingBufHugePageBytes);
+    if (ring_buf_ != nullptr) ring_buf_alloc_bytes_ = 2 * ring_buf_phys_size_bytes;
   } else {
     // Allocate storage for the ring buffer.
     ring_buf_alloc_bytes_ = AlignUp(
@@ -688,62 +578,23 @@ void AqlQueue::AllocRegisteredRingBuffer(uint32_t queue_size_pkts) {
 }
 
 void AqlQueue::FreeRegisteredRingBuffer() {
-  if ((agent_->profile() == HSA_PROFILE_FULL) && queue_full_workaround_) {
-#ifdef __linux__
-    munmap(ring_buf_, ring_buf_alloc_bytes_);
-#endif
-#ifdef _WIN32
-    UnmapViewOfFile(ring_buf_);
-    UnmapViewOfFile(
-        (void*)(uintptr_t(ring_buf_) + (ring_buf_alloc_bytes_ / 2)));
-#endif
-  } else {
-    agent_->system_deallocator()(ring_buf_);
-  }
+  FreeRingBuffer(agent_, ring_buf_, ring_buf_alloc_bytes_);
 
   ring_buf_ = NULL;
   ring_buf_alloc_bytes_ = 0;
 }
 
-void AqlQueue::CloseRingBufferFD(const char* ring_buf_shm_path, int fd) const {
-#ifdef __linux__
-#if !defined(HAVE_MEMFD_CREATE)
-  shm_unlink(ring_buf_shm_path);
-#endif
-  close(fd);
-#else
-  assert(false && "Function only needed on Linux.");
-#endif
-}
-
-int AqlQueue::CreateRingBufferFD(const char* ring_buf_shm_path,
-                                 uint32_t ring_buf_phys_size_bytes) const {
-#ifdef __linux__
-  int fd;
-#ifdef HAVE_MEMFD_CREATE
-  fd = syscall(__NR_memfd_create, ring_buf_shm_path, 0);
-
-  if (fd == -1) return -1;
-
-  if (ftruncate(fd, ring_buf_phys_size_bytes) == -1) {
-    CloseRingBufferFD(ring_buf_shm_path, fd);
-    return -1;
+void AqlQueue::FreeRingBuffer(GpuAgent* agent, void* ring_buf, uint32_t ring_buf_alloc_bytes) {
+  if ((agent->profile() == HSA_PROFILE_FULL) && QueueFullWorkaround(agent)) {
+    os::FreeDoubleMapped(ring_buf, ring_buf_alloc_bytes / 2);
+  } else {
+    agent->system_deallocator()(ring_buf);
   }
-#else
-  fd = shm_open(ring_buf_shm_path, O_CREAT | O_RDWR | O_EXCL, S_IRUSR | S_IWUSR);
-
-  if (fd == -1) return -1;
+}
 
-  if (posix_fallocate(fd, 0, ring_buf_phys_size_bytes) != 0) {
-    CloseRingBufferFD(ring_buf_shm_path, fd);
-    return -1;
-  }
-#endif
-  return fd;
-#else
-  assert(false && "Function only needed on Linux.");
-  return -1;
-#endif
+uint32_t AqlQueue::QueueFullWorkaround(const GpuAgent* agent) {
+  const core::Isa* isa = agent->isa();
+  return (isa->GetMajorVersion() == 7 || isa->GetMajorVersion() == 8) ? 1 : 0;
 }
 
 void AqlQueue::Suspend() {
@@ -1033,74 +884,78 @@ bool AqlQueue::ExceptionHandler(hsa_signal_value_t error_code, void* arg) {
 }
 
 hsa_status_t AqlQueue::SetCUMasking(uint32_t num_cu_mask_count, const uint32_t* cu_mask) {
-  uint32_t cu_count;
-  agent_->GetInfo((hsa_agent_info_t)HSA_AMD_AGENT_INFO_COMPUTE_UNIT_COUNT, &cu_count);
-  size_t mask_dwords = (cu_count + 31) / 32;
-  // Mask to trim the last uint32_t in cu_mask to the physical CU count
-  uint32_t tail_mask = (1 << (cu_count % 32)) - 1;
+  // Physical and global masks are precomputed by the agent.
+  const uint32_t mask_dwords = agent_->cu_mask_dwords();
+  const uint32_t global_dwords = agent_->global_cu_mask_dwords();
 
-  auto global_mask = core::Runtime::runtime_singleton_->flag().cu_mask(agent_->enumeration_index());
-  std::vector<uint32_t> mask;
+  // num_cu_mask_count = 0 resets the CU mask.
+  const uint32_t user_dwords = (num_cu_mask_count == 0) ? mask_dwords : num_cu_mask_count / 32;
+  GpuAgent::CUMask mask;
+  if (num_cu_mask_count == 0)
+    mask = agent_->physical_cu_mask();
+  else
+    mask.Assign(cu_mask, Min(user_dwords, mask_dwords));
 
   bool clipped = false;
-
-  // num_cu_mask_count = 0 resets the CU mask.
-  if (num_cu_mask_count == 0) {
-    for (int i = 0; i < mask_dwords; i++) mask.push_back(-1);
-  } else {
-    for (int i = 0; i < num_cu_mask_count / 32; i++) mask.push_back(cu_mask[i]);
-  }
+  uint32_t limit;
 
   // Apply global mask to user mask
-  if (!global_mask.empty()) {
+  if (global_dwords != 0) {
     // Limit mask processing to smallest needed dword range
-    size_t limit = Min(global_mask.size(), mask.size(), mask_dwords);
+    limit = Min(global_dwords, user_dwords, mask_dwords);
 
     // Check for disabling requested cus.
-    for (int i = limit; i < mask.size(); i++) {
-      if (mask[i] != 0) {
-        clipped = true;
-        break;
+    if (num_cu_mask_count == 0) {
+      clipped = (limit < user_dwords);
+    } else {
+      for (uint32_t i = limit; i < user_dwords; i++) {
+        if (cu_mask[i] != 0) {
+          clipped = true;
+          break;
+        }
       }
     }
 
-    mask.resize(limit, 0);
-    for (size_t i = 0; i < limit; i++) {
-      clipped |= ((mask[i] & (~global_mask[i])) != 0);
-      mask[i] &= global_mask[i];
-    }
+    mask.Truncate(limit);
+    clipped |= mask.Intersect(agent_->global_cu_mask());
   } else {
     // Limit to physical CU range only
-    size_t limit = Min(mask.size(), mask_dwords);
-    mask.resize(limit, 0);
+    limit = Min(user_dwords, mask_dwords);
+    mask.Truncate(limit);
   }
 
-  // Clip last dword to physical CU limit if necessary
-  if ((mask.size() == mask_dwords) && (tail_mask != 0)) mask[mask_dwords - 1] &= tail_mask;
+  // Clip to physical CU limit
+  mask.Intersect(agent_->physical_cu_mask());
 
-  // Apply mask if non-default or not queue initialization.
   ScopedAcquire<KernelMutex> lock(&mask_lock_);
-  if ((!cu_mask_.empty()) || (num_cu_mask_count != 0) || (!global_mask.empty())) {
+
+  // Skip the driver call when the effective mask is unchanged.
+  bool unchanged = (cu_mask_dwords_ == limit) && (cu_mask_ == mask);
+
+  // Apply mask if non-default or not queue initialization.
+  if ((!unchanged) &&
+      ((cu_mask_dwords_ != 0) || (num_cu_mask_count != 0) || (global_dwords != 0))) {
     HSAKMT_STATUS ret =
-        hsaKmtSetQueueCUMask(queue_id_, mask.size() * 32, reinterpret_cast<HSAuint32*>(&mask[0]));
+        hsaKmtSetQueueCUMask(queue_id_, limit * 32, reinterpret_cast<HSAuint32*>(mask.data()));
     if (ret != HSAKMT_STATUS_SUCCESS) return HSA_STATUS_ERROR;
   }
 
   // update current cu masking tracking.
-  cu_mask_ = std::move(mask);
+  cu_mask_ = mask;
+  cu_mask_dwords_ = limit;
   return clipped ? (hsa_status_t)HSA_STATUS_CU_MASK_REDUCED : HSA_STATUS_SUCCESS;
 }
 
 hsa_status_t AqlQueue::GetCUMasking(uint32_t num_cu_mask_count, uint32_t* cu_mask) {
   ScopedAcquire<KernelMutex> lock(&mask_lock_);
-  assert(!cu_mask_.empty() && "No current cu_mask!");
+  assert(cu_mask_dwords_ != 0 && "No current cu_mask!");
 
   uint32_t user_dword_count = num_cu_mask_count / 32;
-  if (user_dword_count > cu_mask_.size()) {
-    memset(&cu_mask[cu_mask_.size()], 0, sizeof(uint32_t) * (user_dword_count - cu_mask_.size()));
-    user_dword_count = cu_mask_.size();
+  if (user_dword_count > cu_mask_dwords_) {
+    memset(&cu_mask[cu_mask_dwords_], 0, sizeof(uint32_t) * (user_dword_count - cu_mask_dwords_));
+    user_dword_count = cu_mask_dwords_;
   }
-  memcpy(cu_mask, &cu_mask_[0], sizeof(uint32_t) * user_dword_count);
+  memcpy(cu_mask, cu_mask_.data(), sizeof(uint32_t) * user_dword_count);
   return HSA_STATUS_SUCCESS;
 }
 
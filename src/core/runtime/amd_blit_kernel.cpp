@@ -48,6 +48,8 @@
 
 #include "core/inc/amd_gpu_agent.h"
 #include "core/inc/hsa_internal.h"
+#include "core/inc/init_profile.h"
+#include "core/util/counters.h"
 #include "core/util/utils.h"
 
 namespace rocr {
@@ -529,6 +531,7 @@ BlitKernel::BlitKernel(core::Queue* queue)
 BlitKernel::~BlitKernel() {}
 
 hsa_status_t BlitKernel::Initialize(const core::Agent& agent) {
+  core::InitProfile::Phase phase("blit kernels", agent.node_id());
   queue_bitmask_ = queue_->public_handle()->size - 1;
 
   hsa_status_t status = HSA::hsa_signal_create(1, 0, NULL, &completion_signal_);
@@ -783,8 +786,12 @@ uint64_t BlitKernel::AcquireWriteIndex(uint32_t num_packet) {
 
   uint64_t write_index = queue_->AddWriteIndexAcqRel(num_packet);
 
-  while (write_index + num_packet - queue_->LoadReadIndexRelaxed() > queue_->public_handle()->size) {
-    os::YieldThread();
+  if (write_index + num_packet - queue_->LoadReadIndexRelaxed() > queue_->public_handle()->size) {
+    counters::Increment(counters::QueueRingFull);
+    while (write_index + num_packet - queue_->LoadReadIndexRelaxed() >
+           queue_->public_handle()->size) {
+      os::YieldThread();
+    }
   }
 
   return write_index;
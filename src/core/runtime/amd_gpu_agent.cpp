@@ -58,10 +58,12 @@
 #include "core/inc/amd_blit_sdma.h"
 #include "core/inc/amd_gpu_pm4.h"
 #include "core/inc/amd_gpu_shaders.h"
+#include "core/inc/init_profile.h"
 #include "core/inc/amd_memory_region.h"
 #include "core/inc/interrupt_signal.h"
 #include "core/inc/isa.h"
 #include "core/inc/runtime.h"
+#include "core/util/counters.h"
 #include "core/util/os.h"
 #include "inc/hsa_ext_image.h"
 #include "inc/hsa_ven_amd_aqlprofile.h"
@@ -93,6 +95,8 @@ GpuAgent::GpuAgent(HSAuint32 node, const HsaNodeProperties& node_props, bool xna
       enum_index_(index),
       ape1_base_(0),
       ape1_size_(0),
+      device_state_ready_(false),
+      queue_pool_closed_(false),
       scratch_cache_(
           [this](void* base, size_t size, bool large) { ReleaseScratch(base, size, large); }) {
   const bool is_apu_node = (properties_.NumCPUCores > 0);
@@ -101,6 +105,9 @@ GpuAgent::GpuAgent(HSAuint32 node, const HsaNodeProperties& node_props, bool xna
   HSAKMT_STATUS err = hsaKmtGetClockCounters(node_id(), &t0_);
   t1_ = t0_;
   historical_clock_ratio_ = 0.0;
+  clock_seq_.store(0, std::memory_order_relaxed);
+  clock_gpu_.store(t1_.GPUClockCounter, std::memory_order_relaxed);
+  clock_system_.store(t1_.SystemClockCounter, std::memory_order_relaxed);
   assert(err == HSAKMT_STATUS_SUCCESS && "hsaGetClockCounters error");
 
   const core::Isa *isa_base = core::IsaRegistry::GetIsa(
@@ -155,9 +162,12 @@ GpuAgent::GpuAgent(HSAuint32 node, const HsaNodeProperties& node_props, bool xna
 #endif
 
   // Populate region list.
+  core::InitProfile::Phase region_phase("regions", node_id());
   InitRegionList();
+  region_phase.End();
 
   // Populate cache list.
+  core::InitProfile::Phase cache_phase("caches", node_id());
   InitCacheList();
 }
 
@@ -178,6 +188,9 @@ GpuAgent::~GpuAgent() {
     hsaKmtFreeMemory(scratch_pool_.base(), scratch_pool_.size());
   }
 
+  // Queues destroyed after this point free their buffers directly.
+  DrainQueuePool(true);
+
   system_deallocator()(doorbell_queue_map_);
 
   if (trap_code_buf_ != NULL) {
@@ -695,13 +708,28 @@ void GpuAgent::PreloadBlits() {
 hsa_status_t GpuAgent::PostToolsInit() {
   // Defer memory allocation until agents have been discovered.
   InitNumaAllocator();
-  InitScratchPool();
-  BindTrapHandler();
+  // With lazy init scratch and the trap handler wait for the first queue on this agent.
+  if (!core::Runtime::runtime_singleton_->flag().lazy_agent_init()) InitDeviceState();
   InitDma();
 
   return HSA_STATUS_SUCCESS;
 }
 
+void GpuAgent::InitDeviceStateBody() {
+  ScopedAcquire<KernelMutex> lock(&device_state_lock_);
+  if (device_state_ready_.load(std::memory_order_relaxed)) return;
+
+  core::InitProfile::Phase scratch_phase("scratch pool", node_id());
+  InitScratchPool();
+  scratch_phase.End();
+
+  core::InitProfile::Phase trap_phase("trap handler", node_id());
+  BindTrapHandler();
+  trap_phase.End();
+
+  device_state_ready_.store(true, std::memory_order_release);
+}
+
 hsa_status_t GpuAgent::DmaCopy(void* dst, const void* src, size_t size) {
   return blits_[BlitDevToDev]->SubmitLinearCopyCommand(dst, src, size);
 }
@@ -1033,6 +1061,9 @@ hsa_status_t GpuAgent::QueueCreate(size_t size, hsa_queue_type32_t queue_type,
                                    void* data, uint32_t private_segment_size,
                                    uint32_t group_segment_size,
                                    core::Queue** queue) {
+  // Queues need the scratch pool and trap handler, which may have been deferred.
+  InitDeviceState();
+
   // Handle GWS queues.
   if (queue_type == HSA_QUEUE_TYPE_COOPERATIVE) {
     ScopedAcquire<KernelMutex> lock(&gws_queue_.lock_);
@@ -1182,7 +1213,11 @@ void GpuAgent::AcquireQueueScratch(ScratchInfo& scratch) {
   [&]() {
     // Check scratch cache
     scratch.large = large;
-    if (scratch_cache_.alloc(scratch)) return;
+    if (scratch_cache_.alloc(scratch)) {
+      counters::Increment(counters::ScratchCacheHit);
+      return;
+    }
+    counters::Increment(counters::ScratchCacheMiss);
 
     // Attempt new allocation.
     for (int i = 0; i < 2; i++) {
@@ -1326,6 +1361,12 @@ uint64_t GpuAgent::TranslateTime(uint64_t tick) {
   // Limit errors due to relative frequency drift to ~0.5us.  Sync clocks at 16Hz.
   const int64_t max_extrapolation = core::Runtime::runtime_singleton_->sys_clock_freq() >> 4;
 
+  // Most ticks fall inside the window of the last calibration and need no lock.
+  ClockSnapshot clocks;
+  LoadClockSnapshot(clocks);
+  uint64_t fast_tick;
+  if (TranslateTimeFast(tick, clocks, max_extrapolation, fast_tick)) return fast_tick;
+
   ScopedAcquire<KernelMutex> lock(&t1_lock_);
   // Limit errors due to correlated pair certainty to ~0.5us.
   // extrapolated time < (0.5us / half clock read certainty) * delay between clock measures
@@ -1369,6 +1410,45 @@ uint64_t GpuAgent::TranslateTime(uint64_t tick) {
   return system_tick;
 }
 
+void GpuAgent::TranslateTime(const uint64_t* ticks, uint64_t* system_ticks, size_t count) {
+  const int64_t max_extrapolation = core::Runtime::runtime_singleton_->sys_clock_freq() >> 4;
+
+  ClockSnapshot clocks;
+  LoadClockSnapshot(clocks);
+  for (size_t i = 0; i < count; i++) {
+    if (TranslateTimeFast(ticks[i], clocks, max_extrapolation, system_ticks[i])) continue;
+    // Out of window ticks resync under the lock, then pick up the new calibration.
+    system_ticks[i] = TranslateTime(ticks[i]);
+    LoadClockSnapshot(clocks);
+  }
+}
+
+void GpuAgent::LoadClockSnapshot(ClockSnapshot& clocks) const {
+  uint32_t seq;
+  do {
+    seq = clock_seq_.load(std::memory_order_acquire);
+    clocks.gpu = clock_gpu_.load(std::memory_order_relaxed);
+    clocks.system = clock_system_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) != 0 || seq != clock_seq_.load(std::memory_order_relaxed));
+}
+
+bool GpuAgent::TranslateTimeFast(uint64_t tick, const ClockSnapshot& clocks,
+                                 int64_t max_extrapolation, uint64_t& system_tick) const {
+  // Pre-startup ticks and the uncalibrated initial state go through the locked path.
+  if (tick < t0_.GPUClockCounter || clocks.gpu == t0_.GPUClockCounter) return false;
+  // Same bounds as the locked path; see TranslateTime.
+  if (((clocks.gpu - t0_.GPUClockCounter) >> 2) + clocks.gpu < tick) return false;
+
+  const double ratio = double(clocks.system - t0_.SystemClockCounter) /
+      double(clocks.gpu - t0_.GPUClockCounter);
+  const int64_t elapsed = int64_t(ratio * double(int64_t(tick - clocks.gpu)));
+  if (elapsed >= max_extrapolation) return false;
+
+  system_tick = uint64_t(elapsed) + clocks.system;
+  return true;
+}
+
 bool GpuAgent::current_coherency_type(hsa_amd_coherency_type_t type) {
   if (!is_kv_device_) {
     current_coherency_type_ = type;
@@ -1416,6 +1496,14 @@ uint16_t GpuAgent::GetSdmaMicrocodeVersion() const {
 void GpuAgent::SyncClocks() {
   HSAKMT_STATUS err = hsaKmtGetClockCounters(node_id(), &t1_);
   assert(err == HSAKMT_STATUS_SUCCESS && "hsaGetClockCounters error");
+
+  // Seqlock publish: readers retry while the sequence is odd or has changed.
+  const uint32_t seq = clock_seq_.load(std::memory_order_relaxed);
+  clock_seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  clock_gpu_.store(t1_.GPUClockCounter, std::memory_order_relaxed);
+  clock_system_.store(t1_.SystemClockCounter, std::memory_order_relaxed);
+  clock_seq_.store(seq + 2, std::memory_order_release);
 }
 
 void GpuAgent::BindTrapHandler() {
@@ -1591,6 +1679,58 @@ void GpuAgent::Trim() {
   Agent::Trim();
   ScopedAcquire<KernelMutex> lock(&scratch_lock_);
   scratch_cache_.trim(false);
+  lock.Release();
+  DrainQueuePool(false);
+}
+
+bool GpuAgent::ParkQueue(const ParkedQueue& parked) {
+  ScopedAcquire<KernelMutex> lock(&queue_pool_lock_);
+  if (queue_pool_closed_ ||
+      queue_pool_.size() >= core::Runtime::runtime_singleton_->flag().queue_pool_size())
+    return false;
+  queue_pool_.push_back(parked);
+  return true;
+}
+
+bool GpuAgent::UnparkQueue(uint32_t size_pkts, ParkedQueue& parked) {
+  ScopedAcquire<KernelMutex> lock(&queue_pool_lock_);
+  for (auto it = queue_pool_.rbegin(); it != queue_pool_.rend(); it++) {
+    if (it->size_pkts == size_pkts) {
+      parked = *it;
+      queue_pool_.erase(std::next(it).base());
+      return true;
+    }
+  }
+  return false;
+}
+
+void GpuAgent::DrainQueuePool(bool close) {
+  std::vector<ParkedQueue> pool;
+  {
+    ScopedAcquire<KernelMutex> lock(&queue_pool_lock_);
+    queue_pool_closed_ |= close;
+    pool.swap(queue_pool_);
+  }
+  for (auto& parked : pool) {
+    AqlQueue::FreeRingBuffer(this, parked.ring_buf, parked.ring_buf_alloc_bytes);
+    system_deallocator()(parked.pm4_ib_buf);
+  }
+}
+
+void GpuAgent::InitCUMask() {
+  uint32_t cu_count = 0;
+  if (properties_.NumSIMDPerCU != 0)
+    cu_count = properties_.NumFComputeCores / properties_.NumSIMDPerCU;
+  assert(cu_count <= CUMask::kDwords * 32 && "CU count exceeds CU mask capacity.");
+  cu_mask_dwords_ = Min(uint32_t((cu_count + 31) / 32), uint32_t(CUMask::kDwords));
+  physical_cu_mask_.SetLow(cu_count);
+
+  const auto& global_mask = core::Runtime::runtime_singleton_->flag().cu_mask(enum_index_);
+  global_cu_mask_dwords_ = Min(uint32_t(global_mask.size()), cu_mask_dwords_);
+  if (global_cu_mask_dwords_ != 0)
+    global_cu_mask_.Assign(&global_mask[0], global_cu_mask_dwords_);
+  else
+    global_cu_mask_.Clear();
 }
 
 void GpuAgent::InitNumaAllocator() {
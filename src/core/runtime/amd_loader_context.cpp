@@ -51,8 +51,11 @@
 #include "core/util/os.h"
 
 #include <cstdlib>
+#include <map>
 #include <utility>
+#include "core/inc/default_signal.h"
 #include "core/inc/hsa_internal.h"
+#include "core/util/locks.h"
 #include "core/util/utils.h"
 #include "inc/hsa_ext_amd.h"
 
@@ -83,6 +86,46 @@ bool IsDebuggerRegistered()
   //         core::Runtime::runtime_singleton_->flag().tools_lib_names().size()));
 }
 
+/// @brief Device uploads of segment contents.  Copies are submitted without
+/// waiting and completion is awaited once per agent.
+class UploadBatch final {
+public:
+  UploadBatch() {}
+
+  ~UploadBatch() {
+    for (auto &upload : uploads_) {
+      upload.second->DestroySignal();
+    }
+  }
+
+  bool Copy(core::Agent *agent, void *dst, const void *src, core::Agent *src_agent, size_t size) {
+    core::Signal *&signal = uploads_[agent];
+    if (nullptr == signal) {
+      signal = new core::DefaultSignal(0);
+    }
+    signal->AddRelaxed(1);
+    std::vector<core::Signal*> dep_signals;
+    if (HSA_STATUS_SUCCESS !=
+        agent->DmaCopy(dst, *agent, src, *src_agent, size, dep_signals, *signal)) {
+      signal->SubRelaxed(1);
+      return HSA_STATUS_SUCCESS == agent->DmaCopy(dst, src, size);
+    }
+    return true;
+  }
+
+  void Wait() {
+    for (auto &upload : uploads_) {
+      upload.second->WaitAcquire(HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+    }
+  }
+
+private:
+  UploadBatch(const UploadBatch&);
+  UploadBatch& operator=(const UploadBatch&);
+
+  std::map<core::Agent*, core::Signal*> uploads_;
+};
+
 class SegmentMemory {
 public:
   virtual ~SegmentMemory() {}
@@ -92,7 +135,10 @@ public:
   virtual bool Allocate(size_t size, size_t align, bool zero) = 0;
   virtual bool Copy(size_t offset, const void *src, size_t size) = 0;
   virtual void Free() = 0;
-  virtual bool Freeze() = 0;
+  // Starts publishing the segment contents, uploads are added to batch.
+  virtual bool Freeze(UploadBatch &batch) = 0;
+  // Called once the uploads of a successful Freeze have completed.
+  virtual void Frozen() {}
 
 protected:
   SegmentMemory() {}
@@ -117,7 +163,7 @@ public:
   bool Allocate(size_t size, size_t align, bool zero) override;
   bool Copy(size_t offset, const void *src, size_t size) override;
   void Free() override;
-  bool Freeze() override;
+  bool Freeze(UploadBatch &batch) override;
 
 private:
   MallocedMemory(const MallocedMemory&);
@@ -166,7 +212,7 @@ void MallocedMemory::Free()
   size_ = 0;
 }
 
-bool MallocedMemory::Freeze()
+bool MallocedMemory::Freeze(UploadBatch &batch)
 {
   assert(this->Allocated());
   return true;
@@ -187,7 +233,7 @@ public:
   bool Allocate(size_t size, size_t align, bool zero) override;
   bool Copy(size_t offset, const void *src, size_t size) override;
   void Free() override;
-  bool Freeze() override;
+  bool Freeze(UploadBatch &batch) override;
 
 private:
   MappedMemory(const MappedMemory&);
@@ -254,7 +300,7 @@ void MappedMemory::Free()
   size_ = 0;
 }
 
-bool MappedMemory::Freeze()
+bool MappedMemory::Freeze(UploadBatch &batch)
 {
   assert(this->Allocated());
   return true;
@@ -270,23 +316,30 @@ public:
 
   void* Address(size_t offset = 0) const override
     { assert(this->Allocated()); return (char*)ptr_ + offset; }
-  void* HostAddress(size_t offset = 0) const override
-    { assert(this->Allocated()); return (char*)host_ptr_ + offset; }
+  void* HostAddress(size_t offset = 0) const override;
   bool Allocated() const override
     { return nullptr != ptr_; }
 
   bool Allocate(size_t size, size_t align, bool zero) override;
   bool Copy(size_t offset, const void *src, size_t size) override;
   void Free() override;
-  bool Freeze() override;
+  bool Freeze(UploadBatch &batch) override;
+  void Frozen() override;
 
 private:
   RegionMemory(const RegionMemory&);
   RegionMemory& operator=(const RegionMemory&);
 
+  // Owning GPU if the region is device memory which needs an upload.
+  core::Agent* DeviceAgent() const;
+
   hsa_region_t region_;
   void *ptr_;
-  void *host_ptr_;
+  // System memory shadow of device memory, equal to ptr_ when the region is
+  // host memory.  Released once the segment is frozen and read back from the
+  // device if a host address is requested later.
+  mutable void *host_ptr_;
+  mutable KernelMutex host_lock_;
   size_t size_;
 };
 
@@ -311,6 +364,36 @@ hsa_region_t RegionMemory::System() {
   return core::MemoryRegion::Convert(default_system_region);
 }
 
+core::Agent* RegionMemory::DeviceAgent() const
+{
+  const AMD::MemoryRegion* region =
+      reinterpret_cast<const AMD::MemoryRegion*>(core::MemoryRegion::Convert(region_));
+  if (region->IsSystem()) {
+    return nullptr;
+  }
+  core::Agent* agent = region->owner();
+  return (agent != NULL && agent->device_type() == core::Agent::kAmdGpuDevice) ? agent : nullptr;
+}
+
+void* RegionMemory::HostAddress(size_t offset) const
+{
+  assert(this->Allocated());
+  ScopedAcquire<KernelMutex> lock(&host_lock_);
+  if (nullptr == host_ptr_) {
+    // The shadow was released after freezing, read it back from the device.
+    void *shadow = nullptr;
+    if (HSA_STATUS_SUCCESS != HSA::hsa_memory_allocate(RegionMemory::System(), size_, &shadow)) {
+      return nullptr;
+    }
+    if (HSA_STATUS_SUCCESS != DeviceAgent()->DmaCopy(shadow, ptr_, size_)) {
+      HSA::hsa_memory_free(shadow);
+      return nullptr;
+    }
+    host_ptr_ = shadow;
+  }
+  return (char*)host_ptr_ + offset;
+}
+
 bool RegionMemory::Allocate(size_t size, size_t align, bool zero)
 {
   assert(!this->Allocated());
@@ -321,7 +404,10 @@ bool RegionMemory::Allocate(size_t size, size_t align, bool zero)
     return false;
   }
   assert(0 == ((uintptr_t)ptr_) % align);
-  if (HSA_STATUS_SUCCESS != HSA::hsa_memory_allocate(RegionMemory::System(), size, &host_ptr_)) {
+  if (nullptr == DeviceAgent()) {
+    // Host memory, write the segment in place.
+    host_ptr_ = ptr_;
+  } else if (HSA_STATUS_SUCCESS != HSA::hsa_memory_allocate(RegionMemory::System(), size, &host_ptr_)) {
     HSA::hsa_memory_free(ptr_);
     ptr_ = nullptr;
     host_ptr_ = nullptr;
@@ -346,29 +432,37 @@ bool RegionMemory::Copy(size_t offset, const void *src, size_t size)
 void RegionMemory::Free()
 {
   assert(this->Allocated());
-  HSA::hsa_memory_free(ptr_);
-  if (nullptr != host_ptr_) {
+  if (nullptr != host_ptr_ && host_ptr_ != ptr_) {
     HSA::hsa_memory_free(host_ptr_);
   }
+  HSA::hsa_memory_free(ptr_);
   ptr_ = nullptr;
   host_ptr_ = nullptr;
   size_ = 0;
 }
 
-bool RegionMemory::Freeze() {
+bool RegionMemory::Freeze(UploadBatch &batch) {
   assert(this->Allocated() && nullptr != host_ptr_);
 
-  core::Agent* agent = reinterpret_cast<AMD::MemoryRegion*>(
-                           core::MemoryRegion::Convert(region_))->owner();
-  if (agent != NULL && agent->device_type() == core::Agent::kAmdGpuDevice) {
-    if (HSA_STATUS_SUCCESS != agent->DmaCopy(ptr_, host_ptr_, size_)) {
-      return false;
-    }
-  } else {
-    memcpy(ptr_, host_ptr_, size_);
+  core::Agent* agent = DeviceAgent();
+  if (nullptr == agent) {
+    return true;
   }
 
-  return true;
+  core::Agent* host_agent = reinterpret_cast<AMD::MemoryRegion*>(
+                                core::MemoryRegion::Convert(RegionMemory::System()))->owner();
+  return batch.Copy(agent, ptr_, host_ptr_, host_agent, size_);
+}
+
+void RegionMemory::Frozen() {
+  if (nullptr == DeviceAgent()) {
+    return;
+  }
+  ScopedAcquire<KernelMutex> lock(&host_lock_);
+  if (nullptr != host_ptr_) {
+    HSA::hsa_memory_free(host_ptr_);
+    host_ptr_ = nullptr;
+  }
 }
 
 }  // namespace anonymous
@@ -539,7 +633,30 @@ bool LoaderContext::SegmentFreeze(amdgpu_hsa_elf_segment_t segment, // not used.
                                   size_t size)                      // not used.
 {
   assert(nullptr != seg);
-  return ((SegmentMemory*)seg)->Freeze();
+  SegmentMemory *mem = (SegmentMemory*)seg;
+  UploadBatch batch;
+  bool frozen = mem->Freeze(batch);
+  batch.Wait();
+  if (frozen) {
+    mem->Frozen();
+  }
+  return frozen;
+}
+
+void LoaderContext::SegmentsFreeze(SegmentFreezeRequest* requests, size_t count)
+{
+  // Submit every upload before waiting on any of them.
+  UploadBatch batch;
+  for (size_t i = 0; i < count; ++i) {
+    assert(nullptr != requests[i].seg);
+    requests[i].frozen = ((SegmentMemory*)requests[i].seg)->Freeze(batch);
+  }
+  batch.Wait();
+  for (size_t i = 0; i < count; ++i) {
+    if (requests[i].frozen) {
+      ((SegmentMemory*)requests[i].seg)->Frozen();
+    }
+  }
 }
 
 bool LoaderContext::ImageExtensionSupported() {
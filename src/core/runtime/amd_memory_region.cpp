@@ -48,6 +48,7 @@
 #include "core/inc/runtime.h"
 #include "core/inc/amd_cpu_agent.h"
 #include "core/inc/amd_gpu_agent.h"
+#include "core/util/os.h"
 #include "core/util/utils.h"
 #include "core/inc/exceptions.h"
 
@@ -57,6 +58,18 @@ namespace AMD {
 // Tracks aggregate size of system memory available on platform
 size_t MemoryRegion::max_sysmem_alloc_size_ = 0;
 
+PinnedMemoryCache MemoryRegion::pinned_cache_(
+    [](const void* owner, void* ptr, size_t size, const std::vector<uint32_t>& nodes) -> void* {
+      void* agent_ptr;
+      hsa_status_t err =
+          static_cast<const MemoryRegion*>(owner)->PinAndMap(ptr, size, nodes, &agent_ptr);
+      return (err == HSA_STATUS_SUCCESS) ? agent_ptr : nullptr;
+    },
+    [](void* ptr) {
+      MakeKfdMemoryUnresident(ptr);
+      DeregisterMemory(ptr);
+    });
+
 void* MemoryRegion::AllocateKfdMemory(const HsaMemFlags& flag,
                                       HSAuint32 node_id, size_t size) {
   void* ret = NULL;
@@ -106,6 +119,8 @@ MemoryRegion::MemoryRegion(bool fine_grain, bool kernarg, bool full_profile, cor
       mem_props_(mem_props),
       max_single_alloc_size_(0),
       virtual_size_(0),
+      allocated_bytes_(0),
+      huge_page_bytes_(0),
       fragment_allocator_(BlockAllocator(*this)) {
   virtual_size_ = GetPhysicalSize();
 
@@ -158,7 +173,17 @@ MemoryRegion::~MemoryRegion() {}
 
 hsa_status_t MemoryRegion::Allocate(size_t& size, AllocateFlags alloc_flags, void** address) const {
   ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
-  return AllocateImpl(size, alloc_flags, address);
+  hsa_status_t err = AllocateImpl(size, alloc_flags, address);
+  if (err == HSA_STATUS_SUCCESS) {
+    allocated_bytes_.fetch_add(size, std::memory_order_relaxed);
+    if (UseHugePages(size)) huge_page_bytes_.fetch_add(size, std::memory_order_relaxed);
+  }
+  return err;
+}
+
+bool MemoryRegion::UseHugePages(size_t size) const {
+  const size_t threshold = core::Runtime::runtime_singleton_->flag().sysmem_huge_page_threshold();
+  return IsSystem() && (threshold != 0) && (size >= threshold);
 }
 
 hsa_status_t MemoryRegion::AllocateImpl(size_t& size, AllocateFlags alloc_flags,
@@ -180,6 +205,10 @@ hsa_status_t MemoryRegion::AllocateImpl(size_t& size, AllocateFlags alloc_flags,
 
   size = AlignUp(size, kPageSize_);
 
+  // Huge pages need 2MB granularity to be of use.
+  const bool huge_pages = UseHugePages(size);
+  if (huge_pages) size = AlignUp(size, kHugePageSize_);
+
   HsaMemFlags kmt_alloc_flags(mem_flag_);
   kmt_alloc_flags.ui32.ExecuteAccess =
       (alloc_flags & AllocateExecutable ? 1 : 0);
@@ -187,6 +216,16 @@ hsa_status_t MemoryRegion::AllocateImpl(size_t& size, AllocateFlags alloc_flags,
       (alloc_flags & AllocateDoubleMap ? 1 : 0);
   if (IsSystem() && (alloc_flags & AllocateIPC))
       kmt_alloc_flags.ui32.NonPaged = 1;
+  const bool interleave = IsSystem() && (alloc_flags & AllocateInterleave);
+  if (interleave) kmt_alloc_flags.ui32.NoNUMABind = 1;
+
+  // Placement policies only take effect if set before the pages are populated, so such system
+  // memory is mapped by the runtime rather than the thunk.  IPC and double mapped memory must come
+  // from the thunk.
+  if ((huge_pages || interleave) && ((alloc_flags & (AllocateIPC | AllocateDoubleMap)) == 0)) {
+    *address = AllocatePlaced(kmt_alloc_flags, alloc_flags, size, huge_pages, interleave);
+    if (*address != nullptr) return HSA_STATUS_SUCCESS;
+  }
 
   // Only allow using the suballocator for ordinary VRAM.
   if (IsLocalMemory()) {
@@ -256,14 +295,59 @@ hsa_status_t MemoryRegion::AllocateImpl(size_t& size, AllocateFlags alloc_flags,
   return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
 }
 
+void* MemoryRegion::AllocatePlaced(const HsaMemFlags& flags, AllocateFlags alloc_flags,
+                                   size_t size, bool huge_pages, bool interleave) const {
+  void* ptr = os::AllocateHostMemory(size, huge_pages ? kHugePageSize_ : kPageSize_);
+  if (ptr == nullptr) return nullptr;
+  MAKE_NAMED_SCOPE_GUARD(hostGuard, [&]() { os::FreeHostMemory(ptr, size); });
+
+  // Both are hints, the memory is usable without them.
+  if (huge_pages) os::AdviseHugePages(ptr, size);
+  if (interleave) os::InterleaveMemory(ptr, size);
+
+  if (!RegisterMemory(ptr, size, flags)) return nullptr;
+  MAKE_NAMED_SCOPE_GUARD(registerGuard, [&]() { DeregisterMemory(ptr); });
+
+  // As in AllocateImpl, unrestricted system memory is mapped to all GPUs.
+  const std::vector<uint32_t>& gpu_ids = core::Runtime::runtime_singleton_->gpu_ids();
+  if (((alloc_flags & AllocateRestrict) == 0) && !gpu_ids.empty()) {
+    uint64_t alternate_va = 0;
+    if (!MakeKfdMemoryResident(gpu_ids.size(), &gpu_ids[0], ptr, size, &alternate_va, map_flag_))
+      return nullptr;
+
+    // Pool memory has a single address for the host and all agents.
+    if ((alternate_va != 0) && (alternate_va != reinterpret_cast<uintptr_t>(ptr))) {
+      MakeKfdMemoryUnresident(ptr);
+      return nullptr;
+    }
+  }
+
+  placed_.insert(ptr);
+  registerGuard.Dismiss();
+  hostGuard.Dismiss();
+  return ptr;
+}
+
+bool MemoryRegion::FreePlaced(void* ptr, size_t size) const {
+  if (placed_.erase(ptr) == 0) return false;
+  MakeKfdMemoryUnresident(ptr);
+  DeregisterMemory(ptr);
+  os::FreeHostMemory(ptr, size);
+  return true;
+}
+
 hsa_status_t MemoryRegion::Free(void* address, size_t size) const {
   ScopedAcquire<KernelMutex> lock(&owner()->agent_memory_lock_);
+  allocated_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  if (UseHugePages(size)) huge_page_bytes_.fetch_sub(size, std::memory_order_relaxed);
   return FreeImpl(address, size);
 }
 
 hsa_status_t MemoryRegion::FreeImpl(void* address, size_t size) const {
   if (fragment_allocator_.free(address)) return HSA_STATUS_SUCCESS;
 
+  if (FreePlaced(address, size)) return HSA_STATUS_SUCCESS;
+
   MakeKfdMemoryUnresident(address);
 
   FreeKfdMemory(address, size);
@@ -416,6 +500,12 @@ hsa_status_t MemoryRegion::GetPoolInfo(hsa_amd_memory_pool_info_t attribute,
           *((size_t*)value) = 0;
       }
       break;
+    case HSA_AMD_MEMORY_POOL_INFO_ALLOCATED_SIZE:
+      *((size_t*)value) = allocated_bytes_.load(std::memory_order_relaxed);
+      break;
+    case HSA_AMD_MEMORY_POOL_INFO_HUGE_PAGE_SIZE:
+      *((size_t*)value) = huge_page_bytes_.load(std::memory_order_relaxed);
+      break;
     default:
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   }
@@ -635,15 +725,10 @@ hsa_status_t MemoryRegion::Lock(uint32_t num_agents, const hsa_agent_t* agents,
     return HSA_STATUS_SUCCESS;
   }
 
-  std::set<core::Agent*> whitelist_gpus;
   std::vector<HSAuint32> whitelist_nodes;
   if (num_agents == 0 || agents == NULL) {
     // Map to all GPU agents.
     whitelist_nodes = core::Runtime::runtime_singleton_->gpu_ids();
-
-    whitelist_gpus.insert(
-        core::Runtime::runtime_singleton_->gpu_agents().begin(),
-        core::Runtime::runtime_singleton_->gpu_agents().end());
   } else {
     for (uint32_t i = 0; i < num_agents; ++i) {
       core::Agent* agent = core::Agent::Convert(agents[i]);
@@ -653,7 +738,6 @@ hsa_status_t MemoryRegion::Lock(uint32_t num_agents, const hsa_agent_t* agents,
 
       if (agent->device_type() == core::Agent::kAmdGpuDevice) {
         whitelist_nodes.push_back(agent->node_id());
-        whitelist_gpus.insert(agent);
       }
     }
   }
@@ -665,11 +749,26 @@ hsa_status_t MemoryRegion::Lock(uint32_t num_agents, const hsa_agent_t* agents,
     return HSA_STATUS_SUCCESS;
   }
 
+  if (pinned_cache_.enabled()) {
+    // Cache lookups match node sets by inclusion.
+    std::sort(whitelist_nodes.begin(), whitelist_nodes.end());
+    whitelist_nodes.erase(std::unique(whitelist_nodes.begin(), whitelist_nodes.end()),
+                          whitelist_nodes.end());
+    *agent_ptr = pinned_cache_.Lock(this, host_ptr, size, whitelist_nodes);
+    return (*agent_ptr != nullptr) ? HSA_STATUS_SUCCESS : HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+  }
+
+  return PinAndMap(host_ptr, size, whitelist_nodes, agent_ptr);
+}
+
+hsa_status_t MemoryRegion::PinAndMap(void* host_ptr, size_t size,
+                                     const std::vector<HSAuint32>& nodes,
+                                     void** agent_ptr) const {
   // Call kernel driver to register and pin the memory.
   if (RegisterMemory(host_ptr, size, mem_flag_)) {
     uint64_t alternate_va = 0;
-    if (MakeKfdMemoryResident(whitelist_nodes.size(), &whitelist_nodes[0],
-                              host_ptr, size, &alternate_va, map_flag_)) {
+    if (MakeKfdMemoryResident(nodes.size(), &nodes[0], host_ptr, size, &alternate_va,
+                              map_flag_)) {
       if (alternate_va != 0) {
         *agent_ptr = reinterpret_cast<void*>(alternate_va);
       } else {
@@ -694,6 +793,8 @@ hsa_status_t MemoryRegion::Unlock(void* host_ptr) const {
     return HSA_STATUS_SUCCESS;
   }
 
+  if (pinned_cache_.enabled() && pinned_cache_.Unlock(host_ptr)) return HSA_STATUS_SUCCESS;
+
   MakeKfdMemoryUnresident(host_ptr);
   DeregisterMemory(host_ptr);
 
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/amd_pinned_memory_cache.h"
+
+#include <algorithm>
+
+#include "core/util/counters.h"
+
+namespace rocr {
+namespace AMD {
+
+static const uintptr_t kPageSize = 4096;
+
+void PinnedMemoryCache::budget(size_t bytes) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  budget_ = bytes;
+  Trim();
+}
+
+PinnedMemoryCache::Entry* PinnedMemoryCache::Find(const void* owner, uintptr_t begin,
+                                                  uintptr_t end,
+                                                  const std::vector<uint32_t>& nodes) {
+  // Walk back from the last registration starting at or before begin.  Anything starting more
+  // than max_span_ before begin can not reach it.
+  auto it = entries_.upper_bound(begin);
+  while (it != entries_.begin()) {
+    --it;
+    if (it->first + max_span_ < begin) break;
+    Entry* entry = it->second;
+    if (entry->owner != owner || it->first + entry->size < end) continue;
+    if (std::includes(entry->nodes.begin(), entry->nodes.end(), nodes.begin(), nodes.end()))
+      return entry;
+  }
+  return nullptr;
+}
+
+void* PinnedMemoryCache::Lock(const void* owner, void* host_ptr, size_t size,
+                              const std::vector<uint32_t>& nodes) {
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(host_ptr);
+  const uintptr_t end = begin + size;
+
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  Entry* entry = Find(owner, begin, end, nodes);
+  if (entry != nullptr) {
+    counters::Increment(counters::PinnedCacheHit);
+    if (entry->refcount++ == 0) {
+      idle_.erase(entry->lru);
+      idle_bytes_ -= entry->size;
+    }
+    locks_.insert(std::make_pair(host_ptr, entry));
+    return reinterpret_cast<uint8_t*>(entry->agent_ptr) + (begin - reinterpret_cast<uintptr_t>(entry->host_ptr));
+  }
+
+  counters::Increment(counters::PinnedCacheMiss);
+
+  // Pages may only be registered once, drop idle registrations in the way.
+  FlushRange(begin, end);
+
+  void* agent_ptr = register_(owner, host_ptr, size, nodes);
+  if (agent_ptr == nullptr && !idle_.empty()) {
+    // Pinning may have failed due to cached registrations, release them and retry.
+    FlushRange(0, UINTPTR_MAX);
+    agent_ptr = register_(owner, host_ptr, size, nodes);
+  }
+  if (agent_ptr == nullptr) return nullptr;
+
+  entry = new Entry();
+  entry->owner = owner;
+  entry->host_ptr = host_ptr;
+  entry->size = size;
+  entry->nodes = nodes;
+  entry->agent_ptr = agent_ptr;
+  entry->refcount = 1;
+  entries_.insert(std::make_pair(begin, entry));
+  locks_.insert(std::make_pair(host_ptr, entry));
+  max_span_ = Max(max_span_, size);
+  return agent_ptr;
+}
+
+bool PinnedMemoryCache::Unlock(void* host_ptr) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  auto range = locks_.equal_range(host_ptr);
+  if (range.first == range.second) return false;
+
+  auto last = range.second;
+  --last;
+  Entry* entry = last->second;
+  locks_.erase(last);
+
+  if (--entry->refcount == 0) {
+    idle_.push_front(entry);
+    entry->lru = idle_.begin();
+    idle_bytes_ += entry->size;
+    Trim();
+  }
+  return true;
+}
+
+void PinnedMemoryCache::Flush(const void* ptr, size_t size) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (ptr == nullptr) {
+    FlushRange(0, UINTPTR_MAX);
+    return;
+  }
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+  FlushRange(begin, begin + size);
+}
+
+void PinnedMemoryCache::FlushRange(uintptr_t begin, uintptr_t end) {
+  const uintptr_t page_begin = AlignDown(begin, kPageSize);
+  const uintptr_t page_end = (end > UINTPTR_MAX - kPageSize) ? UINTPTR_MAX : AlignUp(end, kPageSize);
+
+  auto it = entries_.lower_bound((page_begin > max_span_ + kPageSize)
+                                     ? page_begin - max_span_ - kPageSize
+                                     : 0);
+  while (it != entries_.end() && it->first < page_end) {
+    Entry* entry = it->second;
+    const uintptr_t entry_begin = AlignDown(it->first, kPageSize);
+    const uintptr_t entry_end = AlignUp(it->first + entry->size, kPageSize);
+    if (entry->refcount == 0 && entry_begin < page_end && page_begin < entry_end) {
+      auto next = it;
+      ++next;
+      Evict(it);
+      it = next;
+      continue;
+    }
+    ++it;
+  }
+}
+
+void PinnedMemoryCache::Evict(EntryMap::iterator it) {
+  Entry* entry = it->second;
+  assert(entry->refcount == 0 && "Evicting a locked registration.");
+  idle_.erase(entry->lru);
+  idle_bytes_ -= entry->size;
+  entries_.erase(it);
+  deregister_(entry->host_ptr);
+  delete entry;
+}
+
+void PinnedMemoryCache::Trim() {
+  while (idle_bytes_ > budget_) {
+    Entry* entry = idle_.back();
+    auto range = entries_.equal_range(reinterpret_cast<uintptr_t>(entry->host_ptr));
+    auto it = std::find_if(range.first, range.second,
+                           [entry](const EntryMap::value_type& value) {
+                             return value.second == entry;
+                           });
+    assert(it != range.second && "Pinned memory cache inconsistency.");
+    Evict(it);
+  }
+}
+
+}  // namespace AMD
+}  // namespace rocr
@@ -60,7 +60,9 @@
 #include "core/inc/runtime.h"
 #include "core/inc/amd_cpu_agent.h"
 #include "core/inc/amd_gpu_agent.h"
+#include "core/inc/init_profile.h"
 #include "core/inc/amd_memory_region.h"
+#include "core/util/parallel.h"
 #include "core/util/utils.h"
 
 extern r_debug _amdgpu_r_debug;
@@ -114,15 +116,17 @@ CpuAgent* DiscoverCpu(HSAuint32 node_id, HsaNodeProperties& node_prop) {
   return cpu;
 }
 
-GpuAgent* DiscoverGpu(HSAuint32 node_id, HsaNodeProperties& node_prop, bool xnack_mode) {
+// Constructs the GpuAgent for a node without registering it.  Safe to call concurrently for
+// distinct nodes.  The enumeration index is provisional and is fixed up at registration.
+static GpuAgent* CreateGpu(HSAuint32 node_id, HsaNodeProperties& node_prop, bool xnack_mode,
+                           uint32_t index) {
   GpuAgent* gpu = nullptr;
   if (node_prop.NumFComputeCores == 0) {
       // Ignore non GPUs.
       return nullptr;
   }
   try {
-    gpu = new GpuAgent(node_id, node_prop, xnack_mode,
-                       core::Runtime::runtime_singleton_->gpu_agents().size());
+    gpu = new GpuAgent(node_id, node_prop, xnack_mode, index);
 
     const HsaVersionInfo& kfd_version = core::Runtime::runtime_singleton_->KfdVersion().version;
 
@@ -147,8 +151,7 @@ GpuAgent* DiscoverGpu(HSAuint32 node_id, HsaNodeProperties& node_prop, bool xnac
       if (gpu->isa()->GetProcessorName() == "gfx908") {
         node_prop.Capability.ui32.SRAM_EDCSupport = 1;
         delete gpu;
-        gpu = new GpuAgent(node_id, node_prop, xnack_mode,
-                           core::Runtime::runtime_singleton_->gpu_agents().size());
+        gpu = new GpuAgent(node_id, node_prop, xnack_mode, index);
       }
     }
   } catch (const hsa_exception& e) {
@@ -163,7 +166,6 @@ GpuAgent* DiscoverGpu(HSAuint32 node_id, HsaNodeProperties& node_prop, bool xnac
       throw;
     }
   }
-  core::Runtime::runtime_singleton_->RegisterAgent(gpu);
   return gpu;
 }
 
@@ -240,26 +242,52 @@ void RegisterLinkInfo(uint32_t node_id, uint32_t num_link) {
 }
 
 /**
- * Process the list of Gpus that are surfaced to user
+ * Process the list of Gpus that are surfaced to user.  Agent construction is
+ * independent per node and runs on a bounded set of threads.  Registration is
+ * done serially afterwards in list order so that enumeration order continues
+ * to follow the user visible (ROCR_VISIBLE_DEVICES) ranking.
  */
 static void SurfaceGpuList(std::vector<int32_t>& gpu_list, bool xnack_mode) {
   // Process user visible Gpu devices
   int32_t invalidIdx = -1;
-  int32_t list_sz = gpu_list.size();
-  HsaNodeProperties node_prop = {0};
-  for (int32_t idx = 0; idx < list_sz; idx++) {
-    if (gpu_list[idx] == invalidIdx) {
+  std::vector<HSAuint32> nodes;
+  std::vector<HsaNodeProperties> node_props;
+  for (int32_t node : gpu_list) {
+    if (node == invalidIdx) {
       break;
     }
 
     // Obtain properties of the node
-    HSAKMT_STATUS err_val = hsaKmtGetNodeProperties(gpu_list[idx], &node_prop);
+    HsaNodeProperties node_prop = {0};
+    HSAKMT_STATUS err_val = hsaKmtGetNodeProperties(node, &node_prop);
     assert(err_val == HSAKMT_STATUS_SUCCESS && "Error in getting Node Properties");
 
     // Instantiate a Gpu device. The IO links
     // of this node have already been registered
     assert((node_prop.NumFComputeCores != 0) && "Improper node used for GPU device discovery.");
-    DiscoverGpu(gpu_list[idx], node_prop, xnack_mode);
+    nodes.push_back(node);
+    node_props.push_back(node_prop);
+  }
+
+  core::InitProfile::Phase phase("GPU agent discovery");
+  std::vector<GpuAgent*> gpus(nodes.size(), nullptr);
+  // Release agents which were not registered if discovery fails part way.
+  MAKE_SCOPE_GUARD([&]() {
+    for (GpuAgent* gpu : gpus) delete gpu;
+  });
+
+  ParallelFor(nodes.size(), core::Runtime::runtime_singleton_->flag().init_threads(),
+              [&](size_t idx) {
+                core::InitProfile::Phase gpu_phase("GPU agent construction", nodes[idx], &phase);
+                gpus[idx] = CreateGpu(nodes[idx], node_props[idx], xnack_mode, idx);
+              });
+
+  // Register in rank order, skipping unsupported devices.
+  for (GpuAgent*& gpu : gpus) {
+    if (gpu == nullptr) continue;
+    gpu->enumeration_index(core::Runtime::runtime_singleton_->gpu_agents().size());
+    core::Runtime::runtime_singleton_->RegisterAgent(gpu);
+    gpu = nullptr;
   }
 }
 
@@ -310,6 +338,7 @@ void BuildTopology() {
   }
 
   // Discover agents on every node in the platform.
+  core::InitProfile::Phase cpu_phase("CPU and link discovery");
   int32_t kfdIdx = 0;
   for (HSAuint32 node_id = 0; node_id < props.NumNodes; node_id++) {
     HsaNodeProperties node_prop = {0};
@@ -343,6 +372,8 @@ void BuildTopology() {
     RegisterLinkInfo(node_id, node_prop.NumIOLinks);
   }
 
+  cpu_phase.End();
+
   // Determine the Xnack mode to be bound for system
   bool xnack_mode = BindXnackMode();
 
@@ -358,10 +389,14 @@ void BuildTopology() {
     maxCu = Max(maxCu, cus);
   }
   const_cast<Flag&>(core::Runtime::runtime_singleton_->flag()).parse_masks(maxGpu, maxCu);
+
+  for (auto& gpu : core::Runtime::runtime_singleton_->gpu_agents())
+    static_cast<GpuAgent*>(gpu)->InitCUMask();
 }
 
 bool Load() {
   // Open connection to kernel driver.
+  core::InitProfile::Phase kfd_phase("KFD open");
   if (hsaKmtOpenKFD() != HSAKMT_STATUS_SUCCESS) {
     return false;
   }
@@ -373,7 +408,10 @@ bool Load() {
   if ((err != HSAKMT_STATUS_SUCCESS) && (err != HSAKMT_STATUS_NOT_SUPPORTED)) return false;
   core::Runtime::runtime_singleton_->KfdVersion(err != HSAKMT_STATUS_NOT_SUPPORTED);
 
+  kfd_phase.End();
+
   // Build topology table.
+  core::InitProfile::Phase topology_phase("topology");
   BuildTopology();
 
   kfd.Dismiss();
@@ -41,6 +41,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "core/inc/default_signal.h"
+#include "core/inc/runtime.h"
 #include "core/util/timer.h"
 
 namespace rocr {
@@ -91,8 +92,8 @@ hsa_signal_value_t BusyWaitSignal::WaitRelaxed(hsa_signal_condition_t condition,
   start_time = timer::fast_clock::now();
 
   // Set a polling timeout value
-  // Should be a few times bigger than null kernel latency
-  const timer::fast_clock::duration kMaxElapsed = std::chrono::microseconds(200);
+  const timer::fast_clock::duration kMaxElapsed =
+      std::chrono::microseconds(core::Runtime::runtime_singleton_->flag().signal_wait_spin_us());
 
   uint64_t hsa_freq;
   HSA::hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &hsa_freq);
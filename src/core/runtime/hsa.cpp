@@ -49,7 +49,9 @@
 
 #include "core/inc/runtime.h"
 #include "core/inc/agent.h"
+#include "core/inc/amd_gpu_agent.h"
 #include "core/inc/host_queue.h"
+#include "core/inc/intercept_queue.h"
 #include "core/inc/isa.h"
 #include "core/inc/memory_region.h"
 #include "core/inc/queue.h"
@@ -719,6 +721,17 @@ hsa_status_t hsa_queue_create(
   if (status != HSA_STATUS_SUCCESS) return status;
 
   assert(cmd_queue != nullptr && "Queue not returned but status was success.\n");
+
+  // Cooperative queues are shared between callers and can not be wrapped.
+  if (core::Runtime::runtime_singleton_->flag().queue_latency_stats() &&
+      agent->device_type() == core::Agent::kAmdGpuDevice && type != HSA_QUEUE_TYPE_COOPERATIVE) {
+    std::unique_ptr<core::Queue> lowerQueue(cmd_queue);
+    std::unique_ptr<core::InterceptQueue> upperQueue(
+        new core::InterceptQueue(std::move(lowerQueue)));
+    upperQueue->EnableLatencyStats(static_cast<AMD::GpuAgentInt*>(agent));
+    cmd_queue = upperQueue.release();
+  }
+
   *queue = core::Queue::Convert(cmd_queue);
   return status;
 
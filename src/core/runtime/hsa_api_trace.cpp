@@ -395,6 +395,18 @@ void HsaApiTable::UpdateAmdExts() {
   amd_ext_api.hsa_amd_svm_attributes_set_fn = AMD::hsa_amd_svm_attributes_set;
   amd_ext_api.hsa_amd_svm_attributes_get_fn = AMD::hsa_amd_svm_attributes_get;
   amd_ext_api.hsa_amd_svm_prefetch_async_fn = AMD::hsa_amd_svm_prefetch_async;
+  amd_ext_api.hsa_amd_runtime_counters_enable_fn = AMD::hsa_amd_runtime_counters_enable;
+  amd_ext_api.hsa_amd_runtime_counters_get_fn = AMD::hsa_amd_runtime_counters_get;
+  amd_ext_api.hsa_amd_runtime_counters_get_histogram_fn = AMD::hsa_amd_runtime_counters_get_histogram;
+  amd_ext_api.hsa_amd_runtime_counters_reset_fn = AMD::hsa_amd_runtime_counters_reset;
+  amd_ext_api.hsa_amd_profiling_convert_ticks_to_system_domain_fn = AMD::hsa_amd_profiling_convert_ticks_to_system_domain;
+  amd_ext_api.hsa_amd_queue_latency_get_histogram_fn = AMD::hsa_amd_queue_latency_get_histogram;
+  amd_ext_api.hsa_amd_runtime_config_set_fn = AMD::hsa_amd_runtime_config_set;
+  amd_ext_api.hsa_amd_runtime_config_get_fn = AMD::hsa_amd_runtime_config_get;
+  amd_ext_api.hsa_amd_memory_lock_cache_flush_fn = AMD::hsa_amd_memory_lock_cache_flush;
+  amd_ext_api.hsa_amd_memory_fill_async_fn = AMD::hsa_amd_memory_fill_async;
+  amd_ext_api.hsa_amd_queue_cu_set_mask_batch_fn = AMD::hsa_amd_queue_cu_set_mask_batch;
+  amd_ext_api.hsa_amd_executable_get_kernel_dispatch_info_fn = AMD::hsa_amd_executable_get_kernel_dispatch_info;
 }
 
 void LoadInitialHsaApiTable() {
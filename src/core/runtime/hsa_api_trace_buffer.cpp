@@ -0,0 +1,544 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/hsa_api_trace_buffer.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <list>
+
+#include "core/util/locks.h"
+#include "core/util/os.h"
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace core {
+
+// Generated from the CoreApiTable and AmdExtTable definitions in inc/hsa_api_trace.h.
+// Order must match the tables.
+#define HSA_CORE_API_LIST(X) \
+  X(hsa_init) \
+  X(hsa_shut_down) \
+  X(hsa_system_get_info) \
+  X(hsa_system_extension_supported) \
+  X(hsa_system_get_extension_table) \
+  X(hsa_iterate_agents) \
+  X(hsa_agent_get_info) \
+  X(hsa_queue_create) \
+  X(hsa_soft_queue_create) \
+  X(hsa_queue_destroy) \
+  X(hsa_queue_inactivate) \
+  X(hsa_queue_load_read_index_scacquire) \
+  X(hsa_queue_load_read_index_relaxed) \
+  X(hsa_queue_load_write_index_scacquire) \
+  X(hsa_queue_load_write_index_relaxed) \
+  X(hsa_queue_store_write_index_relaxed) \
+  X(hsa_queue_store_write_index_screlease) \
+  X(hsa_queue_cas_write_index_scacq_screl) \
+  X(hsa_queue_cas_write_index_scacquire) \
+  X(hsa_queue_cas_write_index_relaxed) \
+  X(hsa_queue_cas_write_index_screlease) \
+  X(hsa_queue_add_write_index_scacq_screl) \
+  X(hsa_queue_add_write_index_scacquire) \
+  X(hsa_queue_add_write_index_relaxed) \
+  X(hsa_queue_add_write_index_screlease) \
+  X(hsa_queue_store_read_index_relaxed) \
+  X(hsa_queue_store_read_index_screlease) \
+  X(hsa_agent_iterate_regions) \
+  X(hsa_region_get_info) \
+  X(hsa_agent_get_exception_policies) \
+  X(hsa_agent_extension_supported) \
+  X(hsa_memory_register) \
+  X(hsa_memory_deregister) \
+  X(hsa_memory_allocate) \
+  X(hsa_memory_free) \
+  X(hsa_memory_copy) \
+  X(hsa_memory_assign_agent) \
+  X(hsa_signal_create) \
+  X(hsa_signal_destroy) \
+  X(hsa_signal_load_relaxed) \
+  X(hsa_signal_load_scacquire) \
+  X(hsa_signal_store_relaxed) \
+  X(hsa_signal_store_screlease) \
+  X(hsa_signal_wait_relaxed) \
+  X(hsa_signal_wait_scacquire) \
+  X(hsa_signal_and_relaxed) \
+  X(hsa_signal_and_scacquire) \
+  X(hsa_signal_and_screlease) \
+  X(hsa_signal_and_scacq_screl) \
+  X(hsa_signal_or_relaxed) \
+  X(hsa_signal_or_scacquire) \
+  X(hsa_signal_or_screlease) \
+  X(hsa_signal_or_scacq_screl) \
+  X(hsa_signal_xor_relaxed) \
+  X(hsa_signal_xor_scacquire) \
+  X(hsa_signal_xor_screlease) \
+  X(hsa_signal_xor_scacq_screl) \
+  X(hsa_signal_exchange_relaxed) \
+  X(hsa_signal_exchange_scacquire) \
+  X(hsa_signal_exchange_screlease) \
+  X(hsa_signal_exchange_scacq_screl) \
+  X(hsa_signal_add_relaxed) \
+  X(hsa_signal_add_scacquire) \
+  X(hsa_signal_add_screlease) \
+  X(hsa_signal_add_scacq_screl) \
+  X(hsa_signal_subtract_relaxed) \
+  X(hsa_signal_subtract_scacquire) \
+  X(hsa_signal_subtract_screlease) \
+  X(hsa_signal_subtract_scacq_screl) \
+  X(hsa_signal_cas_relaxed) \
+  X(hsa_signal_cas_scacquire) \
+  X(hsa_signal_cas_screlease) \
+  X(hsa_signal_cas_scacq_screl) \
+  X(hsa_isa_from_name) \
+  X(hsa_isa_get_info) \
+  X(hsa_isa_compatible) \
+  X(hsa_code_object_serialize) \
+  X(hsa_code_object_deserialize) \
+  X(hsa_code_object_destroy) \
+  X(hsa_code_object_get_info) \
+  X(hsa_code_object_get_symbol) \
+  X(hsa_code_symbol_get_info) \
+  X(hsa_code_object_iterate_symbols) \
+  X(hsa_executable_create) \
+  X(hsa_executable_destroy) \
+  X(hsa_executable_load_code_object) \
+  X(hsa_executable_freeze) \
+  X(hsa_executable_get_info) \
+  X(hsa_executable_global_variable_define) \
+  X(hsa_executable_agent_global_variable_define) \
+  X(hsa_executable_readonly_variable_define) \
+  X(hsa_executable_validate) \
+  X(hsa_executable_get_symbol) \
+  X(hsa_executable_symbol_get_info) \
+  X(hsa_executable_iterate_symbols) \
+  X(hsa_status_string) \
+  X(hsa_extension_get_name) \
+  X(hsa_system_major_extension_supported) \
+  X(hsa_system_get_major_extension_table) \
+  X(hsa_agent_major_extension_supported) \
+  X(hsa_cache_get_info) \
+  X(hsa_agent_iterate_caches) \
+  X(hsa_signal_silent_store_relaxed) \
+  X(hsa_signal_silent_store_screlease) \
+  X(hsa_signal_group_create) \
+  X(hsa_signal_group_destroy) \
+  X(hsa_signal_group_wait_any_scacquire) \
+  X(hsa_signal_group_wait_any_relaxed) \
+  X(hsa_agent_iterate_isas) \
+  X(hsa_isa_get_info_alt) \
+  X(hsa_isa_get_exception_policies) \
+  X(hsa_isa_get_round_method) \
+  X(hsa_wavefront_get_info) \
+  X(hsa_isa_iterate_wavefronts) \
+  X(hsa_code_object_get_symbol_from_name) \
+  X(hsa_code_object_reader_create_from_file) \
+  X(hsa_code_object_reader_create_from_memory) \
+  X(hsa_code_object_reader_destroy) \
+  X(hsa_executable_create_alt) \
+  X(hsa_executable_load_program_code_object) \
+  X(hsa_executable_load_agent_code_object) \
+  X(hsa_executable_validate_alt) \
+  X(hsa_executable_get_symbol_by_name) \
+  X(hsa_executable_iterate_agent_symbols) \
+  X(hsa_executable_iterate_program_symbols)
+
+#define HSA_AMD_EXT_API_LIST(X) \
+  X(hsa_amd_coherency_get_type) \
+  X(hsa_amd_coherency_set_type) \
+  X(hsa_amd_profiling_set_profiler_enabled) \
+  X(hsa_amd_profiling_async_copy_enable) \
+  X(hsa_amd_profiling_get_dispatch_time) \
+  X(hsa_amd_profiling_get_async_copy_time) \
+  X(hsa_amd_profiling_convert_tick_to_system_domain) \
+  X(hsa_amd_signal_async_handler) \
+  X(hsa_amd_async_function) \
+  X(hsa_amd_signal_wait_any) \
+  X(hsa_amd_queue_cu_set_mask) \
+  X(hsa_amd_memory_pool_get_info) \
+  X(hsa_amd_agent_iterate_memory_pools) \
+  X(hsa_amd_memory_pool_allocate) \
+  X(hsa_amd_memory_pool_free) \
+  X(hsa_amd_memory_async_copy) \
+  X(hsa_amd_agent_memory_pool_get_info) \
+  X(hsa_amd_agents_allow_access) \
+  X(hsa_amd_memory_pool_can_migrate) \
+  X(hsa_amd_memory_migrate) \
+  X(hsa_amd_memory_lock) \
+  X(hsa_amd_memory_unlock) \
+  X(hsa_amd_memory_fill) \
+  X(hsa_amd_interop_map_buffer) \
+  X(hsa_amd_interop_unmap_buffer) \
+  X(hsa_amd_image_create) \
+  X(hsa_amd_pointer_info) \
+  X(hsa_amd_pointer_info_set_userdata) \
+  X(hsa_amd_ipc_memory_create) \
+  X(hsa_amd_ipc_memory_attach) \
+  X(hsa_amd_ipc_memory_detach) \
+  X(hsa_amd_signal_create) \
+  X(hsa_amd_ipc_signal_create) \
+  X(hsa_amd_ipc_signal_attach) \
+  X(hsa_amd_register_system_event_handler) \
+  X(hsa_amd_queue_intercept_create) \
+  X(hsa_amd_queue_intercept_register) \
+  X(hsa_amd_queue_set_priority) \
+  X(hsa_amd_memory_async_copy_rect) \
+  X(hsa_amd_runtime_queue_create_register) \
+  X(hsa_amd_memory_lock_to_pool) \
+  X(hsa_amd_register_deallocation_callback) \
+  X(hsa_amd_deregister_deallocation_callback) \
+  X(hsa_amd_signal_value_pointer) \
+  X(hsa_amd_svm_attributes_set) \
+  X(hsa_amd_svm_attributes_get) \
+  X(hsa_amd_svm_prefetch_async) \
+  X(hsa_amd_queue_cu_get_mask) \
+  X(hsa_amd_runtime_counters_enable) \
+  X(hsa_amd_runtime_counters_get) \
+  X(hsa_amd_runtime_counters_get_histogram) \
+  X(hsa_amd_runtime_counters_reset) \
+  X(hsa_amd_profiling_convert_ticks_to_system_domain) \
+  X(hsa_amd_queue_latency_get_histogram) \
+  X(hsa_amd_runtime_config_set) \
+  X(hsa_amd_runtime_config_get) \
+  X(hsa_amd_memory_lock_cache_flush) \
+  X(hsa_amd_memory_fill_async) \
+  X(hsa_amd_queue_cu_set_mask_batch) \
+  X(hsa_amd_executable_get_kernel_dispatch_info)
+
+#define HSA_API_ID(name) ApiId_##name,
+enum ApiId : uint32_t {
+  HSA_CORE_API_LIST(HSA_API_ID)
+  HSA_AMD_EXT_API_LIST(HSA_API_ID)
+  ApiIdCount
+};
+#undef HSA_API_ID
+
+// The lists must match the API tables entry for entry so that ids follow table order.
+#define HSA_API_COUNT(name) +1
+static const uint32_t kCoreApiCount = 0 HSA_CORE_API_LIST(HSA_API_COUNT);
+static const uint32_t kAmdExtApiCount = 0 HSA_AMD_EXT_API_LIST(HSA_API_COUNT);
+#undef HSA_API_COUNT
+
+static_assert(sizeof(CoreApiTable) == sizeof(ApiTableVersion) + kCoreApiCount * sizeof(void*),
+              "HSA_CORE_API_LIST does not cover CoreApiTable.");
+static_assert(sizeof(AmdExtTable) == sizeof(ApiTableVersion) + kAmdExtApiCount * sizeof(void*),
+              "HSA_AMD_EXT_API_LIST does not cover AmdExtTable.");
+
+#define HSA_CHECK_CORE(name)                                                                     \
+  static_assert(offsetof(CoreApiTable, name##_fn) ==                                             \
+                    sizeof(ApiTableVersion) + ApiId_##name * sizeof(void*),                      \
+                "HSA_CORE_API_LIST is not in CoreApiTable order at " #name);
+#define HSA_CHECK_AMD_EXT(name)                                                                  \
+  static_assert(offsetof(AmdExtTable, name##_fn) ==                                              \
+                    sizeof(ApiTableVersion) + (ApiId_##name - kCoreApiCount) * sizeof(void*),    \
+                "HSA_AMD_EXT_API_LIST is not in AmdExtTable order at " #name);
+HSA_CORE_API_LIST(HSA_CHECK_CORE)
+HSA_AMD_EXT_API_LIST(HSA_CHECK_AMD_EXT)
+#undef HSA_CHECK_CORE
+#undef HSA_CHECK_AMD_EXT
+
+#define HSA_API_NAME(name) #name,
+static const char* const api_names[ApiIdCount] = {HSA_CORE_API_LIST(HSA_API_NAME)
+                                                      HSA_AMD_EXT_API_LIST(HSA_API_NAME)};
+#undef HSA_API_NAME
+
+namespace {
+
+// Single producer (the owning thread), single consumer (the writer thread) ring of records.
+class ApiTraceBuffer {
+ public:
+  static const uint64_t kCapacity = 8192;
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "Trace buffer capacity must be a power of two.");
+
+  explicit ApiTraceBuffer(uint32_t thread_id)
+      : head_(0), tail_(0), dropped_(0), retired_(false), thread_id_(thread_id) {}
+
+  __forceinline void Push(uint32_t api_id, uint64_t start, uint64_t end, uint64_t arg,
+                          uint64_t ret) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= kCapacity) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    ApiTraceRecord& record = records_[head & (kCapacity - 1)];
+    record.api_id = api_id;
+    record.thread_id = thread_id_;
+    record.start = start;
+    record.end = end;
+    record.arg = arg;
+    record.ret = ret;
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  // Write all published records to file.  Called only by the writer.
+  void Drain(FILE* file) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (tail != head) {
+      uint64_t index = tail & (kCapacity - 1);
+      uint64_t count = Min(head - tail, kCapacity - index);
+      fwrite(&records_[index], sizeof(ApiTraceRecord), count, file);
+      tail += count;
+    }
+    tail_.store(tail, std::memory_order_release);
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+  void Retire() { retired_.store(true, std::memory_order_release); }
+
+  bool Retired() const { return retired_.load(std::memory_order_acquire); }
+
+ private:
+  ApiTraceRecord records_[kCapacity];
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<bool> retired_;
+  const uint32_t thread_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ApiTraceBuffer);
+};
+
+// Writer state.  Buffers outlive Start/Stop cycles since live threads keep pointers to them;
+// buffers are only freed after their thread has exited and they have been drained.
+struct ApiTraceState {
+  KernelMutex lock;  // Guards buffers and file.
+  std::list<ApiTraceBuffer*> buffers;
+  FILE* file;
+  os::Thread writer;
+  os::EventHandle wake;
+  std::atomic<bool> stopping;
+  std::atomic<uint32_t> next_thread_id;
+  uint64_t dropped;
+};
+
+// Never destroyed, threads may retire their buffers during process exit.
+ApiTraceState* const state_ = new ApiTraceState();
+
+__forceinline ApiTraceState& State() { return *state_; }
+
+// Marks the calling thread's buffer for release when the thread exits.
+struct ApiTraceBufferOwner {
+  ApiTraceBuffer* buffer;
+  ~ApiTraceBufferOwner() {
+    if (buffer != nullptr) buffer->Retire();
+  }
+};
+
+static thread_local ApiTraceBufferOwner local_buffer = {nullptr};
+
+ApiTraceBuffer* CreateLocalBuffer() {
+  ApiTraceState& state = State();
+  ApiTraceBuffer* buffer =
+      new ApiTraceBuffer(state.next_thread_id.fetch_add(1, std::memory_order_relaxed));
+  ScopedAcquire<KernelMutex> lock(&state.lock);
+  state.buffers.push_back(buffer);
+  local_buffer.buffer = buffer;
+  return buffer;
+}
+
+__forceinline ApiTraceBuffer* LocalBuffer() {
+  ApiTraceBuffer* buffer = local_buffer.buffer;
+  if (buffer == nullptr) buffer = CreateLocalBuffer();
+  return buffer;
+}
+
+// Drain every buffer and release those whose thread has exited.  Requires state.lock.
+void DrainAll(ApiTraceState& state) {
+  for (auto it = state.buffers.begin(); it != state.buffers.end();) {
+    ApiTraceBuffer* buffer = *it;
+    // Check before draining so that records published before retirement are not lost.
+    bool retired = buffer->Retired();
+    buffer->Drain(state.file);
+    state.dropped += buffer->TakeDropped();
+    if (retired) {
+      delete buffer;
+      it = state.buffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  fflush(state.file);
+}
+
+void WriterLoop(void*) {
+  static const uint32_t kFlushPeriodMs = 100;
+  ApiTraceState& state = State();
+  while (!state.stopping.load(std::memory_order_acquire)) {
+    os::WaitForOsEvent(state.wake, kFlushPeriodMs);
+    ScopedAcquire<KernelMutex> lock(&state.lock);
+    DrainAll(state);
+  }
+}
+
+template <typename T> __forceinline uint64_t TraceValue(const T& value) {
+  uint64_t ret = 0;
+  memcpy(&ret, &value, Min(sizeof(T), sizeof(ret)));
+  return ret;
+}
+
+__forceinline uint64_t FirstArg() { return 0; }
+
+template <typename T, typename... Rest>
+__forceinline uint64_t FirstArg(const T& first, const Rest&...) {
+  return TraceValue(first);
+}
+
+// Thin wrapper for each API.  original holds the table entry which was replaced.
+template <uint32_t id, typename Fn> struct ApiTracer;
+
+template <uint32_t id, typename R, typename... Args> struct ApiTracer<id, R (*)(Args...)> {
+  static R (*original)(Args...);
+
+  static R Call(Args... args) {
+    uint64_t start = os::ReadAccurateClock();
+    R ret = original(args...);
+    LocalBuffer()->Push(id, start, os::ReadAccurateClock(), FirstArg(args...), TraceValue(ret));
+    return ret;
+  }
+};
+
+template <uint32_t id, typename... Args> struct ApiTracer<id, void (*)(Args...)> {
+  static void (*original)(Args...);
+
+  static void Call(Args... args) {
+    uint64_t start = os::ReadAccurateClock();
+    original(args...);
+    LocalBuffer()->Push(id, start, os::ReadAccurateClock(), FirstArg(args...), 0);
+  }
+};
+
+template <uint32_t id, typename R, typename... Args>
+R (*ApiTracer<id, R (*)(Args...)>::original)(Args...) = nullptr;
+
+template <uint32_t id, typename... Args>
+void (*ApiTracer<id, void (*)(Args...)>::original)(Args...) = nullptr;
+
+template <uint32_t id, typename Fn> void Install(Fn& entry) {
+  if (entry == nullptr) return;
+  ApiTracer<id, Fn>::original = entry;
+  entry = ApiTracer<id, Fn>::Call;
+}
+
+}  // namespace
+
+bool StartApiTrace(const std::string& path, HsaApiTable& table) {
+  ApiTraceState& state = State();
+  ScopedAcquire<KernelMutex> lock(&state.lock);
+  if (state.file != nullptr) return true;
+
+  state.file = fopen(path.c_str(), "wb");
+  if (state.file == nullptr) return false;
+  MAKE_NAMED_SCOPE_GUARD(fileGuard, [&]() {
+    fclose(state.file);
+    state.file = nullptr;
+  });
+
+  ApiTraceHeader header;
+  memcpy(header.magic, "HSATRACE", sizeof(header.magic));
+  header.version = kApiTraceVersion;
+  header.api_count = ApiIdCount;
+  header.timestamp_frequency = os::AccurateClockFrequency();
+  fwrite(&header, sizeof(header), 1, state.file);
+  for (uint32_t id = 0; id < ApiIdCount; id++) {
+    uint32_t length = strlen(api_names[id]);
+    fwrite(&id, sizeof(id), 1, state.file);
+    fwrite(&length, sizeof(length), 1, state.file);
+    fwrite(api_names[id], 1, length, state.file);
+  }
+
+  state.wake = os::CreateOsEvent(false, false);
+  if (state.wake == nullptr) return false;
+  state.stopping.store(false, std::memory_order_relaxed);
+  state.dropped = 0;
+  state.writer = os::CreateThread(WriterLoop, nullptr);
+  if (state.writer == nullptr) {
+    os::DestroyOsEvent(state.wake);
+    state.wake = nullptr;
+    return false;
+  }
+  fileGuard.Dismiss();
+
+  // Runtime init and shutdown are not traced as the trace state is not valid across them.
+#define HSA_INSTALL_CORE(name) \
+  if (ApiId_##name != ApiId_hsa_init && ApiId_##name != ApiId_hsa_shut_down) \
+    Install<ApiId_##name>(table.core_api.name##_fn);
+#define HSA_INSTALL_AMD_EXT(name) Install<ApiId_##name>(table.amd_ext_api.name##_fn);
+  HSA_CORE_API_LIST(HSA_INSTALL_CORE)
+  HSA_AMD_EXT_API_LIST(HSA_INSTALL_AMD_EXT)
+#undef HSA_INSTALL_CORE
+#undef HSA_INSTALL_AMD_EXT
+
+  return true;
+}
+
+void StopApiTrace() {
+  ApiTraceState& state = State();
+  if (state.writer == nullptr) return;
+
+  state.stopping.store(true, std::memory_order_release);
+  os::SetOsEvent(state.wake);
+  os::WaitForThread(state.writer);
+  os::CloseThread(state.writer);
+  os::DestroyOsEvent(state.wake);
+  state.writer = nullptr;
+  state.wake = nullptr;
+
+  ScopedAcquire<KernelMutex> lock(&state.lock);
+  DrainAll(state);
+  if (state.dropped != 0)
+    fprintf(stderr, "HSA API trace: %lu records dropped, trace buffers were full.\n",
+            (unsigned long)state.dropped);
+  fclose(state.file);
+  state.file = nullptr;
+}
+
+}  // namespace core
+}  // namespace rocr
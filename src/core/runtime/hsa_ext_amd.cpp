@@ -60,6 +60,7 @@
 #include "core/inc/ipc_signal.h"
 #include "core/inc/intercept_queue.h"
 #include "core/inc/exceptions.h"
+#include "core/util/counters.h"
 
 namespace rocr {
 
@@ -332,6 +333,9 @@ hsa_status_t hsa_amd_profiling_async_copy_enable(bool enable) {
   TRY;
   IS_OPEN();
 
+  // The timeline needs copy timestamps for as long as it is collected.
+  enable |= core::Runtime::runtime_singleton_->timeline_enabled();
+
   hsa_status_t ret = HSA_STATUS_SUCCESS;
   for (core::Agent* agent : core::Runtime::runtime_singleton_->gpu_agents()) {
     hsa_status_t err = agent->profiling_enabled(enable);
@@ -936,6 +940,12 @@ hsa_status_t hsa_amd_queue_intercept_create(
   hsa_status_t err = HSA::hsa_queue_create(agent_handle, size, type, callback, data,
                                            private_segment_size, group_segment_size, &lower_queue);
   if (err != HSA_STATUS_SUCCESS) return err;
+  // Queues collecting latency stats are already interceptible.
+  if (core::InterceptQueue::IsType(core::Queue::Convert(lower_queue))) {
+    *queue = lower_queue;
+    return HSA_STATUS_SUCCESS;
+  }
+
   std::unique_ptr<core::Queue> lowerQueue(core::Queue::Convert(lower_queue));
 
   std::unique_ptr<core::InterceptQueue> upperQueue(new core::InterceptQueue(std::move(lowerQueue)));
@@ -1059,5 +1069,171 @@ hsa_status_t hsa_amd_svm_prefetch_async(void* ptr, size_t size, hsa_agent_t agen
   CATCH;
 }
 
+hsa_status_t hsa_amd_runtime_counters_enable(bool enable) {
+  TRY;
+  IS_OPEN();
+  counters::Enable(enable);
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_runtime_counters_get(uint32_t num_counters, uint64_t* values) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(values);
+  for (uint32_t i = 0; i < num_counters; i++)
+    values[i] = (i < counters::CounterCount) ? counters::Read(counters::Counter(i)) : 0;
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_runtime_counters_get_histogram(hsa_amd_runtime_histogram_t histogram,
+                                                    uint32_t num_buckets, uint64_t* buckets) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(buckets);
+  if (uint32_t(histogram) >= counters::HistogramCount) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  counters::Read(counters::Histogram(histogram), num_buckets, buckets);
+  for (uint32_t i = counters::kHistogramBuckets; i < num_buckets; i++) buckets[i] = 0;
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_runtime_counters_reset() {
+  TRY;
+  IS_OPEN();
+  counters::Reset();
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_profiling_convert_ticks_to_system_domain(hsa_agent_t agent_handle, uint32_t count,
+                                                              const uint64_t* agent_ticks, uint64_t* system_ticks) {
+  TRY;
+  IS_OPEN();
+
+  IS_BAD_PTR(agent_ticks);
+  IS_BAD_PTR(system_ticks);
+
+  core::Agent* agent = core::Agent::Convert(agent_handle);
+
+  IS_VALID(agent);
+
+  if (agent->device_type() != core::Agent::kAmdGpuDevice) {
+    return HSA_STATUS_ERROR_INVALID_AGENT;
+  }
+
+  AMD::GpuAgentInt* gpu_agent = static_cast<AMD::GpuAgentInt*>(agent);
+
+  gpu_agent->TranslateTime(agent_ticks, system_ticks, count);
+
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_queue_latency_get_histogram(const hsa_queue_t* queue, hsa_amd_queue_latency_t latency,
+                                                 uint32_t num_buckets, uint64_t* buckets) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(buckets);
+  if (latency > HSA_AMD_QUEUE_LATENCY_START_TO_END) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+
+  core::Queue* cmd_queue = core::Queue::Convert(queue);
+  IS_VALID(cmd_queue);
+  if (!core::InterceptQueue::IsType(cmd_queue)) return HSA_STATUS_ERROR_INVALID_QUEUE;
+
+  const core::QueueLatencyStats* stats =
+      static_cast<core::InterceptQueue*>(cmd_queue)->latency_stats();
+  if (stats == nullptr) return HSA_STATUS_ERROR_INVALID_QUEUE;
+
+  stats->Read(core::QueueLatencyStats::Latency(latency), num_buckets, buckets);
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_runtime_config_set(const char* name, uint64_t value) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(name);
+  return core::Runtime::runtime_singleton_->SetTunable(name, value);
+  CATCH;
+}
+
+hsa_status_t hsa_amd_runtime_config_get(const char* name, uint64_t* value) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(name);
+  IS_BAD_PTR(value);
+  return core::Runtime::runtime_singleton_->flag().GetTunable(name, value);
+  CATCH;
+}
+
+hsa_status_t hsa_amd_memory_lock_cache_flush(void* host_ptr, size_t size) {
+  TRY;
+  IS_OPEN();
+  AMD::MemoryRegion::FlushPinnedCache(host_ptr, size);
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_memory_fill_async(void* ptr, uint32_t value, size_t count,
+                                       uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
+                                       hsa_signal_t completion_signal) {
+  TRY;
+  IS_OPEN();
+
+  if ((ptr == nullptr) || (uintptr_t(ptr) % 4 != 0) ||
+      ((num_dep_signals != 0) && (dep_signals == nullptr))) {
+    return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  return core::Runtime::runtime_singleton_->FillMemoryAsync(ptr, value, count, num_dep_signals,
+                                                            dep_signals, completion_signal);
+  CATCH;
+}
+
+hsa_status_t hsa_amd_queue_cu_set_mask_batch(uint32_t num_queues, const hsa_queue_t* const* queues,
+                                             uint32_t num_cu_mask_count, const uint32_t* cu_mask) {
+  TRY;
+  IS_OPEN();
+
+  if (num_queues != 0) IS_BAD_PTR(queues);
+  if (num_cu_mask_count != 0) IS_BAD_PTR(cu_mask);
+  if (num_cu_mask_count % 32 != 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+
+  for (uint32_t i = 0; i < num_queues; i++) {
+    core::Queue* cmd_queue = core::Queue::Convert(queues[i]);
+    IS_VALID(cmd_queue);
+  }
+
+  bool reduced = false;
+  for (uint32_t i = 0; i < num_queues; i++) {
+    hsa_status_t err =
+        core::Queue::Convert(queues[i])->SetCUMasking(num_cu_mask_count, cu_mask);
+    if (err == (hsa_status_t)HSA_STATUS_CU_MASK_REDUCED)
+      reduced = true;
+    else if (err != HSA_STATUS_SUCCESS)
+      return err;
+  }
+  return reduced ? (hsa_status_t)HSA_STATUS_CU_MASK_REDUCED : HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
+hsa_status_t hsa_amd_executable_get_kernel_dispatch_info(hsa_executable_t executable, uint32_t* num_kernels,
+                                                         hsa_amd_kernel_dispatch_info_t* kernels) {
+  TRY;
+  IS_OPEN();
+  IS_BAD_PTR(num_kernels);
+
+  amd::hsa::loader::Executable* exec = amd::hsa::loader::Executable::Object(executable);
+  if (!exec) {
+    return HSA_STATUS_ERROR_INVALID_EXECUTABLE;
+  }
+
+  exec->GetKernelDispatchInfo(num_kernels, kernels);
+  return HSA_STATUS_SUCCESS;
+  CATCH;
+}
+
 }   //  namespace amd
 }   //  namespace rocr
@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/init_profile.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "core/util/locks.h"
+
+namespace rocr {
+namespace core {
+
+namespace {
+
+struct PhaseRecord {
+  const char* name;
+  int32_t node;
+  uint32_t depth;
+  uint32_t thread;
+  timer::fast_clock::time_point start;
+  timer::fast_clock::time_point end;
+};
+
+struct ProfileState {
+  std::atomic<bool> active;
+  KernelMutex lock;
+  std::vector<PhaseRecord> records;
+  timer::fast_clock::time_point start;
+  bool report_stderr;
+  std::string path;
+  std::atomic<uint32_t> next_thread;
+  uint32_t main_thread;
+};
+
+// Never destroyed, phases may close on threads which outlive static destruction.
+ProfileState* const state_ = new ProfileState();
+
+thread_local uint32_t tls_depth = 0;
+thread_local uint32_t tls_thread = 0;
+
+uint32_t ThreadIndex() {
+  if (tls_thread == 0) tls_thread = state_->next_thread.fetch_add(1, std::memory_order_relaxed) + 1;
+  return tls_thread;
+}
+
+double ToMs(timer::fast_clock::duration duration) {
+  return timer::duration_in_seconds(duration) * 1000.0;
+}
+
+}  // namespace
+
+InitProfile::Phase::Phase(const char* name, int32_t node, const Phase* parent)
+    : name_(name), node_(node), active_(state_->active.load(std::memory_order_relaxed)) {
+  if (!active_) return;
+  saved_depth_ = tls_depth;
+  depth_ = (parent != nullptr && parent->active_) ? parent->depth_ + 1 : tls_depth;
+  tls_depth = depth_ + 1;
+  start_ = timer::fast_clock::now();
+}
+
+void InitProfile::Phase::End() {
+  if (!active_) return;
+  active_ = false;
+  timer::fast_clock::time_point end = timer::fast_clock::now();
+  tls_depth = saved_depth_;
+  const uint32_t thread = ThreadIndex();
+
+  ScopedAcquire<KernelMutex> lock(&state_->lock);
+  state_->records.push_back({name_, node_, depth_, thread, start_, end});
+}
+
+void InitProfile::Start(bool report_stderr, const std::string& path) {
+  if (!report_stderr && path.empty()) return;
+  ScopedAcquire<KernelMutex> lock(&state_->lock);
+  state_->records.clear();
+  state_->report_stderr = report_stderr;
+  state_->path = path;
+  state_->main_thread = ThreadIndex();
+  state_->start = timer::fast_clock::now();
+  state_->active.store(true, std::memory_order_relaxed);
+}
+
+void InitProfile::Finish() {
+  if (!state_->active.load(std::memory_order_relaxed)) return;
+  timer::fast_clock::time_point end = timer::fast_clock::now();
+
+  ScopedAcquire<KernelMutex> lock(&state_->lock);
+  state_->active.store(false, std::memory_order_relaxed);
+
+  // Parents close after their children, order by start time to restore nesting.
+  std::vector<PhaseRecord>& records = state_->records;
+  std::stable_sort(records.begin(), records.end(),
+                   [](const PhaseRecord& lhs, const PhaseRecord& rhs) {
+                     if (lhs.start != rhs.start) return lhs.start < rhs.start;
+                     return lhs.depth < rhs.depth;
+                   });
+
+  const double total = ToMs(end - state_->start);
+
+  if (state_->report_stderr) {
+    fprintf(stderr, "HSA init profile: %.3f ms total\n", total);
+    for (auto& record : records) {
+      fprintf(stderr, "%10.3f ms  %*s%s", ToMs(record.end - record.start), record.depth * 2, "",
+              record.name);
+      if (record.node >= 0) fprintf(stderr, " (node %d)", record.node);
+      if (record.thread != state_->main_thread) fprintf(stderr, " [thread %u]", record.thread);
+      fprintf(stderr, "\n");
+    }
+  }
+
+  if (!state_->path.empty()) {
+    FILE* file = fopen(state_->path.c_str(), "a");
+    if (file == nullptr) {
+      fprintf(stderr, "HSA_INIT_PROFILE_FILE %s could not be opened.\n", state_->path.c_str());
+    } else {
+      fprintf(file, "{\"total_ms\":%.3f,\"phases\":[", total);
+      for (size_t i = 0; i < records.size(); i++) {
+        const PhaseRecord& record = records[i];
+        fprintf(file,
+                "%s{\"name\":\"%s\",\"node\":%d,\"depth\":%u,\"thread\":%u,\"start_ms\":%.3f,"
+                "\"duration_ms\":%.3f}",
+                (i == 0) ? "" : ",", record.name, record.node, record.depth, record.thread,
+                ToMs(record.start - state_->start), ToMs(record.end - record.start));
+      }
+      fprintf(file, "]}\n");
+      fclose(file);
+    }
+  }
+
+  records.clear();
+}
+
+}  // namespace core
+}  // namespace rocr
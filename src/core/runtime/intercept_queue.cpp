@@ -41,6 +41,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "core/inc/intercept_queue.h"
+#include "core/util/counters.h"
 #include "core/util/utils.h"
 
 namespace rocr {
@@ -148,6 +149,7 @@ void InterceptQueue::Submit(const void* pkts, uint64_t pkt_count, uint64_t user_
   // Could not submit final packets, stash for later.
   assert(queue->overflow_.empty() && "Packet intercept error: overflow buffer not empty.\n");
   for (uint64_t i = 0; i < pkt_count; i++) queue->overflow_.push_back(packets[i]);
+  counters::Increment(counters::InterceptOverflow, pkt_count);
 }
 
 bool InterceptQueue::Submit(const AqlPacket* packets, uint64_t count) {
@@ -42,33 +42,75 @@
 
 #include "core/inc/interrupt_signal.h"
 #include "core/inc/runtime.h"
+#include "core/util/counters.h"
 #include "core/util/timer.h"
 #include "core/util/locks.h"
 
 namespace rocr {
 namespace core {
 
-HsaEvent* InterruptSignal::EventPool::alloc() {
+HsaEvent* InterruptSignal::EventPool::alloc(bool& shared) {
   ScopedAcquire<KernelMutex> lock(&lock_);
-  if (events_.empty()) {
-    if (!allEventsAllocated) {
-      HsaEvent* evt = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
-      if (evt == nullptr) allEventsAllocated = true;
-      return evt;
+  shared = false;
+
+  HsaEvent* ret = nullptr;
+  if (!events_.empty()) {
+    ret = events_.back().release();
+    events_.pop_back();
+  } else if (!allEventsAllocated) {
+    ret = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
+    if (ret == nullptr) allEventsAllocated = true;
+  }
+
+  if (ret != nullptr) {
+    live_++;
+    counters::Increment(counters::InterruptEventAlloc);
+    if (live_ > peak_) {
+      peak_ = live_;
+      counters::Increment(counters::InterruptEventPeak);
     }
-    return nullptr;
+    return ret;
   }
-  HsaEvent* ret = events_.back().release();
-  events_.pop_back();
+
+  // Out of driver events, multiplex onto the shared events.
+  if (shared_events_.empty()) return nullptr;
+  shared = true;
+  counters::Increment(counters::InterruptEventMux);
+  ret = shared_events_[next_shared_].get();
+  next_shared_ = (next_shared_ + 1) % shared_events_.size();
   return ret;
 }
 
-void InterruptSignal::EventPool::free(HsaEvent* evt) {
-  if (evt == nullptr) return;
+void InterruptSignal::EventPool::free(HsaEvent* evt, bool shared) {
+  if ((evt == nullptr) || shared) return;
   ScopedAcquire<KernelMutex> lock(&lock_);
+  assert(live_ != 0 && "Event pool live count underflow.");
+  live_--;
+  counters::Increment(counters::InterruptEventFree);
   events_.push_back(unique_event_ptr(evt));
 }
 
+void InterruptSignal::EventPool::reserve(uint32_t count) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+
+  // Shared events are created first so they exist even if the driver limit is low.
+  while (shared_events_.size() < kSharedEvents) {
+    HsaEvent* evt = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
+    if (evt == nullptr) break;
+    shared_events_.push_back(unique_event_ptr(evt));
+  }
+
+  events_.reserve(count);
+  while (!allEventsAllocated && (events_.size() < count)) {
+    HsaEvent* evt = InterruptSignal::CreateEvent(HSA_EVENTTYPE_SIGNAL, false);
+    if (evt == nullptr) {
+      allEventsAllocated = true;
+      break;
+    }
+    events_.push_back(unique_event_ptr(evt));
+  }
+}
+
 int InterruptSignal::rtti_id_ = 0;
 
 HsaEvent* InterruptSignal::CreateEvent(HSA_EVENTTYPE type, bool manual_reset) {
@@ -94,11 +136,12 @@ void InterruptSignal::DestroyEvent(HsaEvent* evt) { hsaKmtDestroyEvent(evt); }
 
 InterruptSignal::InterruptSignal(hsa_signal_value_t initial_value, HsaEvent* use_event)
     : LocalSignal(initial_value, false), Signal(signal()) {
+  shared_event_ = false;
   if (use_event != nullptr) {
     event_ = use_event;
     free_event_ = false;
   } else {
-    event_ = Runtime::runtime_singleton_->GetEventPool()->alloc();
+    event_ = Runtime::runtime_singleton_->GetEventPool()->alloc(shared_event_);
     free_event_ = true;
   }
 
@@ -113,7 +156,7 @@ InterruptSignal::InterruptSignal(hsa_signal_value_t initial_value, HsaEvent* use
 }
 
 InterruptSignal::~InterruptSignal() {
-  if (free_event_) Runtime::runtime_singleton_->GetEventPool()->free(event_);
+  if (free_event_) Runtime::runtime_singleton_->GetEventPool()->free(event_, shared_event_);
 }
 
 hsa_signal_value_t InterruptSignal::LoadRelaxed() {
@@ -151,9 +194,18 @@ hsa_signal_value_t InterruptSignal::WaitRelaxed(
 
   timer::fast_clock::time_point start_time = timer::fast_clock::now();
 
+  uint32_t sleeps = 0;
+  MAKE_SCOPE_GUARD([&]() {
+    if (!counters::Enabled()) return;
+    if (sleeps == 0) counters::Increment(counters::SignalWaitSpin);
+    counters::Record(counters::SignalWaitTime,
+                     timer::duration_cast<std::chrono::nanoseconds>(timer::fast_clock::now() -
+                                                                    start_time).count());
+  });
+
   // Set a polling timeout value
-  // Should be a few times bigger than null kernel latency
-  const timer::fast_clock::duration kMaxElapsed = std::chrono::microseconds(200);
+  const timer::fast_clock::duration kMaxElapsed =
+      std::chrono::microseconds(core::Runtime::runtime_singleton_->flag().signal_wait_spin_us());
 
   uint64_t hsa_freq;
   HSA::hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &hsa_freq);
@@ -209,6 +261,10 @@ hsa_signal_value_t InterruptSignal::WaitRelaxed(
     uint64_t ct=timer::duration_cast<std::chrono::milliseconds>(
       time_remaining).count();
     wait_ms = (ct>0xFFFFFFFEu) ? 0xFFFFFFFEu : ct;
+    // Wake ups on a shared event may be consumed by another signal's waiter, recheck often.
+    if (shared_event_) wait_ms = Min(wait_ms, uint32_t(kSharedEventWaitMs));
+    sleeps++;
+    counters::Increment(counters::SignalWaitSleep);
     hsaKmtWaitOnEvent(event_, wait_ms);
   }
 }
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/queue_latency.h"
+
+#include <vector>
+
+#include "core/inc/amd_gpu_agent.h"
+#include "core/inc/queue.h"
+#include "core/inc/runtime.h"
+#include "core/inc/signal.h"
+#include "core/util/os.h"
+
+namespace rocr {
+namespace core {
+
+QueueLatencyStats::QueueLatencyStats(AMD::GpuAgentInt* agent) : agent_(agent) {
+  for (auto& histogram : histograms_)
+    for (auto& bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+
+  const uint64_t sys_freq = Runtime::runtime_singleton_->sys_clock_freq();
+  ticks_to_ns_ = 1e9 / double(sys_freq);
+
+  // Submission times are taken from the host clock, which is cheap to read, and mapped onto the
+  // system timestamp domain that dispatch timestamps are translated into.
+  uint64_t system_tick;
+  Runtime::runtime_singleton_->GetSystemInfo(HSA_SYSTEM_INFO_TIMESTAMP, &system_tick);
+  const uint64_t host_tick = os::ReadAccurateClock();
+  host_to_system_ = double(sys_freq) / double(os::AccurateClockFrequency());
+  host_offset_ = int64_t(system_tick) - int64_t(double(host_tick) * host_to_system_);
+}
+
+uint64_t QueueLatencyStats::Now() const {
+  return uint64_t(int64_t(double(os::ReadAccurateClock()) * host_to_system_) + host_offset_);
+}
+
+void QueueLatencyStats::Intercept(const void* pkts, uint64_t pkt_count, uint64_t user_pkt_index,
+                                  void* data, hsa_amd_queue_intercept_packet_writer writer) {
+  QueueLatencyStats* stats = reinterpret_cast<QueueLatencyStats*>(data);
+  const AqlPacket* packets = reinterpret_cast<const AqlPacket*>(pkts);
+  const uint64_t submit = stats->Now();
+
+  // The writer advances the intercept chain, so it must be called exactly once per submit.  The
+  // rewritten packets are staged in a per-thread buffer which only grows.
+  static thread_local std::vector<AqlPacket> batch;
+  batch.assign(packets, packets + pkt_count);
+  for (auto& packet : batch) {
+    if (packet.type() == HSA_PACKET_TYPE_KERNEL_DISPATCH)
+      packet.dispatch.completion_signal = stats->Track(packet.dispatch.completion_signal, submit);
+  }
+  writer(batch.data(), pkt_count);
+}
+
+hsa_signal_t QueueLatencyStats::Track(hsa_signal_t completion, uint64_t submit) {
+  Dispatch* dispatch = new Dispatch();
+  dispatch->stats = shared_from_this();
+  dispatch->completion = (completion.handle != 0) ? Signal::Convert(completion) : nullptr;
+  dispatch->submit = submit;
+
+  // On failure the dispatch is submitted untracked.
+  if (HSA::hsa_signal_create(1, 0, nullptr, &dispatch->signal) != HSA_STATUS_SUCCESS) {
+    delete dispatch;
+    return completion;
+  }
+
+  // Errors are reported as negative signal values, so wait for any value below the initial one.
+  if (Runtime::runtime_singleton_->SetAsyncSignalHandler(dispatch->signal, HSA_SIGNAL_CONDITION_LT,
+                                                         1, HandleCompletion,
+                                                         dispatch) != HSA_STATUS_SUCCESS) {
+    HSA::hsa_signal_destroy(dispatch->signal);
+    delete dispatch;
+    return completion;
+  }
+
+  return dispatch->signal;
+}
+
+bool QueueLatencyStats::HandleCompletion(hsa_signal_value_t value, void* arg) {
+  Dispatch* dispatch = reinterpret_cast<Dispatch*>(arg);
+  QueueLatencyStats* stats = dispatch->stats.get();
+  Signal* signal = Signal::Convert(dispatch->signal);
+
+  if (value == 0) {
+    const uint64_t start = signal->signal_.start_ts;
+    const uint64_t end = signal->signal_.end_ts;
+
+    // Timestamps are zero if profiling was disabled on the queue after creation.
+    if (start != 0 && end >= start) {
+      const uint64_t sys_start = stats->agent_->TranslateTime(start);
+      const uint64_t sys_end = stats->agent_->TranslateTime(end);
+      stats->Record(SubmitToStart, (sys_start > dispatch->submit) ? sys_start - dispatch->submit
+                                                                  : 0);
+      stats->Record(StartToEnd, sys_end - sys_start);
+    }
+
+    // Keep hsa_amd_profiling_get_dispatch_time working on the caller's signal.
+    if (dispatch->completion != nullptr) {
+      dispatch->completion->signal_.start_ts = start;
+      dispatch->completion->signal_.end_ts = end;
+    }
+  }
+
+  if (dispatch->completion != nullptr) {
+    if (value < 0)
+      dispatch->completion->StoreRelease(value);
+    else
+      dispatch->completion->SubRelease(1);
+  }
+
+  HSA::hsa_signal_destroy(dispatch->signal);
+  delete dispatch;
+  return false;
+}
+
+void QueueLatencyStats::Read(Latency id, uint32_t num_buckets, uint64_t* buckets) const {
+  const uint32_t count = Min(num_buckets, counters::kHistogramBuckets);
+  for (uint32_t i = 0; i < count; i++)
+    buckets[i] = histograms_[id][i].load(std::memory_order_relaxed);
+}
+
+}  // namespace core
+}  // namespace rocr
@@ -49,6 +49,10 @@
 #include <thread>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #include "core/common/shared.h"
 #include "core/inc/hsa_ext_interface.h"
 #include "core/inc/amd_cpu_agent.h"
@@ -59,7 +63,11 @@
 #include "core/inc/interrupt_signal.h"
 #include "core/inc/hsa_ext_amd_impl.h"
 #include "core/inc/hsa_api_trace_int.h"
+#include "core/inc/hsa_api_trace_buffer.h"
+#include "core/inc/init_profile.h"
+#include "core/util/counters.h"
 #include "core/util/os.h"
+#include "core/util/parallel.h"
 #include "core/inc/exceptions.h"
 #include "inc/hsa_ven_amd_aqlprofile.h"
 
@@ -178,9 +186,13 @@ void Runtime::RegisterAgent(Agent* agent) {
       // Default system pool must support kernarg
       for (auto pool : system_regions_fine_) {
         if (pool->kernarg()) {
-          system_allocator_ = [pool](size_t size, size_t alignment,
-                                     MemoryRegion::AllocateFlags alloc_flags) -> void* {
+          // Memory from this allocator is shared by all agents.
+          const MemoryRegion::AllocateFlags policy =
+              flag_.sysmem_interleave() ? MemoryRegion::AllocateInterleave : 0;
+          system_allocator_ = [pool, policy](size_t size, size_t alignment,
+                                             MemoryRegion::AllocateFlags alloc_flags) -> void* {
             assert(alignment <= 4096);
+            alloc_flags |= policy;
             void* ptr = NULL;
             return (HSA_STATUS_SUCCESS ==
                     core::Runtime::runtime_singleton_->AllocateMemory(pool, size, alloc_flags,
@@ -293,7 +305,7 @@ hsa_status_t Runtime::FreeMemory(void* ptr) {
 
   const MemoryRegion* region = nullptr;
   size_t size = 0;
-  std::unique_ptr<std::vector<AllocationRegion::notifier_t>> notifiers;
+  std::vector<ReleaseNotifier> notifiers;
 
   {
     ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
@@ -313,73 +325,92 @@ hsa_status_t Runtime::FreeMemory(void* ptr) {
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
     }
 
-    notifiers = std::move(it->second.notifiers);
-
     allocation_map_.erase(it);
+
+    // Registration holds memory_lock_ shared, so no notifier can be added for ptr from here on.
+    NotifierShard& shard = notifier_shard(ptr);
+    ScopedAcquire<KernelMutex> shard_lock(&shard.lock);
+    auto list = shard.notifiers.find(ptr);
+    if (list != shard.notifiers.end()) {
+      notifiers.swap(list->second);
+      shard.notifiers.erase(list);
+    }
   }
 
   // Notifiers can't run while holding the lock or the callback won't be able to manage memory.
   // The memory triggering the notification has already been removed from the memory map so can't
   // be double released during the callback.
-  if (notifiers) {
-    for (auto& notifier : *notifiers) {
-      notifier.callback(notifier.ptr, notifier.user_data);
-    }
+  for (auto& notifier : notifiers) {
+    notifier.callback(notifier.ptr, notifier.user_data);
   }
 
   return region->Free(ptr, size);
 }
 
+const void* Runtime::FindAllocationBase(const void* ptr) const {
+  auto mem = allocation_map_.upper_bound(ptr);
+  if (mem == allocation_map_.begin()) return nullptr;
+  mem--;
+
+  // No support for imported fragments yet.
+  if (mem->second.region == nullptr) return nullptr;
+
+  if (ptr < reinterpret_cast<const uint8_t*>(mem->first) + mem->second.size) return mem->first;
+  return nullptr;
+}
+
 hsa_status_t Runtime::RegisterReleaseNotifier(void* ptr, hsa_amd_deallocation_callback_t callback,
                                               void* user_data) {
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-  auto mem = allocation_map_.upper_bound(ptr);
-  if (mem != allocation_map_.begin()) {
-    mem--;
-
-    // No support for imported fragments yet.
-    if (mem->second.region == nullptr) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
-
-    if ((mem->first <= ptr) &&
-        (ptr < reinterpret_cast<const uint8_t*>(mem->first) + mem->second.size)) {
-      auto& notifiers = mem->second.notifiers;
-      if (!notifiers) notifiers.reset(new std::vector<AllocationRegion::notifier_t>);
-      AllocationRegion::notifier_t notifier = {
-          ptr, AMD::callback_t<hsa_amd_deallocation_callback_t>(callback), user_data};
-      notifiers->push_back(notifier);
-      return HSA_STATUS_SUCCESS;
-    }
-  }
-  return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+  ScopedAcquire<KernelSharedMutex::Shared> lock(memory_lock_.shared());
+  const void* base = FindAllocationBase(ptr);
+  if (base == nullptr) return HSA_STATUS_ERROR_INVALID_ALLOCATION;
+
+  NotifierShard& shard = notifier_shard(base);
+  ScopedAcquire<KernelMutex> shard_lock(&shard.lock);
+  ReleaseNotifier notifier = {ptr, AMD::callback_t<hsa_amd_deallocation_callback_t>(callback),
+                              user_data};
+  shard.notifiers[base].push_back(notifier);
+  return HSA_STATUS_SUCCESS;
 }
 
 hsa_status_t Runtime::DeregisterReleaseNotifier(void* ptr,
                                                 hsa_amd_deallocation_callback_t callback) {
   hsa_status_t ret = HSA_STATUS_ERROR_INVALID_ARGUMENT;
-  ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-  auto mem = allocation_map_.upper_bound(ptr);
-  if (mem != allocation_map_.begin()) {
-    mem--;
-    if ((mem->first <= ptr) &&
-        (ptr < reinterpret_cast<const uint8_t*>(mem->first) + mem->second.size)) {
-      auto& notifiers = mem->second.notifiers;
-      if (!notifiers) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-      for (size_t i = 0; i < notifiers->size(); i++) {
-        if (((*notifiers)[i].ptr == ptr) && ((*notifiers)[i].callback) == callback) {
-          (*notifiers)[i] = std::move((*notifiers)[notifiers->size() - 1]);
-          notifiers->pop_back();
-          i--;
-          ret = HSA_STATUS_SUCCESS;
-        }
-      }
+  ScopedAcquire<KernelSharedMutex::Shared> lock(memory_lock_.shared());
+  const void* base = FindAllocationBase(ptr);
+  if (base == nullptr) return ret;
+
+  NotifierShard& shard = notifier_shard(base);
+  ScopedAcquire<KernelMutex> shard_lock(&shard.lock);
+  auto list = shard.notifiers.find(base);
+  if (list == shard.notifiers.end()) return ret;
+
+  auto& notifiers = list->second;
+  for (size_t i = 0; i < notifiers.size(); i++) {
+    if ((notifiers[i].ptr == ptr) && (notifiers[i].callback == callback)) {
+      notifiers[i] = std::move(notifiers[notifiers.size() - 1]);
+      notifiers.pop_back();
+      i--;
+      ret = HSA_STATUS_SUCCESS;
     }
   }
+  if (notifiers.empty()) shard.notifiers.erase(list);
   return ret;
 }
 
 hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   void* source = const_cast<void*>(src);
 
+  // Blocking copies complete before returning so host timestamps bound the operation.
+  uint64_t copy_start = 0;
+  if (timeline_.enabled()) GetSystemInfo(HSA_SYSTEM_INFO_TIMESTAMP, &copy_start);
+  MAKE_SCOPE_GUARD([&]() {
+    if (copy_start == 0) return;
+    uint64_t copy_end;
+    GetSystemInfo(HSA_SYSTEM_INFO_TIMESTAMP, &copy_end);
+    timeline_.Record("copy", copy_start, copy_end, 0, size, dst, src);
+  });
+
   // Choose agents from pointer info
   bool is_src_system = false;
   bool is_dst_system = false;
@@ -462,11 +493,90 @@ hsa_status_t Runtime::CopyMemory(void* dst, const void* src, size_t size) {
   return err;
 }
 
+namespace {
+// Copy issued while collecting a timeline.
+struct TimelineCopy {
+  hsa_signal_t signal;         // Internal completion signal passed to the copy engine.
+  core::Signal* completion;    // Caller's completion signal.
+  void* dst;
+  const void* src;
+  size_t size;
+};
+}  // namespace
+
 hsa_status_t Runtime::CopyMemory(void* dst, core::Agent& dst_agent,
                                  const void* src, core::Agent& src_agent,
                                  size_t size,
                                  std::vector<core::Signal*>& dep_signals,
                                  core::Signal& completion_signal) {
+  if (!timeline_.enabled())
+    return IssueCopy(dst, dst_agent, src, src_agent, size, dep_signals, completion_signal);
+
+  // Complete the copy to an internal signal so its timestamps can be harvested
+  // before the caller observes completion.
+  TimelineCopy* copy = new TimelineCopy();
+  MAKE_NAMED_SCOPE_GUARD(copyGuard, [&]() { delete copy; });
+  copy->completion = &completion_signal;
+  copy->dst = dst;
+  copy->src = src;
+  copy->size = size;
+
+  hsa_status_t err = HSA::hsa_signal_create(1, 0, nullptr, &copy->signal);
+  if (err != HSA_STATUS_SUCCESS) return err;
+  MAKE_NAMED_SCOPE_GUARD(signalGuard, [&]() { HSA::hsa_signal_destroy(copy->signal); });
+
+  err = IssueCopy(dst, dst_agent, src, src_agent, size, dep_signals,
+                  *core::Signal::Convert(copy->signal));
+  if (err != HSA_STATUS_SUCCESS) return err;
+
+  // Errors are reported as negative signal values, so wait for any value below the initial one.
+  err = SetAsyncSignalHandler(copy->signal, HSA_SIGNAL_CONDITION_LT, 1, TimelineCopyHandler,
+                              copy);
+  signalGuard.Dismiss();
+  copyGuard.Dismiss();
+  if (err != HSA_STATUS_SUCCESS) {
+    // The copy engine still owns the internal signal, so finish the copy here.
+    hsa_signal_value_t value = core::Signal::Convert(copy->signal)
+                                   ->WaitAcquire(HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX,
+                                                 HSA_WAIT_STATE_BLOCKED);
+    TimelineCopyHandler(value, copy);
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+bool Runtime::TimelineCopyHandler(hsa_signal_value_t value, void* arg) {
+  TimelineCopy* copy = reinterpret_cast<TimelineCopy*>(arg);
+  core::Signal* signal = core::Signal::Convert(copy->signal);
+  core::Agent* agent = signal->async_copy_agent();
+
+  if (value == 0 && agent != nullptr) {
+    hsa_amd_profiling_async_copy_time_t time = {signal->signal_.start_ts, signal->signal_.end_ts};
+    if (agent->device_type() == core::Agent::DeviceType::kAmdGpuDevice)
+      static_cast<AMD::GpuAgentInt*>(agent)->TranslateTime(signal, time);
+    runtime_singleton_->timeline_.Record("copy", time.start, time.end, agent->node_id(),
+                                         copy->size, copy->dst, copy->src);
+
+    // Keep hsa_amd_profiling_get_async_copy_time working on the caller's signal.
+    copy->completion->signal_.start_ts = signal->signal_.start_ts;
+    copy->completion->signal_.end_ts = signal->signal_.end_ts;
+    copy->completion->async_copy_agent(agent);
+  }
+
+  if (value < 0)
+    copy->completion->StoreRelease(value);
+  else
+    copy->completion->SubRelease(1);
+
+  HSA::hsa_signal_destroy(copy->signal);
+  delete copy;
+  return false;
+}
+
+hsa_status_t Runtime::IssueCopy(void* dst, core::Agent& dst_agent,
+                                const void* src, core::Agent& src_agent,
+                                size_t size,
+                                std::vector<core::Signal*>& dep_signals,
+                                core::Signal& completion_signal) {
   const bool dst_gpu =
       (dst_agent.device_type() == core::Agent::DeviceType::kAmdGpuDevice);
   const bool src_gpu =
@@ -479,7 +589,7 @@ hsa_status_t Runtime::CopyMemory(void* dst, core::Agent& dst_agent,
 
   // For cpu to cpu, fire and forget a copy thread.
   const bool profiling_enabled =
-      (dst_agent.profiling_enabled() || src_agent.profiling_enabled());
+      (dst_agent.profiling_enabled() || src_agent.profiling_enabled() || timeline_.enabled());
   if (profiling_enabled) completion_signal.async_copy_agent(&dst_agent);
   std::thread(
       [](void* dst, const void* src, size_t size,
@@ -511,7 +621,77 @@ hsa_status_t Runtime::CopyMemory(void* dst, core::Agent& dst_agent,
   return HSA_STATUS_SUCCESS;
 }
 
+// Fills count uint32_t at ptr from the host.  Fills too large to stay in the cache use
+// non-temporal stores so they don't evict data the CPU is still using.
+static void HostFill(void* ptr, uint32_t value, size_t count) {
+  static const size_t kStreamBytes = 4 * 1024 * 1024;
+  uint32_t* dst = reinterpret_cast<uint32_t*>(ptr);
+
+#if defined(__SSE2__) || defined(_M_X64)
+  if (count * sizeof(uint32_t) >= kStreamBytes) {
+    while ((uintptr_t(dst) & 15) != 0) {
+      *dst++ = value;
+      count--;
+    }
+    const __m128i pattern = _mm_set1_epi32(int(value));
+    __m128i* vec = reinterpret_cast<__m128i*>(dst);
+    size_t vec_count = count / 4;
+    for (size_t i = 0; i < vec_count; i++) _mm_stream_si128(vec + i, pattern);
+    _mm_sfence();
+    dst += vec_count * 4;
+    count -= vec_count * 4;
+  }
+#endif
+
+  std::fill_n(dst, count, value);
+}
+
 hsa_status_t Runtime::FillMemory(void* ptr, uint32_t value, size_t count) {
+  core::Agent* fill_agent;
+  hsa_status_t err = FillAgent(ptr, count, fill_agent);
+  if (err != HSA_STATUS_SUCCESS) return err;
+  return IssueFill(fill_agent, ptr, value, count);
+}
+
+hsa_status_t Runtime::IssueFill(core::Agent* fill_agent, void* ptr, uint32_t value,
+                                size_t count) {
+  // Fills complete before returning so host timestamps bound the operation.
+  uint64_t fill_start = 0;
+  if (timeline_.enabled()) GetSystemInfo(HSA_SYSTEM_INFO_TIMESTAMP, &fill_start);
+  MAKE_SCOPE_GUARD([&]() {
+    if (fill_start == 0) return;
+    uint64_t fill_end;
+    GetSystemInfo(HSA_SYSTEM_INFO_TIMESTAMP, &fill_end);
+    timeline_.Record("fill", fill_start, fill_end, 0, count * sizeof(uint32_t), ptr, nullptr);
+  });
+
+  if (fill_agent != nullptr) return fill_agent->DmaFill(ptr, value, count);
+  HostFill(ptr, value, count);
+  return HSA_STATUS_SUCCESS;
+}
+
+hsa_status_t Runtime::FillAgent(void* ptr, size_t count, core::Agent*& fill_agent) {
+  fill_agent = nullptr;
+  ptrdiff_t endPtr = (ptrdiff_t)ptr + count * sizeof(uint32_t);
+
+  // Runtime allocations know their owner, so they need no thunk query.  Device memory is filled
+  // by its GPU and system memory from the host.
+  Agent* owner = nullptr;
+  {
+    ScopedAcquire<KernelSharedMutex::Shared> lock(memory_lock_.shared());
+    auto it = allocation_map_.upper_bound(ptr);
+    if (it != allocation_map_.begin()) {
+      it--;
+      if ((it->second.region != nullptr) &&
+          (endPtr <= (ptrdiff_t)it->first + (ptrdiff_t)it->second.size))
+        owner = it->second.region->owner();
+    }
+  }
+  if (owner != nullptr) {
+    if (owner->device_type() == Agent::DeviceType::kAmdGpuDevice) fill_agent = owner;
+    return HSA_STATUS_SUCCESS;
+  }
+
   // Choose blit agent from pointer info
   hsa_amd_pointer_info_t info;
   uint32_t agent_count;
@@ -521,8 +701,6 @@ hsa_status_t Runtime::FillMemory(void* ptr, uint32_t value, size_t count) {
   hsa_status_t err = PtrInfo(ptr, &info, malloc, &agent_count, &accessible);
   if (err != HSA_STATUS_SUCCESS) return err;
 
-  ptrdiff_t endPtr = (ptrdiff_t)ptr + count * sizeof(uint32_t);
-
   // Check for GPU fill
   // Selects GPU fill for SVM and Locked allocations if a GPU address is given and is mapped.
   if (info.agentBaseAddress <= ptr &&
@@ -538,18 +716,74 @@ hsa_status_t Runtime::FillMemory(void* ptr, uint32_t value, size_t count) {
         }
       }
     }
-    if (blit_agent) return blit_agent->DmaFill(ptr, value, count);
+    if (blit_agent) {
+      fill_agent = blit_agent;
+      return HSA_STATUS_SUCCESS;
+    }
   }
 
   // Host and unmapped SVM addresses copy via host.
-  if (info.hostBaseAddress <= ptr && endPtr <= (ptrdiff_t)info.hostBaseAddress + info.sizeInBytes) {
-    memset(ptr, value, count * sizeof(uint32_t));
+  if (info.hostBaseAddress <= ptr && endPtr <= (ptrdiff_t)info.hostBaseAddress + info.sizeInBytes)
     return HSA_STATUS_SUCCESS;
-  }
 
   return HSA_STATUS_ERROR_INVALID_ALLOCATION;
 }
 
+hsa_status_t Runtime::FillMemoryAsync(void* ptr, uint32_t value, size_t count,
+                                      uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
+                                      hsa_signal_t completion_signal) {
+  // Reject bad ranges now rather than after the dependencies resolve.
+  core::Agent* fill_agent;
+  hsa_status_t err = FillAgent(ptr, count, fill_agent);
+  if (err != HSA_STATUS_SUCCESS) return err;
+
+  FillOp* op = new FillOp();
+  MAKE_NAMED_SCOPE_GUARD(OpGuard, [&]() { delete op; });
+
+  op->agent = fill_agent;
+  op->ptr = ptr;
+  op->value = value;
+  op->count = count;
+  op->completion = completion_signal;
+  op->dep_signals.assign(dep_signals, dep_signals + num_dep_signals);
+
+  if (num_dep_signals == 0)
+    err = AMD::hsa_amd_async_function([](void* arg) { FillDepsHandler(0, arg); }, op);
+  else
+    err = SetAsyncSignalHandler(dep_signals[num_dep_signals - 1], HSA_SIGNAL_CONDITION_EQ, 0,
+                                FillDepsHandler, op);
+  if (err != HSA_STATUS_SUCCESS) throw AMD::hsa_exception(err, "Signal handler unable to be set.");
+
+  OpGuard.Dismiss();
+  return HSA_STATUS_SUCCESS;
+}
+
+bool Runtime::FillDepsHandler(hsa_signal_value_t value, void* arg) {
+  FillOp* op = reinterpret_cast<FillOp*>(arg);
+
+  // The handler fired for the last pending dependency.
+  if (!op->dep_signals.empty()) op->dep_signals.pop_back();
+  if (!runtime_singleton_->AwaitDependencies(op->dep_signals, FillDepsHandler, arg)) return false;
+
+  // Fills block until done, so run them off the async events thread to keep other handlers
+  // responsive.
+  std::thread(
+      [](FillOp* op) {
+        hsa_status_t err =
+            runtime_singleton_->IssueFill(op->agent, op->ptr, op->value, op->count);
+        if (op->completion.handle != 0) {
+          // Failures are reported as a negative signal value, as for timeline copies.
+          if (err != HSA_STATUS_SUCCESS)
+            Signal::Convert(op->completion)->StoreRelease(-1);
+          else
+            Signal::Convert(op->completion)->SubRelease(1);
+        }
+        delete op;
+      },
+      op).detach();
+  return false;
+}
+
 hsa_status_t Runtime::AllowAccess(uint32_t num_agents,
                                   const hsa_agent_t* agents, const void* ptr) {
   const AMD::MemoryRegion* amd_region = NULL;
@@ -774,6 +1008,9 @@ hsa_status_t Runtime::PtrInfo(const void* ptr, hsa_amd_pointer_info_t* info, voi
 
   hsa_amd_pointer_info_t retInfo = {0};
 
+  // Owner of a pool allocation which the thunk only knows as registered user memory.
+  const Agent* pool_owner = nullptr;
+
   // check output struct has an initialized size.
   if (info->size == 0) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
@@ -829,6 +1066,13 @@ hsa_status_t Runtime::PtrInfo(const void* ptr, hsa_amd_pointer_info_t* info, voi
           retInfo.hostBaseAddress = retInfo.agentBaseAddress;
           retInfo.sizeInBytes = fragment->second.size;
           retInfo.userData = fragment->second.user_ptr;
+
+          // System memory allocated with a placement policy is registered by the runtime.
+          if ((retInfo.type == HSA_EXT_POINTER_TYPE_LOCKED) &&
+              (fragment->second.region != nullptr)) {
+            retInfo.type = HSA_EXT_POINTER_TYPE_HSA;
+            pool_owner = fragment->second.region->owner();
+          }
       }
     }
   }  // end lock scope
@@ -838,7 +1082,9 @@ hsa_status_t Runtime::PtrInfo(const void* ptr, hsa_amd_pointer_info_t* info, voi
   // IPC and Graphics memory may come from a node that does not have an agent in this process.
   // Ex. ROCR_VISIBLE_DEVICES or peer GPU is not supported by ROCm.
   auto nodeAgents = agents_by_node_.find(thunkInfo.Node);
-  if (nodeAgents != agents_by_node_.end())
+  if (pool_owner != nullptr)
+    retInfo.agentOwner = pool_owner->public_handle();
+  else if (nodeAgents != agents_by_node_.end())
     retInfo.agentOwner = nodeAgents->second[0]->public_handle();
   else
     retInfo.agentOwner.handle = 0;
@@ -936,102 +1182,129 @@ hsa_status_t Runtime::IPCCreate(void* ptr, size_t len, hsa_amd_ipc_memory_t* han
 
 hsa_status_t Runtime::IPCAttach(const hsa_amd_ipc_memory_t* handle, size_t len, uint32_t num_agents,
                                 Agent** agents, void** mapped_ptr) {
-  static const int tinyArraySize = 8;
-  void* importAddress;
-  HSAuint64 importSize;
-  HSAuint64 altAddress;
-
-  hsa_amd_ipc_memory_t importHandle;
-  importHandle = *handle;
+  IPCImportKey key;
+  static_assert(sizeof(key.handle) == sizeof(handle->handle), "IPC handle size mismatch.");
+  memcpy(key.handle, handle->handle, sizeof(key.handle));
 
   // Extract fragment info
   bool isFragment = false;
   uint32_t fragOffset = 0;
 
-  auto fixFragment = [&]() {
-    if (!isFragment) return;
+  if ((key.handle[6] & 0x80000000) != 0) {
+    isFragment = true;
+    fragOffset = (key.handle[6] & 0x1FF) * 4096;
+    key.handle[6] &= ~(0x80000000 | 0x1FF);
+  }
+
+  key.nodes.resize(num_agents);
+  for (uint32_t i = 0; i < num_agents; i++)
+    agents[i]->GetInfo((hsa_agent_info_t)HSA_AMD_AGENT_INFO_DRIVER_NODE_ID, &key.nodes[i]);
+  std::sort(key.nodes.begin(), key.nodes.end());
+  key.nodes.erase(std::unique(key.nodes.begin(), key.nodes.end()), key.nodes.end());
+
+  ScopedAcquire<KernelMutex> lock(&ipc_lock_);
+
+  auto import = ipc_imports_.find(key);
+  if (import == ipc_imports_.end()) {
+    IPCImport imported;
+    hsa_status_t err = IPCImportHandle(key, imported);
+    if (err != HSA_STATUS_SUCCESS) return err;
+    imported.ref_count = 0;
+    import = ipc_imports_.insert(std::make_pair(key, imported)).first;
+  }
+
+  void* importAddress = import->second.address;
+  if (isFragment) {
     importAddress = reinterpret_cast<uint8_t*>(importAddress) + fragOffset;
-    len = Min(len, importSize - fragOffset);
-    ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-    allocation_map_[importAddress] = AllocationRegion(nullptr, len);
-  };
+    len = Min(len, import->second.size - fragOffset);
+  }
 
-  if ((importHandle.handle[6] & 0x80000000) != 0) {
-    isFragment = true;
-    fragOffset = (importHandle.handle[6] & 0x1FF) * 4096;
-    importHandle.handle[6] &= ~(0x80000000 | 0x1FF);
+  IPCMapping& mapping = ipc_mappings_[importAddress];
+  if (mapping.ref_count == 0) {
+    mapping.import = import;
+    mapping.fragment = isFragment;
+    if (isFragment) {
+      ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+      allocation_map_[importAddress] = AllocationRegion(nullptr, len);
+    }
   }
+  mapping.ref_count++;
+  import->second.ref_count++;
+
+  *mapped_ptr = importAddress;
+  return HSA_STATUS_SUCCESS;
+}
 
-  if (num_agents == 0) {
-    if (hsaKmtRegisterSharedHandle(reinterpret_cast<const HsaSharedMemoryHandle*>(&importHandle),
-                                   &importAddress, &importSize) != HSAKMT_STATUS_SUCCESS)
+hsa_status_t Runtime::IPCImportHandle(const IPCImportKey& key, IPCImport& import) {
+  const HsaSharedMemoryHandle* shared_handle =
+      reinterpret_cast<const HsaSharedMemoryHandle*>(key.handle);
+  HSAuint64 altAddress;
+
+  if (key.nodes.empty()) {
+    if (hsaKmtRegisterSharedHandle(shared_handle, &import.address, &import.size) !=
+        HSAKMT_STATUS_SUCCESS)
       return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-    if (hsaKmtMapMemoryToGPU(importAddress, importSize, &altAddress) != HSAKMT_STATUS_SUCCESS) {
-      hsaKmtDeregisterMemory(importAddress);
+    if (hsaKmtMapMemoryToGPU(import.address, import.size, &altAddress) != HSAKMT_STATUS_SUCCESS) {
+      hsaKmtDeregisterMemory(import.address);
       return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
     }
-    fixFragment();
-    *mapped_ptr = importAddress;
     return HSA_STATUS_SUCCESS;
   }
 
-  HSAuint32* nodes = nullptr;
-  if (num_agents > tinyArraySize)
-    nodes = new HSAuint32[num_agents];
-  else
-    nodes = (HSAuint32*)alloca(sizeof(HSAuint32) * num_agents);
-  if (nodes == NULL) return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
-
-  MAKE_SCOPE_GUARD([&]() {
-    if (num_agents > tinyArraySize) delete[] nodes;
-  });
+  uint32_t num_nodes = key.nodes.size();
+  HSAuint32* nodes = const_cast<HSAuint32*>(&key.nodes[0]);
 
-  for (uint32_t i = 0; i < num_agents; i++)
-    agents[i]->GetInfo((hsa_agent_info_t)HSA_AMD_AGENT_INFO_DRIVER_NODE_ID, &nodes[i]);
-
-  if (hsaKmtRegisterSharedHandleToNodes(
-          reinterpret_cast<const HsaSharedMemoryHandle*>(&importHandle), &importAddress,
-          &importSize, num_agents, nodes) != HSAKMT_STATUS_SUCCESS)
+  if (hsaKmtRegisterSharedHandleToNodes(shared_handle, &import.address, &import.size, num_nodes,
+                                        nodes) != HSAKMT_STATUS_SUCCESS)
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
+  // Prefer 64KB pages unless this handle is known to need 4KB pages.
   HsaMemMapFlags map_flags;
   map_flags.Value = 0;
-  map_flags.ui32.PageSize = HSA_PAGE_SIZE_64KB;
-  if (hsaKmtMapMemoryToGPUNodes(importAddress, importSize, &altAddress, map_flags, num_agents,
-                                nodes) != HSAKMT_STATUS_SUCCESS) {
+  map_flags.ui32.PageSize =
+      (ipc_page_size_.find(key) == ipc_page_size_.end()) ? HSA_PAGE_SIZE_64KB : HSA_PAGE_SIZE_4KB;
+  if (hsaKmtMapMemoryToGPUNodes(import.address, import.size, &altAddress, map_flags, num_nodes,
+                                nodes) == HSAKMT_STATUS_SUCCESS)
+    return HSA_STATUS_SUCCESS;
+
+  if (map_flags.ui32.PageSize == HSA_PAGE_SIZE_64KB) {
     map_flags.ui32.PageSize = HSA_PAGE_SIZE_4KB;
-    if (hsaKmtMapMemoryToGPUNodes(importAddress, importSize, &altAddress, map_flags, num_agents,
-                                  nodes) != HSAKMT_STATUS_SUCCESS) {
-      hsaKmtDeregisterMemory(importAddress);
-      return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+    if (hsaKmtMapMemoryToGPUNodes(import.address, import.size, &altAddress, map_flags, num_nodes,
+                                  nodes) == HSAKMT_STATUS_SUCCESS) {
+      // Bound the memo, handles of freed exports are never looked up again.
+      static const size_t kMaxPageSizeMemo = 4096;
+      if (ipc_page_size_.size() >= kMaxPageSizeMemo) ipc_page_size_.clear();
+      ipc_page_size_[key] = HSA_PAGE_SIZE_4KB;
+      return HSA_STATUS_SUCCESS;
     }
   }
 
-  fixFragment();
-  *mapped_ptr = importAddress;
-  return HSA_STATUS_SUCCESS;
+  hsaKmtDeregisterMemory(import.address);
+  return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
 }
 
 hsa_status_t Runtime::IPCDetach(void* ptr) {
-  {  // Handle imported fragments.
-    ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
-    const auto& it = allocation_map_.find(ptr);
-    if (it != allocation_map_.end()) {
-      if (it->second.region != nullptr) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-      allocation_map_.erase(it);
-      lock.Release();  // Can't hold memory lock when using pointer info.
+  ScopedAcquire<KernelMutex> lock(&ipc_lock_);
+
+  auto mapping = ipc_mappings_.find(ptr);
+  if (mapping == ipc_mappings_.end()) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
 
-      PtrInfoBlockData block;
-      hsa_amd_pointer_info_t info;
-      info.size = sizeof(info);
-      if (PtrInfo(ptr, &info, nullptr, nullptr, nullptr, &block) != HSA_STATUS_SUCCESS)
-        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-      ptr = block.base;
+  auto import = mapping->second.import;
+  if (--mapping->second.ref_count == 0) {
+    if (mapping->second.fragment) {
+      ScopedAcquire<KernelSharedMutex> lock(&memory_lock_);
+      allocation_map_.erase(ptr);
     }
+    ipc_mappings_.erase(mapping);
   }
-  if (hsaKmtUnmapMemoryToGPU(ptr) != HSAKMT_STATUS_SUCCESS)
+
+  if (--import->second.ref_count != 0) return HSA_STATUS_SUCCESS;
+
+  void* address = import->second.address;
+  ipc_imports_.erase(import);
+  if (hsaKmtUnmapMemoryToGPU(address) != HSAKMT_STATUS_SUCCESS)
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
-  if (hsaKmtDeregisterMemory(ptr) != HSAKMT_STATUS_SUCCESS)
+  if (hsaKmtDeregisterMemory(address) != HSAKMT_STATUS_SUCCESS)
     return HSA_STATUS_ERROR_INVALID_ARGUMENT;
   return HSA_STATUS_SUCCESS;
 }
@@ -1340,9 +1613,21 @@ Runtime::Runtime()
 
 hsa_status_t Runtime::Load() {
   flag_.Refresh();
+  if (flag_.config_dump()) flag_.Dump(stderr);
+
+  InitProfile::Start(flag_.init_timing(), flag_.init_profile_file());
+  MAKE_SCOPE_GUARD([]() { InitProfile::Finish(); });
 
   g_use_interrupt_wait = flag_.enable_interrupt();
 
+  AMD::MemoryRegion::SetPinnedCacheBudget(flag_.pinned_cache_bytes());
+
+  // Dumping implies counting.
+  if (flag_.runtime_counters() || (flag_.runtime_counters_dump_ms() != 0)) {
+    counters::Enable(true);
+    counters::StartPeriodicDump(flag_.runtime_counters_dump_ms());
+  }
+
   if (!AMD::Load()) {
     return HSA_STATUS_ERROR_OUT_OF_RESOURCES;
   }
@@ -1357,39 +1642,68 @@ hsa_status_t Runtime::Load() {
 
   BindVmFaultHandler();
 
+  if (g_use_interrupt_wait) EventPool.reserve(flag_.event_pool_size());
+
   loader_ = amd::hsa::loader::Loader::Create(&loader_context_);
 
   // Load extensions
+  InitProfile::Phase extensions_phase("extensions");
   LoadExtensions();
+  extensions_phase.End();
+
+  // Initialize per GPU scratch, blits, and trap handler.  Agents are independent
+  // so initialize them concurrently.
+  InitProfile::Phase gpu_phase("GPU agent initialization");
+  std::vector<hsa_status_t> status(gpu_agents_.size(), HSA_STATUS_SUCCESS);
+  ParallelFor(gpu_agents_.size(), flag_.init_threads(), [&](size_t idx) {
+    InitProfile::Phase agent_phase("GPU agent", gpu_agents_[idx]->node_id(), &gpu_phase);
+    status[idx] = reinterpret_cast<AMD::GpuAgentInt*>(gpu_agents_[idx])->PostToolsInit();
+  });
+  gpu_phase.End();
 
-  // Initialize per GPU scratch, blits, and trap handler
-  for (core::Agent* agent : gpu_agents_) {
-    hsa_status_t status =
-        reinterpret_cast<AMD::GpuAgentInt*>(agent)->PostToolsInit();
+  for (hsa_status_t err : status) {
+    if (err != HSA_STATUS_SUCCESS) {
+      return err;
+    }
+  }
 
-    if (status != HSA_STATUS_SUCCESS) {
-      return status;
+  // Timestamps for runtime copies are needed to build the timeline.
+  if (!flag_.timeline_file().empty()) {
+    if (timeline_.Start(flag_.timeline_file(), sys_clock_freq_)) {
+      for (core::Agent* agent : gpu_agents_) agent->profiling_enabled(true);
+    } else {
+      fprintf(stderr, "HSA timeline file \"%s\" could not be opened.\n",
+              flag_.timeline_file().c_str());
     }
   }
 
   // Load tools libraries
+  InitProfile::Phase tools_phase("tools");
   LoadTools();
 
   return HSA_STATUS_SUCCESS;
 }
 
 void Runtime::Unload() {
+  counters::StopPeriodicDump();
+
   UnloadTools();
+  StopApiTrace();
   UnloadExtensions();
 
   amd::hsa::loader::Loader::Destroy(loader_);
   loader_ = nullptr;
 
+  // Release cached host memory registrations while GPU agents are still present.
+  AMD::MemoryRegion::FlushPinnedCache(nullptr, 0);
+
   std::for_each(gpu_agents_.begin(), gpu_agents_.end(), DeleteObject());
   gpu_agents_.clear();
 
   async_events_control_.Shutdown();
 
+  timeline_.Stop();
+
   if (vm_fault_signal_ != nullptr) {
     vm_fault_signal_->DestroySignal();
     vm_fault_signal_ = nullptr;
@@ -1426,6 +1740,7 @@ void Runtime::LoadExtensions() {
                           core::HsaApiTable::HSA_EXT_FINALIZER_API_TABLE_ID);
 
   // Update Hsa Api Table with handle of Image extension Apis
+  InitProfile::Phase phase("image runtime");
   extensions_.LoadImage();
   hsa_api_table_.LinkExts(&extensions_.image_api,
                           core::HsaApiTable::HSA_EXT_IMAGE_API_TABLE_ID);
@@ -1489,6 +1804,11 @@ void Runtime::LoadTools() {
   typedef Agent* (*tool_wrap_t)(Agent*);
   typedef void (*tool_add_t)(Runtime*);
 
+  // Built-in tracing is installed first so that tools wrap the traced table.
+  if (!flag_.api_trace_file().empty() && !StartApiTrace(flag_.api_trace_file(), hsa_api_table_))
+    fprintf(stderr, "HSA API trace file \"%s\" could not be opened.\n",
+            flag_.api_trace_file().c_str());
+
   // Load tool libs
   std::string tool_names = flag_.tools_lib_names();
   if (tool_names != "") {
@@ -1977,12 +2297,7 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
   op->base = reinterpret_cast<void*>(base);
   op->size = len;
   op->completion = completion_signal;
-  if (num_dep_signals > 1) {
-    op->remaining_deps = num_dep_signals - 1;
-    for (int i = 0; i < num_dep_signals - 1; i++) op->dep_signals.push_back(dep_signals[i]);
-  } else {
-    op->remaining_deps = 0;
-  }
+  op->dep_signals.assign(dep_signals, dep_signals + num_dep_signals);
 
   {
     ScopedAcquire<KernelMutex> lock(&prefetch_lock_);
@@ -2030,7 +2345,8 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
             start->second.prev->second.next = start->second.next;
             if (!isEndNode(start)) start->second.next->second.prev = start->second.prev;
           }
-          prefetch_map_.erase(start);
+          start = prefetch_map_.erase(start);
+          continue;
         }
       }
       start++;
@@ -2045,57 +2361,129 @@ hsa_status_t Runtime::SvmPrefetch(void* ptr, size_t size, hsa_agent_t agent,
     it->second.next = it->second.prev = prefetch_map_.end();
   }
 
-  // Remove the prefetch's ranges from the map.
-  static auto removePrefetchRanges = [](PrefetchOp* op) {
-    ScopedAcquire<KernelMutex> lock(&Runtime::runtime_singleton_->prefetch_lock_);
-    auto it = op->prefetch_map_entry;
-    while (it != Runtime::runtime_singleton_->prefetch_map_.end()) {
-      auto next = it->second.next;
-      Runtime::runtime_singleton_->prefetch_map_.erase(it);
-      it = next;
-    }
-  };
+  MAKE_NAMED_SCOPE_GUARD(RangeGuard, [&]() {
+    ScopedAcquire<KernelMutex> lock(&prefetch_lock_);
+    RemovePrefetchRanges(op);
+  });
+
+  hsa_status_t err;
+  if (num_dep_signals == 0)
+    err = IssuePrefetch(op);
+  else
+    err = SetAsyncSignalHandler(dep_signals[num_dep_signals - 1], HSA_SIGNAL_CONDITION_EQ, 0,
+                                PrefetchDepsHandler, op);
+  if (err != HSA_STATUS_SUCCESS) throw AMD::hsa_exception(err, "Signal handler unable to be set.");
+
+  RangeGuard.Dismiss();
+  OpGuard.Dismiss();
+  return HSA_STATUS_SUCCESS;
+}
 
-  // Prefetch Signal handler for synchronization.
-  static hsa_amd_signal_handler signal_handler = [](hsa_signal_value_t value, void* arg) {
-    PrefetchOp* op = reinterpret_cast<PrefetchOp*>(arg);
+bool Runtime::PrefetchDepsHandler(hsa_signal_value_t value, void* arg) {
+  PrefetchOp* op = reinterpret_cast<PrefetchOp*>(arg);
 
-    if (op->remaining_deps > 0) {
-      op->remaining_deps--;
-      Runtime::runtime_singleton_->SetAsyncSignalHandler(
-          op->dep_signals[op->remaining_deps], HSA_SIGNAL_CONDITION_EQ, 0, signal_handler, arg);
+  // The handler fired for the last pending dependency.
+  if (!op->dep_signals.empty()) op->dep_signals.pop_back();
+  if (!runtime_singleton_->AwaitDependencies(op->dep_signals, PrefetchDepsHandler, arg))
+    return false;
+
+  hsa_status_t err = runtime_singleton_->IssuePrefetch(op);
+  assert(err == HSA_STATUS_SUCCESS && "Prefetch drain registration failed.");
+  return false;
+}
+
+bool Runtime::AwaitDependencies(std::vector<hsa_signal_t>& deps, hsa_amd_signal_handler handler,
+                                void* arg) {
+  while (!deps.empty()) {
+    if (Signal::Convert(deps.back())->LoadAcquire() != 0) {
+      hsa_status_t err =
+          SetAsyncSignalHandler(deps.back(), HSA_SIGNAL_CONDITION_EQ, 0, handler, arg);
+      assert(err == HSA_STATUS_SUCCESS && "Dependency handler registration failed.");
       return false;
     }
+    deps.pop_back();
+  }
+  return true;
+}
+
+hsa_status_t Runtime::IssuePrefetch(PrefetchOp* op) {
+  ScopedAcquire<KernelMutex> lock(&prefetch_lock_);
+  prefetch_ready_.push_back(op);
+  // A drain is already pending and will pick this op up.
+  if (prefetch_ready_.size() != 1) return HSA_STATUS_SUCCESS;
+
+  // Posted under the lock so that no op can queue behind a drain which failed to post.
+  hsa_status_t err = AMD::hsa_amd_async_function(DrainPrefetches, nullptr);
+  if (err != HSA_STATUS_SUCCESS) prefetch_ready_.pop_back();
+  return err;
+}
+
+void Runtime::DrainPrefetches(void* unused) {
+  Runtime* runtime = runtime_singleton_;
+  std::vector<PrefetchOp*> ops;
+  std::vector<PrefetchSpan> spans;
+  {
+    ScopedAcquire<KernelMutex> lock(&runtime->prefetch_lock_);
+    ops.swap(runtime->prefetch_ready_);
+
+    // Only the parts of each range not overridden by a later prefetch need to move.
+    for (auto op : ops) {
+      for (auto it = op->prefetch_map_entry; it != runtime->prefetch_map_.end();
+           it = it->second.next)
+        spans.push_back({it->first, it->second.bytes, op->node_id});
+    }
+  }
 
-    HSA_SVM_ATTRIBUTE attrib;
-    attrib.type = HSA_SVM_ATTR_PREFETCH_LOC;
-    attrib.value = op->node_id;
-    HSAKMT_STATUS error = hsaKmtSVMSetAttr(op->base, op->size, 1, &attrib);
+  CoalescePrefetchSpans(spans);
+
+  HSA_SVM_ATTRIBUTE attrib;
+  attrib.type = HSA_SVM_ATTR_PREFETCH_LOC;
+  for (auto& span : spans) {
+    attrib.value = span.node_id;
+    HSAKMT_STATUS error =
+        hsaKmtSVMSetAttr(reinterpret_cast<void*>(span.base), span.bytes, 1, &attrib);
     assert(error == HSAKMT_STATUS_SUCCESS && "KFD Prefetch failed.");
+  }
 
-    removePrefetchRanges(op);
+  {
+    ScopedAcquire<KernelMutex> lock(&runtime->prefetch_lock_);
+    for (auto op : ops) runtime->RemovePrefetchRanges(op);
+  }
 
+  for (auto op : ops) {
     if (op->completion.handle != 0) Signal::Convert(op->completion)->SubRelaxed(1);
     delete op;
+  }
+}
 
-    return false;
-  };
-
-  auto no_dependencies = [](void* arg) { signal_handler(0, arg); };
+void Runtime::RemovePrefetchRanges(PrefetchOp* op) {
+  auto it = op->prefetch_map_entry;
+  while (it != prefetch_map_.end()) {
+    auto next = it->second.next;
+    prefetch_map_.erase(it);
+    it = next;
+  }
+  op->prefetch_map_entry = prefetch_map_.end();
+}
 
-  MAKE_NAMED_SCOPE_GUARD(RangeGuard, [&]() { removePrefetchRanges(op); });
+void Runtime::CoalescePrefetchSpans(std::vector<PrefetchSpan>& spans) {
+  if (spans.empty()) return;
 
-  hsa_status_t err;
-  if (num_dep_signals == 0)
-    err = AMD::hsa_amd_async_function(no_dependencies, op);
-  else
-    err = SetAsyncSignalHandler(dep_signals[num_dep_signals - 1], HSA_SIGNAL_CONDITION_EQ, 0,
-                                signal_handler, op);
-  if (err != HSA_STATUS_SUCCESS) throw AMD::hsa_exception(err, "Signal handler unable to be set.");
+  std::sort(spans.begin(), spans.end(),
+            [](const PrefetchSpan& lhs, const PrefetchSpan& rhs) { return lhs.base < rhs.base; });
 
-  RangeGuard.Dismiss();
-  OpGuard.Dismiss();
-  return HSA_STATUS_SUCCESS;
+  size_t last = 0;
+  for (size_t i = 1; i < spans.size(); i++) {
+    PrefetchSpan& prev = spans[last];
+    const PrefetchSpan& cur = spans[i];
+    uintptr_t prev_end = prev.base + prev.bytes;
+    if ((cur.node_id == prev.node_id) && (cur.base <= prev_end)) {
+      prev.bytes = Max(prev_end, cur.base + cur.bytes) - prev.base;
+      continue;
+    }
+    spans[++last] = cur;
+  }
+  spans.resize(last + 1);
 }
 
 Agent* Runtime::GetSVMPrefetchAgent(void* ptr, size_t size) {
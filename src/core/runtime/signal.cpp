@@ -46,8 +46,10 @@
 #include "core/inc/signal.h"
 
 #include <algorithm>
+#include "core/util/counters.h"
 #include "core/util/timer.h"
 #include "core/inc/runtime.h"
+#include "core/inc/interrupt_signal.h"
 
 namespace rocr {
 namespace core {
@@ -72,6 +74,7 @@ void SharedSignalPool_t::clear() {
 SharedSignal* SharedSignalPool_t::alloc() {
   ScopedAcquire<KernelMutex> lock(&lock_);
   if (free_list_.empty()) {
+    counters::Increment(counters::SignalPoolGrow);
     SharedSignal* block = reinterpret_cast<SharedSignal*>(
         allocate_(block_size_ * sizeof(SharedSignal), __alignof(SharedSignal), 0));
     if (block == nullptr) {
@@ -214,13 +217,19 @@ uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
   HsaEvent* short_evts[small_size];
   HsaEvent** evts = NULL;
   uint32_t unique_evts = 0;
+  // Signals multiplexed onto shared events may miss a wake up, sleeps are capped if any is waited.
+  bool shared_event = false;
   if (wait_hint != HSA_WAIT_STATE_ACTIVE) {
     if (signal_count > small_size)
       evts = new HsaEvent* [signal_count];
     else
       evts = short_evts;
-    for (uint32_t i = 0; i < signal_count; i++)
+    for (uint32_t i = 0; i < signal_count; i++) {
       evts[i] = signals[i]->EopEvent();
+      Signal* signal = Convert(signals[i]);
+      if (InterruptSignal::IsType(signal) && static_cast<InterruptSignal*>(signal)->SharedEvent())
+        shared_event = true;
+    }
     std::sort(evts, evts + signal_count);
     HsaEvent** end = std::unique(evts, evts + signal_count);
     unique_evts = uint32_t(end - evts);
@@ -233,8 +242,18 @@ uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
 
   timer::fast_clock::time_point start_time = timer::fast_clock::now();
 
+  uint32_t sleeps = 0;
+  MAKE_SCOPE_GUARD([&]() {
+    if (!counters::Enabled()) return;
+    if (sleeps == 0) counters::Increment(counters::SignalWaitSpin);
+    counters::Record(counters::SignalWaitTime,
+                     timer::duration_cast<std::chrono::nanoseconds>(timer::fast_clock::now() -
+                                                                    start_time).count());
+  });
+
   // Set a polling timeout value
-  const timer::fast_clock::duration kMaxElapsed = std::chrono::microseconds(200);
+  const timer::fast_clock::duration kMaxElapsed =
+      std::chrono::microseconds(core::Runtime::runtime_singleton_->flag().signal_wait_spin_us());
 
   // Convert timeout value into the fast_clock domain
   uint64_t hsa_freq;
@@ -309,6 +328,10 @@ uint32_t Signal::WaitAny(uint32_t signal_count, const hsa_signal_t* hsa_signals,
     uint64_t ct=timer::duration_cast<std::chrono::milliseconds>(
       time_remaining).count();
     wait_ms = (ct>0xFFFFFFFEu) ? 0xFFFFFFFEu : ct;
+    if (shared_event)
+      wait_ms = Min(wait_ms, uint32_t(InterruptSignal::kSharedEventWaitMs));
+    sleeps++;
+    counters::Increment(counters::SignalWaitSleep);
     hsaKmtWaitOnMultipleEvents(evts, unique_evts, false, wait_ms);
   }
 }
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/inc/timeline.h"
+
+#include "core/util/os.h"
+
+namespace rocr {
+namespace core {
+
+bool Timeline::Start(const std::string& path, uint64_t timestamp_frequency) {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (file_ != nullptr) return true;
+
+  file_ = fopen(path.c_str(), "w");
+  if (file_ == nullptr) return false;
+
+  timestamp_frequency_ = (timestamp_frequency != 0) ? timestamp_frequency : 1;
+  fprintf(file_, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf(file_,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"HSA runtime\"}}",
+          os::ProcessId());
+  enabled_.store(true, std::memory_order_release);
+  return true;
+}
+
+void Timeline::Stop() {
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (file_ == nullptr) return;
+
+  enabled_.store(false, std::memory_order_relaxed);
+  fprintf(file_, "\n]}\n");
+  fclose(file_);
+  file_ = nullptr;
+}
+
+void Timeline::Record(const char* name, uint64_t start, uint64_t end, uint32_t track, size_t size,
+                      const void* dst, const void* src) {
+  // Chrome trace timestamps are in microseconds.
+  const double scale = 1e6 / double(timestamp_frequency_);
+  const double ts = double(start) * scale;
+  const double dur = (end > start) ? double(end - start) * scale : 0.0;
+
+  ScopedAcquire<KernelMutex> lock(&lock_);
+  if (file_ == nullptr) return;
+  fprintf(file_,
+          ",\n{\"name\":\"%s\",\"cat\":\"hsa\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,"
+          "\"tid\":%u,\"args\":{\"size\":%zu,\"dst\":\"%p\",\"src\":\"%p\"}}",
+          name, ts, dur, os::ProcessId(), track, size, dst, src);
+}
+
+}  // namespace core
+}  // namespace rocr
@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2024, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_UTIL_BITMASK_H_
+#define HSA_RUNTIME_CORE_UTIL_BITMASK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ROCR_BITMASK_SSE2 1
+#endif
+
+namespace rocr {
+
+/*
+ * Fixed capacity bit mask stored as dwords, the layout used by KFD for CU masks.  Capacity is
+ * rounded up to whole 128 bit lanes so that bulk operations can run on full vectors.
+ */
+template <size_t kBits> class Bitmask {
+ public:
+  static const size_t kLanes = (kBits + 127) / 128;
+  static const size_t kDwords = kLanes * 4;
+
+  Bitmask() { Clear(); }
+
+  void Clear() { memset(words_, 0, sizeof(words_)); }
+
+  // Sets bits [0, bits) and clears the rest.
+  void SetLow(size_t bits) {
+    Clear();
+    if (bits > kDwords * 32) bits = kDwords * 32;
+    for (size_t i = 0; i < bits / 32; i++) words_[i] = UINT32_MAX;
+    if ((bits % 32) != 0) words_[bits / 32] = (1u << (bits % 32)) - 1;
+  }
+
+  // Copies up to kDwords dwords from src and clears the rest.
+  void Assign(const uint32_t* src, size_t dwords) {
+    Clear();
+    if (dwords > kDwords) dwords = kDwords;
+    memcpy(words_, src, dwords * sizeof(uint32_t));
+  }
+
+  // Clears dwords at index dwords and above.
+  void Truncate(size_t dwords) {
+    if (dwords < kDwords) memset(&words_[dwords], 0, (kDwords - dwords) * sizeof(uint32_t));
+  }
+
+  // this &= rhs.  Returns true if any set bit was cleared.
+  bool Intersect(const Bitmask& rhs) {
+#ifdef ROCR_BITMASK_SSE2
+    __m128i dropped = _mm_setzero_si128();
+    for (size_t i = 0; i < kLanes; i++) {
+      __m128i* dst = reinterpret_cast<__m128i*>(&words_[i * 4]);
+      const __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&rhs.words_[i * 4]));
+      const __m128i cur = _mm_loadu_si128(dst);
+      dropped = _mm_or_si128(dropped, _mm_andnot_si128(src, cur));
+      _mm_storeu_si128(dst, _mm_and_si128(cur, src));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(dropped, _mm_setzero_si128())) != 0xFFFF;
+#else
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < kDwords; i++) {
+      dropped |= words_[i] & ~rhs.words_[i];
+      words_[i] &= rhs.words_[i];
+    }
+    return dropped != 0;
+#endif
+  }
+
+  bool operator==(const Bitmask& rhs) const {
+    return memcmp(words_, rhs.words_, sizeof(words_)) == 0;
+  }
+  bool operator!=(const Bitmask& rhs) const { return !(*this == rhs); }
+
+  uint32_t* data() { return words_; }
+  const uint32_t* data() const { return words_; }
+
+ private:
+  uint32_t words_[kDwords];
+};
+
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_UTIL_BITMASK_H_
@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "core/util/counters.h"
+
+#include "core/util/locks.h"
+#include "core/util/os.h"
+
+namespace rocr {
+namespace counters {
+
+std::atomic<bool> enabled(false);
+
+static Shard shards[kShardCount];
+
+static std::atomic<uint32_t> next_shard(0);
+
+static const char* const counter_names[CounterCount] = {
+    "signal_wait_spin",   "signal_wait_sleep",   "queue_ring_full",     "signal_pool_grow",
+    "scratch_cache_hit",  "scratch_cache_miss",  "heap_block_alloc",    "intercept_overflow",
+    "pinned_cache_hit",   "pinned_cache_miss",   "interrupt_event_alloc",
+    "interrupt_event_free", "interrupt_event_peak", "interrupt_event_mux"};
+
+static const char* const histogram_names[HistogramCount] = {"signal_wait_time_ns"};
+
+Shard& LocalShard() {
+  static thread_local uint32_t index = uint32_t(-1);
+  if (index == uint32_t(-1))
+    index = next_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  return shards[index];
+}
+
+void Enable(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+uint64_t Read(Counter id) {
+  uint64_t sum = 0;
+  for (auto& shard : shards) sum += shard.counters[id].load(std::memory_order_relaxed);
+  return sum;
+}
+
+void Read(Histogram id, uint32_t num_buckets, uint64_t* buckets) {
+  num_buckets = Min(num_buckets, kHistogramBuckets);
+  for (uint32_t i = 0; i < num_buckets; i++) {
+    buckets[i] = 0;
+    for (auto& shard : shards) buckets[i] += shard.histograms[id][i].load(std::memory_order_relaxed);
+  }
+}
+
+void Reset() {
+  for (auto& shard : shards) {
+    for (auto& counter : shard.counters) counter.store(0, std::memory_order_relaxed);
+    for (auto& histogram : shard.histograms)
+      for (auto& bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Dump(FILE* stream) {
+  fprintf(stream, "HSA runtime counters:\n");
+  for (uint32_t i = 0; i < CounterCount; i++) {
+    uint64_t value = Read(Counter(i));
+    if (value != 0) fprintf(stream, "  %s: %lu\n", counter_names[i], (unsigned long)value);
+  }
+  for (uint32_t i = 0; i < HistogramCount; i++) {
+    uint64_t buckets[kHistogramBuckets];
+    Read(Histogram(i), kHistogramBuckets, buckets);
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+      if (buckets[b] != 0)
+        fprintf(stream, "  %s[2^%u]: %lu\n", histogram_names[i], b, (unsigned long)buckets[b]);
+    }
+  }
+  fflush(stream);
+}
+
+static struct {
+  os::Thread thread;
+  os::EventHandle stop;
+  std::atomic<bool> stopping;
+  uint32_t period_ms;
+} dump_state = {nullptr, nullptr, {false}, 0};
+
+static void DumpLoop(void*) {
+  while (true) {
+    os::WaitForOsEvent(dump_state.stop, dump_state.period_ms);
+    if (dump_state.stopping.load(std::memory_order_acquire)) return;
+    Dump(stderr);
+  }
+}
+
+void StartPeriodicDump(uint32_t period_ms) {
+  if (dump_state.thread != nullptr || period_ms == 0) return;
+  dump_state.stop = os::CreateOsEvent(false, false);
+  if (dump_state.stop == nullptr) return;
+  dump_state.period_ms = period_ms;
+  dump_state.stopping.store(false, std::memory_order_relaxed);
+  dump_state.thread = os::CreateThread(DumpLoop, nullptr);
+  if (dump_state.thread == nullptr) {
+    os::DestroyOsEvent(dump_state.stop);
+    dump_state.stop = nullptr;
+  }
+}
+
+void StopPeriodicDump() {
+  if (dump_state.thread == nullptr) return;
+  dump_state.stopping.store(true, std::memory_order_release);
+  os::SetOsEvent(dump_state.stop);
+  os::WaitForThread(dump_state.thread);
+  os::CloseThread(dump_state.thread);
+  os::DestroyOsEvent(dump_state.stop);
+  dump_state.thread = nullptr;
+  dump_state.stop = nullptr;
+  Dump(stderr);
+}
+
+}  // namespace counters
+}  // namespace rocr
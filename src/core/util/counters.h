@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIESd OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_CORE_UTIL_COUNTERS_H_
+#define HSA_RUNTIME_CORE_UTIL_COUNTERS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+
+#include "core/util/utils.h"
+
+namespace rocr {
+namespace counters {
+
+// Event counters.  Order must match hsa_amd_runtime_counter_t.
+enum Counter : uint32_t {
+  SignalWaitSpin,      // Signal waits satisfied without sleeping.
+  SignalWaitSleep,     // Sleeps on KFD events during signal waits.
+  QueueRingFull,       // Internal queue write index acquisitions which stalled on a full ring.
+  SignalPoolGrow,      // Shared signal pool block allocations.
+  ScratchCacheHit,     // Queue scratch requests served from the scratch cache.
+  ScratchCacheMiss,    // Queue scratch requests which needed a new allocation.
+  HeapBlockAlloc,      // SimpleHeap block allocations.
+  InterceptOverflow,   // Intercept queue packets deferred to the overflow buffer.
+  PinnedCacheHit,      // Host memory locks served by an existing registration.
+  PinnedCacheMiss,     // Host memory locks which registered memory with the kernel driver.
+  InterruptEventAlloc, // Dedicated interrupt events handed to signals.
+  InterruptEventFree,  // Dedicated interrupt events returned by signals.
+  InterruptEventPeak,  // Rises of the dedicated interrupt event high water mark.
+  InterruptEventMux,   // Signals multiplexed onto a shared interrupt event.
+  CounterCount
+};
+
+// Histograms of nanosecond durations.  Order must match hsa_amd_runtime_histogram_t.
+enum Histogram : uint32_t {
+  SignalWaitTime,      // Time spent in signal waits.
+  HistogramCount
+};
+
+// Bucket i holds values in [2^i, 2^(i+1)), bucket 0 also holds 0.  The last bucket is open ended.
+static const uint32_t kHistogramBuckets = 40;
+
+// Number of shards that counters are spread over.  Threads are assigned a shard round robin.
+static const uint32_t kShardCount = 64;
+
+struct Shard {
+  std::atomic<uint64_t> counters[CounterCount];
+  std::atomic<uint64_t> histograms[HistogramCount][kHistogramBuckets];
+} __ALIGNED__(64);
+
+extern std::atomic<bool> enabled;
+
+Shard& LocalShard();
+
+static __forceinline bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+void Enable(bool enable);
+
+static __forceinline void Increment(Counter id, uint64_t delta = 1) {
+  if (!Enabled()) return;
+  LocalShard().counters[id].fetch_add(delta, std::memory_order_relaxed);
+}
+
+static __forceinline uint32_t HistogramBucket(uint64_t value) {
+  return (value == 0) ? 0 : Min<uint32_t>(63 - __builtin_clzll(value), kHistogramBuckets - 1);
+}
+
+static __forceinline void Record(Histogram id, uint64_t value) {
+  if (!Enabled()) return;
+  LocalShard().histograms[id][HistogramBucket(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Sum of a counter across all shards.
+uint64_t Read(Counter id);
+
+// Sum of a histogram across all shards.  Copies min(num_buckets, kHistogramBuckets) buckets.
+void Read(Histogram id, uint32_t num_buckets, uint64_t* buckets);
+
+void Reset();
+
+// Print all non-zero counters and histograms.
+void Dump(FILE* stream);
+
+// Start or stop a background thread which dumps to stderr every period_ms milliseconds.
+void StartPeriodicDump(uint32_t period_ms);
+void StopPeriodicDump();
+
+}  // namespace counters
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_CORE_UTIL_COUNTERS_H_
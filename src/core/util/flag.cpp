@@ -43,10 +43,13 @@
 #include "core/util/flag.h"
 #include "core/util/utils.h"
 
+#include <stdlib.h>
+
 #include <vector>
 #include <map>
 #include <string>
 #include <algorithm>
+#include <fstream>
 #include <locale>
 
 namespace rocr {
@@ -101,6 +104,113 @@ static std::vector<uint32_t> get_elements(std::string& str, uint32_t maxElement)
   return ret;
 };
 
+static std::string trim(const std::string& str) {
+  const char* space = " \t\r\n";
+  size_t first = str.find_first_not_of(space);
+  if (first == std::string::npos) return std::string();
+  return str.substr(first, str.find_last_not_of(space) - first + 1);
+}
+
+/*
+HSA_CONFIG_FILE names a file of NAME=VALUE lines using the same names and
+values as the environment variables.  Blank lines and lines starting with #
+are ignored.  Environment variables take precedence over the file.
+*/
+void Flag::LoadConfigFile() {
+  config_file_.clear();
+  effective_.clear();
+
+  std::string path = os::GetEnvVar("HSA_CONFIG_FILE");
+  if (path.empty()) return;
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    fprintf(stderr, "HSA_CONFIG_FILE %s could not be opened.\n", path.c_str());
+    return;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#') continue;
+    size_t pos = line.find('=');
+    if (pos == std::string::npos) continue;
+    config_file_[trim(line.substr(0, pos))] = trim(line.substr(pos + 1));
+  }
+}
+
+std::string Flag::GetVar(const std::string& name) const {
+  if (os::IsEnvVarSet(name)) return os::GetEnvVar(name);
+  auto it = config_file_.find(name);
+  return (it == config_file_.end()) ? std::string() : it->second;
+}
+
+bool Flag::IsSet(const std::string& name) const {
+  return os::IsEnvVarSet(name) || (config_file_.find(name) != config_file_.end());
+}
+
+bool Flag::GetBool(const std::string& name, bool default_value) {
+  std::string var = GetVar(name);
+  bool value = (var == "1") ? true : ((var == "0") ? false : default_value);
+  effective_[name] = value ? "1" : "0";
+  return value;
+}
+
+uint64_t Flag::GetUint(const std::string& name, uint64_t default_value, uint64_t min,
+                       uint64_t max) {
+  std::string var = GetVar(name);
+  uint64_t value = default_value;
+  if (!var.empty()) {
+    char* end;
+    uint64_t parsed = strtoull(var.c_str(), &end, 10);
+    if (*end == '\0' && var[0] != '-' && parsed >= min && parsed <= max) value = parsed;
+  }
+  effective_[name] = std::to_string(value);
+  return value;
+}
+
+std::string Flag::GetString(const std::string& name) {
+  std::string value = GetVar(name);
+  effective_[name] = value;
+  return value;
+}
+
+void Flag::Dump(FILE* stream) const {
+  for (auto& var : effective_) {
+    uint64_t value;
+    if (GetTunable(var.first, &value) == HSA_STATUS_SUCCESS)
+      fprintf(stream, "%s=%lu\n", var.first.c_str(), (unsigned long)value);
+    else
+      fprintf(stream, "%s=%s\n", var.first.c_str(), var.second.c_str());
+  }
+}
+
+hsa_status_t Flag::SetTunable(const std::string& name, uint64_t value) {
+  if (name == "HSA_FORCE_SDMA_SIZE") {
+    if (value > kMaxForceSdmaSize) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    force_sdma_size_.store(value, std::memory_order_relaxed);
+    return HSA_STATUS_SUCCESS;
+  }
+  if (name == "HSA_SIGNAL_WAIT_SPIN_US") {
+    if (value > kMaxSignalWaitSpinUs) return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    signal_wait_spin_us_.store(uint32_t(value), std::memory_order_relaxed);
+    return HSA_STATUS_SUCCESS;
+  }
+  return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+}
+
+hsa_status_t Flag::GetTunable(const std::string& name, uint64_t* value) const {
+  if (name == "HSA_FORCE_SDMA_SIZE") {
+    *value = force_sdma_size();
+    return HSA_STATUS_SUCCESS;
+  }
+  if (name == "HSA_SIGNAL_WAIT_SPIN_US") {
+    *value = signal_wait_spin_us();
+    return HSA_STATUS_SUCCESS;
+  }
+  return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+}
+
 /*
 Parse env var per the following syntax, all whitespace is ignored:
 
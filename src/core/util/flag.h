@@ -44,11 +44,14 @@
 #define HSA_RUNTIME_CORE_INC_FLAG_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
+#include <atomic>
 #include <vector>
 #include <map>
 #include <string>
 
+#include "inc/hsa.h"
 #include "core/util/os.h"
 #include "core/util/utils.h"
 
@@ -67,96 +70,138 @@ class Flag {
 
   virtual ~Flag() {}
 
+  // Values are taken from the environment, falling back to the optional
+  // HSA_CONFIG_FILE, then to the built in default.
   void Refresh() {
-    std::string var = os::GetEnvVar("HSA_CHECK_FLAT_SCRATCH");
-    check_flat_scratch_ = (var == "1") ? true : false;
+    LoadConfigFile();
 
-    var = os::GetEnvVar("HSA_ENABLE_VM_FAULT_MESSAGE");
-    enable_vm_fault_message_ = (var == "0") ? false : true;
+    check_flat_scratch_ = GetBool("HSA_CHECK_FLAT_SCRATCH", false);
 
-    var = os::GetEnvVar("HSA_ENABLE_QUEUE_FAULT_MESSAGE");
-    enable_queue_fault_message_ = (var == "0") ? false : true;
+    enable_vm_fault_message_ = GetBool("HSA_ENABLE_VM_FAULT_MESSAGE", true);
 
-    var = os::GetEnvVar("HSA_ENABLE_INTERRUPT");
-    enable_interrupt_ = (var == "0") ? false : true;
+    enable_queue_fault_message_ = GetBool("HSA_ENABLE_QUEUE_FAULT_MESSAGE", true);
 
-    var = os::GetEnvVar("HSA_ENABLE_SDMA");
+    enable_interrupt_ = GetBool("HSA_ENABLE_INTERRUPT", true);
+
+    std::string var = GetString("HSA_ENABLE_SDMA");
     enable_sdma_ = (var == "0") ? SDMA_DISABLE : ((var == "1") ? SDMA_ENABLE : SDMA_DEFAULT);
 
-    visible_gpus_ = os::GetEnvVar("ROCR_VISIBLE_DEVICES");
-    filter_visible_gpus_ = os::IsEnvVarSet("ROCR_VISIBLE_DEVICES");
+    visible_gpus_ = GetString("ROCR_VISIBLE_DEVICES");
+    filter_visible_gpus_ = IsSet("ROCR_VISIBLE_DEVICES");
+
+    running_valgrind_ = GetBool("HSA_RUNNING_UNDER_VALGRIND", false);
+
+    sdma_wait_idle_ = GetBool("HSA_SDMA_WAIT_IDLE", false);
+
+    max_queues_ = GetUint("HSA_MAX_QUEUES", 0, 0, UINT32_MAX);
 
-    var = os::GetEnvVar("HSA_RUNNING_UNDER_VALGRIND");
-    running_valgrind_ = (var == "1") ? true : false;
+    // Destroyed AQL queue buffers parked per agent for reuse by later queues, 0 disables.
+    queue_pool_size_ = GetUint("HSA_QUEUE_POOL_SIZE", 4, 0, 1024);
 
-    var = os::GetEnvVar("HSA_SDMA_WAIT_IDLE");
-    sdma_wait_idle_ = (var == "1") ? true : false;
+    // Interrupt events created at init so signal creation avoids the driver, 0 creates lazily.
+    event_pool_size_ = GetUint("HSA_EVENT_POOL_SIZE", 32, 0, 4096);
 
-    var = os::GetEnvVar("HSA_MAX_QUEUES");
-    max_queues_ = static_cast<uint32_t>(atoi(var.c_str()));
+    scratch_mem_size_ = GetUint("HSA_SCRATCH_MEM", 0, 0, SIZE_MAX);
 
-    var = os::GetEnvVar("HSA_SCRATCH_MEM");
-    scratch_mem_size_ = atoi(var.c_str());
+    tools_lib_names_ = GetString("HSA_TOOLS_LIB");
 
-    tools_lib_names_ = os::GetEnvVar("HSA_TOOLS_LIB");
+    api_trace_file_ = GetString("HSA_API_TRACE_FILE");
 
-    var = os::GetEnvVar("HSA_TOOLS_REPORT_LOAD_FAILURE");
+    timeline_file_ = GetString("HSA_TIMELINE_FILE");
 
-    ifdebug {
-      report_tool_load_failures_ = (var == "1") ? true : false;
-    } else {
-      report_tool_load_failures_ = (var == "0") ? false : true;
-    }
+    bool report_tool_load_failures = true;
+    ifdebug { report_tool_load_failures = false; }
+    report_tool_load_failures_ =
+        GetBool("HSA_TOOLS_REPORT_LOAD_FAILURE", report_tool_load_failures);
 
-    var = os::GetEnvVar("HSA_DISABLE_FRAGMENT_ALLOCATOR");
-    disable_fragment_alloc_ = (var == "1") ? true : false;
+    disable_fragment_alloc_ = GetBool("HSA_DISABLE_FRAGMENT_ALLOCATOR", false);
 
-    var = os::GetEnvVar("HSA_ENABLE_SDMA_HDP_FLUSH");
-    enable_sdma_hdp_flush_ = (var == "0") ? false : true;
+    enable_sdma_hdp_flush_ = GetBool("HSA_ENABLE_SDMA_HDP_FLUSH", true);
 
-    var = os::GetEnvVar("HSA_REV_COPY_DIR");
-    rev_copy_dir_ = (var == "1") ? true : false;
+    rev_copy_dir_ = GetBool("HSA_REV_COPY_DIR", false);
 
-    var = os::GetEnvVar("HSA_FORCE_FINE_GRAIN_PCIE");
-    fine_grain_pcie_ = (var == "1") ? true : false;
+    fine_grain_pcie_ = GetBool("HSA_FORCE_FINE_GRAIN_PCIE", false);
 
-    var = os::GetEnvVar("HSA_NO_SCRATCH_RECLAIM");
-    no_scratch_reclaim_ = (var == "1") ? true : false;
+    no_scratch_reclaim_ = GetBool("HSA_NO_SCRATCH_RECLAIM", false);
 
-    var = os::GetEnvVar("HSA_NO_SCRATCH_THREAD_LIMITER");
-    no_scratch_thread_limit_ = (var == "1") ? true : false;
+    no_scratch_thread_limit_ = GetBool("HSA_NO_SCRATCH_THREAD_LIMITER", false);
 
-    var = os::GetEnvVar("HSA_DISABLE_IMAGE");
-    disable_image_ = (var == "1") ? true : false;
+    disable_image_ = GetBool("HSA_DISABLE_IMAGE", false);
 
-    var = os::GetEnvVar("HSA_LOADER_ENABLE_MMAP_URI");
-    loader_enable_mmap_uri_ = (var == "1") ? true : false;
+    loader_enable_mmap_uri_ = GetBool("HSA_LOADER_ENABLE_MMAP_URI", false);
 
-    var = os::GetEnvVar("HSA_FORCE_SDMA_SIZE");
-    force_sdma_size_ = var.empty() ? 1024 * 1024 : atoi(var.c_str());
+    force_sdma_size_.store(GetUint("HSA_FORCE_SDMA_SIZE", 1024 * 1024, 0, kMaxForceSdmaSize),
+                           std::memory_order_relaxed);
+
+    check_sramecc_validity_ = !GetBool("HSA_IGNORE_SRAMECC_MISREPORT", false);
 
-    var = os::GetEnvVar("HSA_IGNORE_SRAMECC_MISREPORT");
-    check_sramecc_validity_ = (var == "1") ? false : true;
-    
     // Legal values are zero "0" or one "1". Any other value will
     // be interpreted as not defining the env variable.
-    var = os::GetEnvVar("HSA_XNACK");
+    var = GetString("HSA_XNACK");
     xnack_ = (var == "0") ? XNACK_DISABLE : ((var == "1") ? XNACK_ENABLE : XNACK_UNCHANGED);
 
-    var = os::GetEnvVar("HSA_ENABLE_DEBUG");
-    debug_ = (var == "1") ? true : false;
+    debug_ = GetBool("HSA_ENABLE_DEBUG", false);
 
-    var = os::GetEnvVar("HSA_CU_MASK_SKIP_INIT");
-    cu_mask_skip_init_ = (var == "1") ? true : false;
+    cu_mask_skip_init_ = GetBool("HSA_CU_MASK_SKIP_INIT", false);
 
     // Temporary opt-in for corrected HSA_AMD_AGENT_INFO_COOPERATIVE_COMPUTE_UNIT_COUNT behavior.
     // Will become opt-out and possibly removed in future releases.
-    var = os::GetEnvVar("HSA_COOP_CU_COUNT");
-    coop_cu_count_ = (var == "1") ? true : false;
+    coop_cu_count_ = GetBool("HSA_COOP_CU_COUNT", false);
+
+    // Upper bound on threads used to initialize GPU agents.  0 selects the hardware
+    // concurrency, 1 initializes agents serially.
+    init_threads_ = GetUint("HSA_INIT_THREADS", 0, 0, UINT32_MAX);
+
+    init_timing_ = GetBool("HSA_INIT_TIMING", false);
+
+    // Append a JSON line with the hsa_init phase breakdown to this file.
+    init_profile_file_ = GetString("HSA_INIT_PROFILE_FILE");
+
+    // Defer per GPU scratch and trap handler setup until the GPU's first queue is created.
+    lazy_agent_init_ = GetBool("HSA_LAZY_AGENT_INIT", false);
+
+    runtime_counters_ = GetBool("HSA_RUNTIME_COUNTERS", false);
+
+    // Period in milliseconds for dumping runtime counters to stderr, 0 disables.
+    runtime_counters_dump_ms_ = GetUint("HSA_RUNTIME_COUNTERS_DUMP_MS", 0, 0, UINT32_MAX);
+
+    // Collect per queue dispatch latency histograms on user GPU queues.
+    queue_latency_stats_ = GetBool("HSA_QUEUE_LATENCY_STATS", false);
+
+    // Time signal waits spin before sleeping.  Should be a few times bigger than null kernel
+    // latency.
+    signal_wait_spin_us_.store(GetUint("HSA_SIGNAL_WAIT_SPIN_US", 200, 0, kMaxSignalWaitSpinUs),
+                               std::memory_order_relaxed);
+
+    // Bytes of unlocked host memory registrations kept pinned for reuse by later locks, 0
+    // disables the cache.
+    pinned_cache_bytes_ = GetUint("HSA_PINNED_CACHE_BYTES", 0, 0, UINT64_MAX);
+
+    // System memory allocations of at least this many bytes are rounded to 2MB and advised to use
+    // transparent huge pages, 0 disables.
+    sysmem_huge_page_threshold_ = GetUint("HSA_SYSMEM_HUGE_PAGE_THRESHOLD", 0, 0, UINT64_MAX);
+
+    // Interleave runtime wide system memory pools over all NUMA nodes instead of binding them to
+    // the first CPU's node.
+    sysmem_interleave_ = GetBool("HSA_SYSMEM_INTERLEAVE", false);
+
+    // Print the effective configuration to stderr at hsa_init.
+    config_dump_ = GetBool("HSA_CONFIG_DUMP", false);
   }
 
+  // @brief Print the effective configuration, one NAME=value per line.
+  void Dump(FILE* stream) const;
+
+  // @brief Update a runtime adjustable value.  Returns
+  // HSA_STATUS_ERROR_INVALID_ARGUMENT if @p name is not adjustable or
+  // @p value is out of range.
+  hsa_status_t SetTunable(const std::string& name, uint64_t value);
+
+  // @brief Read a runtime adjustable value.
+  hsa_status_t GetTunable(const std::string& name, uint64_t* value) const;
+
   void parse_masks(uint32_t maxGpu, uint32_t maxCU) {
-    std::string var = os::GetEnvVar("HSA_CU_MASK");
+    std::string var = GetVar("HSA_CU_MASK");
     parse_masks(var, maxGpu, maxCU);
   }
 
@@ -194,15 +239,23 @@ class Flag {
 
   uint32_t max_queues() const { return max_queues_; }
 
+  uint32_t queue_pool_size() const { return queue_pool_size_; }
+
+  uint32_t event_pool_size() const { return event_pool_size_; }
+
   size_t scratch_mem_size() const { return scratch_mem_size_; }
 
   std::string tools_lib_names() const { return tools_lib_names_; }
 
+  const std::string& api_trace_file() const { return api_trace_file_; }
+
+  const std::string& timeline_file() const { return timeline_file_; }
+
   bool disable_image() const { return disable_image_; }
 
   bool loader_enable_mmap_uri() const { return loader_enable_mmap_uri_; }
 
-  size_t force_sdma_size() const { return force_sdma_size_; }
+  size_t force_sdma_size() const { return force_sdma_size_.load(std::memory_order_relaxed); }
 
   bool check_sramecc_validity() const { return check_sramecc_validity_; }
 
@@ -221,7 +274,51 @@ class Flag {
 
   bool coop_cu_count() const { return coop_cu_count_; }
 
+  uint32_t init_threads() const { return init_threads_; }
+
+  bool init_timing() const { return init_timing_; }
+
+  const std::string& init_profile_file() const { return init_profile_file_; }
+
+  bool lazy_agent_init() const { return lazy_agent_init_; }
+
+  bool runtime_counters() const { return runtime_counters_; }
+
+  uint32_t runtime_counters_dump_ms() const { return runtime_counters_dump_ms_; }
+
+  bool queue_latency_stats() const { return queue_latency_stats_; }
+
+  uint32_t signal_wait_spin_us() const {
+    return signal_wait_spin_us_.load(std::memory_order_relaxed);
+  }
+
+  bool config_dump() const { return config_dump_; }
+
+  size_t pinned_cache_bytes() const { return pinned_cache_bytes_; }
+
+  size_t sysmem_huge_page_threshold() const { return sysmem_huge_page_threshold_; }
+
+  bool sysmem_interleave() const { return sysmem_interleave_; }
+
  private:
+  static const uint64_t kMaxForceSdmaSize = 1ull << 40;
+  static const uint64_t kMaxSignalWaitSpinUs = 1000000;
+
+  // Read HSA_CONFIG_FILE into ::config_file_.
+  void LoadConfigFile();
+
+  // Raw value of @p name from the environment or config file, empty if unset.
+  std::string GetVar(const std::string& name) const;
+
+  bool IsSet(const std::string& name) const;
+
+  // Typed parsers which record the effective value for Dump.  GetBool accepts
+  // "0" and "1", GetUint accepts base 10 values within [min, max]; anything
+  // else selects the default.
+  bool GetBool(const std::string& name, bool default_value);
+  uint64_t GetUint(const std::string& name, uint64_t default_value, uint64_t min, uint64_t max);
+  std::string GetString(const std::string& name);
+
   bool check_flat_scratch_;
   bool enable_vm_fault_message_;
   bool enable_interrupt_;
@@ -241,6 +338,13 @@ class Flag {
   bool debug_;
   bool cu_mask_skip_init_;
   bool coop_cu_count_;
+  bool init_timing_;
+  bool lazy_agent_init_;
+  bool runtime_counters_;
+  bool queue_latency_stats_;
+  bool config_dump_;
+
+  bool sysmem_interleave_;
 
   SDMA_OVERRIDE enable_sdma_;
 
@@ -249,11 +353,37 @@ class Flag {
 
   uint32_t max_queues_;
 
+  uint32_t queue_pool_size_;
+
+  uint32_t event_pool_size_;
+
+  uint32_t init_threads_;
+
+  uint32_t runtime_counters_dump_ms_;
+
   size_t scratch_mem_size_;
 
+  size_t pinned_cache_bytes_;
+
+  size_t sysmem_huge_page_threshold_;
+
   std::string tools_lib_names_;
 
-  size_t force_sdma_size_;
+  std::string api_trace_file_;
+
+  std::string timeline_file_;
+
+  std::string init_profile_file_;
+
+  // Runtime adjustable, see SetTunable.
+  std::atomic<size_t> force_sdma_size_;
+  std::atomic<uint32_t> signal_wait_spin_us_;
+
+  // NAME=value pairs from HSA_CONFIG_FILE.
+  std::map<std::string, std::string> config_file_;
+
+  // Effective values recorded by the typed parsers.
+  std::map<std::string, std::string> effective_;
 
   // Indicates user preference for Xnack state.
   XNACK_REQUEST xnack_;
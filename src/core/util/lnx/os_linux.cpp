@@ -49,11 +49,17 @@
 #include <pthread.h>
 #include <limits.h>
 #include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
 #include <sys/utsname.h>
 #include <unistd.h>
 #include <errno.h>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <atomic>
 #include <memory>
@@ -229,6 +235,8 @@ void uSleep(int delayInUs) { usleep(delayInUs); }
 
 void YieldThread() { sched_yield(); }
 
+uint32_t ProcessId() { return uint32_t(getpid()); }
+
 Thread CreateThread(ThreadEntry function, void* threadArgument, uint stackSize) {
   os_thread* result = new os_thread(function, threadArgument, stackSize);
   if (!result->Valid()) {
@@ -515,6 +523,152 @@ void DestroySharedMutex(SharedMutex lock) {
   delete *(pthread_rwlock_t**)&lock;
 }
 
+// Returns an unlinked file descriptor of size bytes, -1 if failed.
+static int CreateAnonymousFile(size_t size, bool huge_pages) {
+  int fd;
+#ifdef HAVE_MEMFD_CREATE
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+  unsigned int flags = MFD_CLOEXEC | (huge_pages ? MFD_HUGETLB : 0);
+  fd = int(syscall(__NR_memfd_create, "hsa_ring", flags));
+  if (fd == -1) return -1;
+
+  if (ftruncate(fd, size) == -1) {
+    close(fd);
+    return -1;
+  }
+#else
+  if (huge_pages) return -1;
+
+  // Names only need to be unique until unlinked below.
+  static std::atomic<uint32_t> serial(0);
+  char path[64];
+  snprintf(path, sizeof(path), "/hsa_ring_%d_%u", int(getpid()),
+           serial.fetch_add(1, std::memory_order_relaxed));
+
+  fd = shm_open(path, O_CREAT | O_RDWR | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd == -1) return -1;
+  shm_unlink(path);
+
+  if (posix_fallocate(fd, 0, size) != 0) {
+    close(fd);
+    return -1;
+  }
+#endif
+  return fd;
+}
+
+static void* MapDoubleMapped(size_t size, bool executable, bool huge_pages) {
+  int fd = CreateAnonymousFile(size, huge_pages);
+  if (fd == -1) return NULL;
+
+  // Reserve a VA range twice the size of the backing store, then map both
+  // halves over it.  With huge pages the halves must also be 2MB aligned.
+  const size_t align = huge_pages ? (2ul << 20) : 0;
+  const size_t reserve_size = 2 * size + align;
+  void* reserve = mmap(NULL, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserve == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+  uintptr_t base = uintptr_t(reserve);
+  if (align != 0) {
+    base = AlignUp(base, align);
+    if (base != uintptr_t(reserve)) munmap(reserve, base - uintptr_t(reserve));
+    size_t tail = uintptr_t(reserve) + reserve_size - (base + 2 * size);
+    if (tail != 0) munmap((void*)(base + 2 * size), tail);
+  }
+
+  const int prot = PROT_READ | PROT_WRITE | (executable ? PROT_EXEC : 0);
+  void* lower = mmap((void*)base, size, prot, MAP_SHARED | MAP_FIXED, fd, 0);
+  void* upper = mmap((void*)(base + size), size, prot, MAP_SHARED | MAP_FIXED, fd, 0);
+
+  // Mappings hold their own reference to the backing store.
+  close(fd);
+
+  if (lower == MAP_FAILED || upper == MAP_FAILED) {
+    munmap((void*)base, 2 * size);
+    return NULL;
+  }
+  return (void*)base;
+}
+
+void* AllocateDoubleMapped(size_t size, bool executable, bool huge_pages) {
+  if (huge_pages && (size % (2ul << 20)) == 0) {
+    void* ret = MapDoubleMapped(size, executable, true);
+    if (ret != NULL) return ret;
+  }
+  return MapDoubleMapped(size, executable, false);
+}
+
+void FreeDoubleMapped(void* mem, size_t size) { munmap(mem, 2 * size); }
+
+bool AdviseHugePages(void* mem, size_t size) {
+#ifdef MADV_HUGEPAGE
+  return madvise(mem, size, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif
+}
+
+bool InterleaveMemory(void* mem, size_t size) {
+  static const int kMpolInterleave = 3;
+  static const size_t kMaxNodes = 1024;
+  unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {0};
+  const size_t bits_per_word = 8 * sizeof(unsigned long);
+
+  // Node list format is "0-3,5".
+  FILE* file = fopen("/sys/devices/system/node/has_memory", "r");
+  if (file == NULL) return false;
+  char list[256] = {0};
+  bool read = (fgets(list, sizeof(list), file) != NULL);
+  fclose(file);
+  if (!read) return false;
+
+  uint32_t node_count = 0;
+  char* pos = list;
+  while (*pos != '\0' && *pos != '\n') {
+    char* next;
+    unsigned long first = strtoul(pos, &next, 10);
+    if (next == pos) return false;
+    unsigned long last = first;
+    if (*next == '-') {
+      pos = next + 1;
+      last = strtoul(pos, &next, 10);
+      if (next == pos) return false;
+    }
+    for (unsigned long node = first; node <= last && node < kMaxNodes; node++) {
+      mask[node / bits_per_word] |= 1ul << (node % bits_per_word);
+      node_count++;
+    }
+    pos = (*next == ',') ? next + 1 : next;
+  }
+
+  if (node_count < 2) return true;
+  return syscall(__NR_mbind, mem, size, kMpolInterleave, mask, kMaxNodes + 1, 0) == 0;
+}
+
+void* AllocateHostMemory(size_t size, size_t alignment) {
+  // Over reserve and trim to the alignment.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t reserve_size = size + alignment - page_size;
+  void* reserve =
+      mmap(NULL, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserve == MAP_FAILED) return NULL;
+
+  const uintptr_t base = AlignUp(uintptr_t(reserve), alignment);
+  if (base != uintptr_t(reserve)) munmap(reserve, base - uintptr_t(reserve));
+  const size_t tail = uintptr_t(reserve) + reserve_size - (base + size);
+  if (tail != 0) munmap((void*)(base + size), tail);
+  return (void*)base;
+}
+
+void FreeHostMemory(void* mem, size_t size) { munmap(mem, size); }
+
 }   //  namespace os
 }   //  namespace rocr
 
@@ -168,6 +168,11 @@ void uSleep(int delayInUs);
 /// @return: void.
 void YieldThread();
 
+/// @brief: Gets the id of the calling process.
+/// @param: void.
+/// @return: uint32_t, process id.
+uint32_t ProcessId();
+
 typedef void (*ThreadEntry)(void*);
 
 /// @brief: Creates a thread will return NULL if failed.
@@ -266,6 +271,42 @@ uint64_t ReadAccurateClock();
 /// seconds.  This frequency does not change at runtime.
 /// @return returns the frequency
 uint64_t AccurateClockFrequency();
+
+/// @brief Allocates 2 * size bytes of virtual address space whose upper half
+/// maps the same pages as the lower half, so writes through either alias.
+/// Used for ring buffers that must tolerate accesses one lap past the end.
+/// @param: size(Input), size of each half, a multiple of the page size.
+/// @param: executable(Input), map the pages with execute permission.
+/// @param: huge_pages(Input), back with 2MB pages when size allows and the
+/// system has them reserved, falling back to regular pages otherwise.
+/// @return: base of the mapping, NULL if failed.
+void* AllocateDoubleMapped(size_t size, bool executable, bool huge_pages);
+
+/// @brief Hints that a page aligned range should be backed by transparent huge
+/// pages when it is first touched.
+/// @return: true if the hint was accepted.
+bool AdviseHugePages(void* mem, size_t size);
+
+/// @brief Interleaves page placement of a page aligned, untouched range over
+/// all NUMA nodes which have memory.
+/// @return: true if the policy was applied or there is only one such node.
+bool InterleaveMemory(void* mem, size_t size);
+
+/// @brief Releases a mapping returned by AllocateDoubleMapped.
+/// @param: mem(Input), base of the mapping.
+/// @param: size(Input), size of each half as passed to AllocateDoubleMapped.
+void FreeDoubleMapped(void* mem, size_t size);
+
+/// @brief Maps private anonymous memory without touching it, so that placement
+/// hints can be applied before any page is allocated.
+/// @param: size(Input), a multiple of the page size.
+/// @param: alignment(Input), power of two alignment of the base, at least the
+/// page size.
+/// @return: base of the mapping, NULL if failed.
+void* AllocateHostMemory(size_t size, size_t alignment);
+
+/// @brief Releases a mapping returned by AllocateHostMemory.
+void FreeHostMemory(void* mem, size_t size);
 }   //  namespace os
 }   //  namespace rocr
 
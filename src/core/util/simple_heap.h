@@ -51,6 +51,7 @@
 #include <deque>
 #include <utility>
 
+#include "core/util/counters.h"
 #include "core/util/utils.h"
 
 namespace rocr {
@@ -171,6 +172,7 @@ template <typename Allocator> class SimpleHeap {
       block_cache_.pop_back();
       cache_size_ -= size;
     } else {  // Alloc new block - new block may be larger than default.
+      counters::Increment(counters::HeapBlockAlloc);
       void* ptr = block_allocator_.alloc(bytes, size);
       base = reinterpret_cast<uintptr_t>(ptr);
       assert(ptr != nullptr && "Block allocation failed, Allocator is expected to throw.");
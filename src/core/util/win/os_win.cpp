@@ -102,6 +102,8 @@ void uSleep(int delayInUs) { ::Sleep(delayInUs / 1000); }
 
 void YieldThread() { ::Sleep(0); }
 
+uint32_t ProcessId() { return uint32_t(GetCurrentProcessId()); }
+
 struct ThreadArgs {
   void* entry_args;
   ThreadEntry entry_function;
@@ -270,6 +272,57 @@ void DestroySharedMutex(SharedMutex lock) {
   abort();
 }
 
+void* AllocateDoubleMapped(size_t size, bool executable, bool huge_pages) {
+  // Large pages can not be double mapped through a page file section.
+  HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+                                     DWORD(uint64_t(size) >> 32), DWORD(size), NULL);
+  if (mapping == NULL) return NULL;
+
+  const DWORD access = FILE_MAP_ALL_ACCESS | (executable ? FILE_MAP_EXECUTE : 0);
+  void* ret = NULL;
+
+  // Retry until obtaining an appropriate virtual address mapping.
+  for (int num_attempts = 0; num_attempts < 1000; ++num_attempts) {
+    // Find a virtual address range twice the size of the file mapping.
+    void* reserve_va = VirtualAllocEx(GetCurrentProcess(), NULL, 2 * size,
+                                      MEM_TOP_DOWN | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+    if (reserve_va == NULL) break;
+    VirtualFree(reserve_va, 0, MEM_RELEASE);
+
+    // Map the ring buffer into the free virtual range.
+    // This may fail: another thread can allocate in this range.
+    void* lower = MapViewOfFileEx(mapping, access, 0, 0, size, reserve_va);
+    if (lower == NULL) continue;
+
+    void* upper = MapViewOfFileEx(mapping, access, 0, 0, size,
+                                  (void*)(uintptr_t(reserve_va) + size));
+    if (upper == NULL) {
+      UnmapViewOfFile(lower);
+      continue;
+    }
+
+    ret = lower;
+    break;
+  }
+
+  // Release file mapping (reference counted by views).
+  CloseHandle(mapping);
+  return ret;
+}
+
+bool AdviseHugePages(void* mem, size_t size) { return false; }
+
+bool InterleaveMemory(void* mem, size_t size) { return false; }
+
+void* AllocateHostMemory(size_t size, size_t alignment) { return NULL; }
+
+void FreeHostMemory(void* mem, size_t size) {}
+
+void FreeDoubleMapped(void* mem, size_t size) {
+  UnmapViewOfFile(mem);
+  UnmapViewOfFile((void*)(uintptr_t(mem) + size));
+}
+
 }   //  namespace os
 }   //  namespace rocr
 
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Events of the simulated thunk, following KFD semantics.  Setting an event
+// activates every thread waiting on it, and an auto-reset event only stays
+// signaled if nobody was waiting.  A wait consumes the auto-reset events in its
+// list which are already signaled.  Waiters sleep on a futex word of their own.
+// Event ids index a table so that the queue emulator can raise the event named
+// in a signal's mailbox.
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "hsakmt_sim/sim.h"
+
+namespace rocr {
+namespace sim {
+
+namespace {
+
+// A thread blocked in hsaKmtWaitOnMultipleEvents.  Fields other than wake are
+// guarded by event_lock.
+struct Waiter {
+  // Futex word, set when any event of the wait is activated.
+  std::atomic<uint32_t> wake;
+  // Per event of the wait, whether it has been activated.
+  std::vector<bool> activated;
+};
+
+struct SimEvent {
+  // Must be first, the runtime's HsaEvent* is the SimEvent*.
+  HsaEvent event;
+  bool manual_reset;
+  bool signaled;
+  // Written by the queue emulator with the event id, as firmware does.
+  uint64_t mailbox;
+  // Waits blocked on this event, with the event's index in each wait.
+  std::vector<std::pair<Waiter*, uint32_t>> waiters;
+};
+
+// KFD_SIGNAL_EVENT_LIMIT.
+const size_t kDefaultEventLimit = 4096;
+
+std::mutex event_lock;
+std::vector<SimEvent*> events(1, nullptr);
+std::vector<uint32_t> free_ids;
+size_t event_limit = kDefaultEventLimit;
+
+// Requires event_lock.
+void Set(SimEvent* evt) {
+  for (auto& waiter : evt->waiters) {
+    waiter.first->activated[waiter.second] = true;
+    waiter.first->wake.store(1, std::memory_order_release);
+    syscall(SYS_futex, &waiter.first->wake, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+  }
+  evt->signaled = evt->manual_reset || evt->waiters.empty();
+}
+
+// Requires event_lock.
+bool Satisfied(const Waiter& waiter, bool all) {
+  const size_t ready = std::count(waiter.activated.begin(), waiter.activated.end(), true);
+  return all ? (ready == waiter.activated.size()) : (ready != 0);
+}
+
+}  // namespace
+
+void SignalEventId(uint32_t event_id) {
+  std::lock_guard<std::mutex> lock(event_lock);
+  if ((event_id < events.size()) && (events[event_id] != nullptr)) Set(events[event_id]);
+}
+
+size_t LiveEvents() {
+  std::lock_guard<std::mutex> lock(event_lock);
+  return events.size() - 1 - free_ids.size();
+}
+
+void SetEventLimit(size_t limit) {
+  std::lock_guard<std::mutex> lock(event_lock);
+  event_limit = limit;
+}
+
+void ShutdownEvents() {
+  std::lock_guard<std::mutex> lock(event_lock);
+  for (SimEvent* evt : events) delete evt;
+  events.assign(1, nullptr);
+  free_ids.clear();
+  event_limit = kDefaultEventLimit;
+}
+
+}  // namespace sim
+}  // namespace rocr
+
+using namespace rocr::sim;
+
+HSAKMT_STATUS hsaKmtCreateEvent(HsaEventDescriptor* EventDesc, bool ManualReset,
+                                bool IsSignaled, HsaEvent** Event) {
+  if ((EventDesc == nullptr) || (Event == nullptr)) return HSAKMT_STATUS_INVALID_PARAMETER;
+
+  SimEvent* evt = new (std::nothrow) SimEvent;
+  if (evt == nullptr) return HSAKMT_STATUS_NO_MEMORY;
+  memset(&evt->event, 0, sizeof(evt->event));
+  evt->manual_reset = ManualReset;
+  evt->signaled = IsSignaled;
+  evt->mailbox = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(event_lock);
+    if (events.size() - 1 - free_ids.size() >= event_limit) {
+      delete evt;
+      return HSAKMT_STATUS_OUT_OF_RESOURCES;
+    }
+    if (free_ids.empty()) {
+      evt->event.EventId = events.size();
+      events.push_back(evt);
+    } else {
+      evt->event.EventId = free_ids.back();
+      free_ids.pop_back();
+      events[evt->event.EventId] = evt;
+    }
+  }
+
+  evt->event.EventData.EventType = EventDesc->EventType;
+  evt->event.EventData.HWData1 = evt->event.EventId;
+  evt->event.EventData.HWData2 = reinterpret_cast<uintptr_t>(&evt->mailbox);
+  *Event = &evt->event;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtDestroyEvent(HsaEvent* Event) {
+  if (Event == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(event_lock);
+  HSAuint32 id = Event->EventId;
+  if ((id >= events.size()) || (events[id] == nullptr) || (&events[id]->event != Event))
+    return HSAKMT_STATUS_INVALID_HANDLE;
+  events[id] = nullptr;
+  free_ids.push_back(id);
+  delete reinterpret_cast<SimEvent*>(Event);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtSetEvent(HsaEvent* Event) {
+  if (Event == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(event_lock);
+  Set(reinterpret_cast<SimEvent*>(Event));
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtResetEvent(HsaEvent* Event) {
+  if (Event == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  std::lock_guard<std::mutex> lock(event_lock);
+  reinterpret_cast<SimEvent*>(Event)->signaled = false;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtWaitOnMultipleEvents(HsaEvent* Events[], HSAuint32 NumEvents, bool WaitOnAll,
+                                         HSAuint32 Milliseconds) {
+  if ((Events == nullptr) || (NumEvents == 0)) return HSAKMT_STATUS_INVALID_PARAMETER;
+
+  const uint64_t deadline = ClockNs() + uint64_t(Milliseconds) * 1000000ull;
+  Waiter waiter;
+  waiter.wake.store(0, std::memory_order_relaxed);
+  waiter.activated.assign(NumEvents, false);
+
+  std::unique_lock<std::mutex> lock(event_lock);
+
+  // Consume signaled events and queue on the others.
+  for (HSAuint32 i = 0; i < NumEvents; i++) {
+    SimEvent* evt = reinterpret_cast<SimEvent*>(Events[i]);
+    if (evt->signaled) {
+      waiter.activated[i] = true;
+      evt->signaled = evt->manual_reset;
+    } else {
+      evt->waiters.push_back(std::make_pair(&waiter, i));
+    }
+  }
+
+  HSAKMT_STATUS status = HSAKMT_STATUS_SUCCESS;
+  while (!Satisfied(waiter, WaitOnAll)) {
+    timespec timeout;
+    timespec* timeout_ptr = nullptr;
+    if (Milliseconds != HSA_EVENTTIMEOUT_INFINITE) {
+      const uint64_t now = ClockNs();
+      if (now >= deadline) {
+        status = HSAKMT_STATUS_WAIT_TIMEOUT;
+        break;
+      }
+      timeout.tv_sec = (deadline - now) / 1000000000ull;
+      timeout.tv_nsec = (deadline - now) % 1000000000ull;
+      timeout_ptr = &timeout;
+    }
+
+    // Set stores the word under event_lock, so a set after the unlock makes the wait return.
+    waiter.wake.store(0, std::memory_order_relaxed);
+    lock.unlock();
+    const long ret =
+        syscall(SYS_futex, &waiter.wake, FUTEX_WAIT_PRIVATE, 0, timeout_ptr, nullptr, 0);
+    const int err = errno;
+    lock.lock();
+    if ((ret != 0) && (err != EAGAIN) && (err != EINTR) && (err != ETIMEDOUT)) {
+      status = HSAKMT_STATUS_WAIT_FAILURE;
+      break;
+    }
+  }
+
+  for (HSAuint32 i = 0; i < NumEvents; i++) {
+    auto& waiters = reinterpret_cast<SimEvent*>(Events[i])->waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), std::make_pair(&waiter, i)),
+                  waiters.end());
+  }
+  return status;
+}
+
+HSAKMT_STATUS hsaKmtWaitOnEvent(HsaEvent* Event, HSAuint32 Milliseconds) {
+  return hsaKmtWaitOnMultipleEvents(&Event, 1, true, Milliseconds);
+}
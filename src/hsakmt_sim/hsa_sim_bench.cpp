@@ -0,0 +1,325 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Micro-benchmarks of runtime overhead over the public HSA API.  Built with
+// the simulated thunk so that they run without a GPU, the numbers then exclude
+// all device time.  They also run unchanged on hardware.
+//
+// Usage: hsa_sim_bench [iterations] [name filter]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hsa.h"
+#include "hsa_ext_amd.h"
+
+namespace {
+
+#define CHECK(call)                                                       \
+  do {                                                                    \
+    hsa_status_t status_ = (call);                                        \
+    if (status_ != HSA_STATUS_SUCCESS) {                                  \
+      const char* msg_ = "unknown error";                                 \
+      hsa_status_string(status_, &msg_);                                  \
+      fprintf(stderr, "%s:%d: %s failed: %s\n", __FILE__, __LINE__, #call, msg_); \
+      exit(1);                                                            \
+    }                                                                     \
+  } while (false)
+
+// Repetitions of each benchmark, the median is reported.
+const int kRepetitions = 5;
+
+struct Context {
+  hsa_agent_t cpu;
+  hsa_agent_t gpu;
+  bool has_gpu;
+  hsa_amd_memory_pool_t cpu_pool;
+  hsa_amd_memory_pool_t gpu_pool;
+  bool has_gpu_pool;
+  hsa_queue_t* queue;
+};
+
+hsa_status_t FindAgents(hsa_agent_t agent, void* data) {
+  Context* ctx = reinterpret_cast<Context*>(data);
+  hsa_device_type_t type;
+  CHECK(hsa_agent_get_info(agent, HSA_AGENT_INFO_DEVICE, &type));
+  if ((type == HSA_DEVICE_TYPE_CPU) && (ctx->cpu.handle == 0)) ctx->cpu = agent;
+  if ((type == HSA_DEVICE_TYPE_GPU) && !ctx->has_gpu) {
+    ctx->gpu = agent;
+    ctx->has_gpu = true;
+  }
+  return HSA_STATUS_SUCCESS;
+}
+
+// Selects the first global pool of an agent which allows runtime allocation.
+hsa_status_t FindPool(hsa_amd_memory_pool_t pool, void* data) {
+  hsa_amd_segment_t segment;
+  bool alloc_allowed;
+  CHECK(hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_SEGMENT, &segment));
+  CHECK(hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_RUNTIME_ALLOC_ALLOWED,
+                                     &alloc_allowed));
+  if ((segment != HSA_AMD_SEGMENT_GLOBAL) || !alloc_allowed) return HSA_STATUS_SUCCESS;
+  *reinterpret_cast<hsa_amd_memory_pool_t*>(data) = pool;
+  return HSA_STATUS_INFO_BREAK;
+}
+
+// Returns the selected pool of an agent, or a null handle if it has none.
+hsa_amd_memory_pool_t GlobalPool(hsa_agent_t agent) {
+  hsa_amd_memory_pool_t pool = {0};
+  hsa_status_t status = hsa_amd_agent_iterate_memory_pools(agent, FindPool, &pool);
+  if (status != HSA_STATUS_INFO_BREAK) CHECK(status);
+  return pool;
+}
+
+void SignalCreateDestroy(Context& ctx, uint64_t iterations) {
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_signal_t signal;
+    CHECK(hsa_signal_create(1, 0, nullptr, &signal));
+    CHECK(hsa_signal_destroy(signal));
+  }
+}
+
+void SignalStoreLoad(Context& ctx, uint64_t iterations) {
+  hsa_signal_t signal;
+  CHECK(hsa_signal_create(0, 0, nullptr, &signal));
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_signal_store_screlease(signal, hsa_signal_value_t(i));
+    if (hsa_signal_load_scacquire(signal) != hsa_signal_value_t(i)) abort();
+  }
+  CHECK(hsa_signal_destroy(signal));
+}
+
+void SignalWaitSatisfied(Context& ctx, uint64_t iterations) {
+  hsa_signal_t signal;
+  CHECK(hsa_signal_create(0, 0, nullptr, &signal));
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX,
+                              HSA_WAIT_STATE_BLOCKED);
+  }
+  CHECK(hsa_signal_destroy(signal));
+}
+
+void AllocateFree(hsa_amd_memory_pool_t pool, size_t size, uint64_t iterations) {
+  for (uint64_t i = 0; i < iterations; i++) {
+    void* ptr;
+    CHECK(hsa_amd_memory_pool_allocate(pool, size, 0, &ptr));
+    CHECK(hsa_amd_memory_pool_free(ptr));
+  }
+}
+
+void SystemAllocateFree(Context& ctx, uint64_t iterations) {
+  AllocateFree(ctx.cpu_pool, 4096, iterations);
+}
+
+void DeviceAllocateFree(Context& ctx, uint64_t iterations) {
+  AllocateFree(ctx.gpu_pool, 65536, iterations);
+}
+
+void PointerInfo(Context& ctx, uint64_t iterations) {
+  void* ptr;
+  CHECK(hsa_amd_memory_pool_allocate(ctx.cpu_pool, 1 << 20, 0, &ptr));
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_amd_pointer_info_t info;
+    info.size = sizeof(info);
+    CHECK(hsa_amd_pointer_info(reinterpret_cast<char*>(ptr) + (i & 0xfff), &info, nullptr,
+                               nullptr, nullptr));
+  }
+  CHECK(hsa_amd_memory_pool_free(ptr));
+}
+
+// Loader bookkeeping without a code object, no device code is available.
+void ExecutableCreateDestroy(Context& ctx, uint64_t iterations) {
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_executable_t executable;
+    CHECK(hsa_executable_create_alt(HSA_PROFILE_FULL, HSA_DEFAULT_FLOAT_ROUNDING_MODE_DEFAULT,
+                                    nullptr, &executable));
+    CHECK(hsa_executable_freeze(executable, nullptr));
+    CHECK(hsa_executable_destroy(executable));
+  }
+}
+
+// Publishes a barrier-AND packet with no dependencies and rings the doorbell.
+void SubmitBarrier(hsa_queue_t* queue, hsa_signal_t completion) {
+  const uint64_t index = hsa_queue_add_write_index_screlease(queue, 1);
+  while (index - hsa_queue_load_read_index_scacquire(queue) >= queue->size) {
+  }
+
+  hsa_barrier_and_packet_t* packet =
+      reinterpret_cast<hsa_barrier_and_packet_t*>(queue->base_address) +
+      (index & (queue->size - 1));
+  memset(reinterpret_cast<uint8_t*>(packet) + sizeof(packet->header), 0,
+         sizeof(*packet) - sizeof(packet->header));
+  packet->completion_signal = completion;
+
+  const uint16_t header = (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) |
+      (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE) |
+      (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE);
+  __atomic_store_n(&packet->header, header, __ATOMIC_RELEASE);
+  hsa_signal_store_screlease(queue->doorbell_signal, index);
+}
+
+void BarrierRoundTrip(Context& ctx, uint64_t iterations) {
+  hsa_signal_t signal;
+  CHECK(hsa_signal_create(1, 0, nullptr, &signal));
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_signal_store_relaxed(signal, 1);
+    SubmitBarrier(ctx.queue, signal);
+    hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX,
+                              HSA_WAIT_STATE_BLOCKED);
+  }
+  CHECK(hsa_signal_destroy(signal));
+}
+
+// Copies into device memory.  The simulator retires the blit kernel dispatches
+// without moving data, so this measures submission and completion overhead.
+void AsyncCopy(Context& ctx, uint64_t iterations) {
+  void *src, *dst;
+  CHECK(hsa_amd_memory_pool_allocate(ctx.cpu_pool, 4096, 0, &src));
+  CHECK(hsa_amd_memory_pool_allocate(ctx.gpu_pool, 4096, 0, &dst));
+  CHECK(hsa_amd_agents_allow_access(1, &ctx.gpu, nullptr, src));
+
+  hsa_signal_t signal;
+  CHECK(hsa_signal_create(1, 0, nullptr, &signal));
+  for (uint64_t i = 0; i < iterations; i++) {
+    hsa_signal_store_relaxed(signal, 1);
+    CHECK(hsa_amd_memory_async_copy(dst, ctx.gpu, src, ctx.cpu, 4096, 0, nullptr, signal));
+    hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX,
+                              HSA_WAIT_STATE_BLOCKED);
+  }
+  CHECK(hsa_signal_destroy(signal));
+  CHECK(hsa_amd_memory_pool_free(dst));
+  CHECK(hsa_amd_memory_pool_free(src));
+}
+
+struct Benchmark {
+  const char* name;
+  void (*run)(Context& ctx, uint64_t iterations);
+  // Benchmarks which need a GPU agent, and for some a device pool.
+  bool needs_gpu;
+  bool needs_gpu_pool;
+};
+
+const Benchmark kBenchmarks[] = {
+    {"signal_create_destroy", SignalCreateDestroy, false, false},
+    {"signal_store_load", SignalStoreLoad, false, false},
+    {"signal_wait_satisfied", SignalWaitSatisfied, false, false},
+    {"system_allocate_free_4k", SystemAllocateFree, false, false},
+    {"device_allocate_free_64k", DeviceAllocateFree, true, true},
+    {"pointer_info", PointerInfo, false, false},
+    {"executable_create_destroy", ExecutableCreateDestroy, false, false},
+    {"queue_barrier_round_trip", BarrierRoundTrip, true, false},
+    {"async_copy_h2d_4k", AsyncCopy, true, true},
+};
+
+double NsPerOp(const Benchmark& bench, Context& ctx, uint64_t iterations) {
+  std::vector<double> samples;
+  bench.run(ctx, std::max<uint64_t>(iterations / 10, 1));
+  for (int rep = 0; rep < kRepetitions; rep++) {
+    auto start = std::chrono::steady_clock::now();
+    bench.run(ctx, iterations);
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() /
+                      double(iterations));
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 10000;
+  const char* filter = (argc > 2) ? argv[2] : "";
+  if (iterations == 0) {
+    fprintf(stderr, "usage: %s [iterations] [name filter]\n", argv[0]);
+    return 1;
+  }
+
+  CHECK(hsa_init());
+
+  Context ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  CHECK(hsa_iterate_agents(FindAgents, &ctx));
+  ctx.cpu_pool = GlobalPool(ctx.cpu);
+  if (ctx.cpu_pool.handle == 0) {
+    fprintf(stderr, "no system memory pool\n");
+    return 1;
+  }
+  if (ctx.has_gpu) {
+    ctx.gpu_pool = GlobalPool(ctx.gpu);
+    ctx.has_gpu_pool = (ctx.gpu_pool.handle != 0);
+    CHECK(hsa_queue_create(ctx.gpu, 1024, HSA_QUEUE_TYPE_MULTI, nullptr, nullptr, UINT32_MAX,
+                           UINT32_MAX, &ctx.queue));
+  }
+
+  if (ctx.queue != nullptr) {
+    // Queues only collect latency histograms when wrapped in an intercept
+    // queue, which HSA_QUEUE_LATENCY_STATS=1 applies to every user queue.
+    uint64_t bucket;
+    const bool intercepted = hsa_amd_queue_latency_get_histogram(
+        ctx.queue, HSA_AMD_QUEUE_LATENCY_START_TO_END, 1, &bucket) == HSA_STATUS_SUCCESS;
+    printf("queue: %s\n", intercepted ? "intercepted" : "direct");
+  }
+
+  printf("%-28s %12s %12s\n", "benchmark", "iterations", "ns/op");
+  for (const Benchmark& bench : kBenchmarks) {
+    if (strstr(bench.name, filter) == nullptr) continue;
+    if ((bench.needs_gpu && !ctx.has_gpu) || (bench.needs_gpu_pool && !ctx.has_gpu_pool)) {
+      printf("%-28s %12s %12s\n", bench.name, "-", "skipped");
+      continue;
+    }
+    printf("%-28s %12llu %12.1f\n", bench.name, (unsigned long long)iterations,
+           NsPerOp(bench, ctx, iterations));
+    fflush(stdout);
+  }
+
+  if (ctx.queue != nullptr) CHECK(hsa_queue_destroy(ctx.queue));
+  CHECK(hsa_shut_down());
+  return 0;
+}
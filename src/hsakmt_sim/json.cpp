@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "hsakmt_sim/json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace rocr {
+namespace sim {
+
+const JsonValue* JsonValue::Find(const std::string& key) const {
+  if (type != kObject) return nullptr;
+  for (const auto& member : object) {
+    if (member.first == key) return &member.second;
+  }
+  return nullptr;
+}
+
+uint64_t JsonValue::GetUint(const std::string& key, uint64_t def) const {
+  const JsonValue* value = Find(key);
+  if ((value == nullptr) || (value->type != kNumber)) return def;
+  return value->integer;
+}
+
+std::string JsonValue::GetString(const std::string& key, const std::string& def) const {
+  const JsonValue* value = Find(key);
+  if ((value == nullptr) || (value->type != kString)) return def;
+  return value->string;
+}
+
+namespace {
+
+class Parser {
+ public:
+  explicit Parser(const std::string& text) : text_(text), pos_(0) {}
+
+  bool Parse(JsonValue& value, std::string& error) {
+    if (!ParseValue(value, 0)) {
+      error = error_ + " at offset " + std::to_string(pos_);
+      return false;
+    }
+    SkipSpace();
+    if (pos_ != text_.size()) {
+      error = "trailing characters at offset " + std::to_string(pos_);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  // Nesting limit, keeps malformed input from exhausting the stack.
+  static const int kMaxDepth = 64;
+
+  void SkipSpace() {
+    while ((pos_ < text_.size()) &&
+           ((text_[pos_] == ' ') || (text_[pos_] == '\t') || (text_[pos_] == '\n') ||
+            (text_[pos_] == '\r')))
+      pos_++;
+  }
+
+  bool Fail(const char* what) {
+    error_ = what;
+    return false;
+  }
+
+  bool Expect(char c) {
+    SkipSpace();
+    if ((pos_ >= text_.size()) || (text_[pos_] != c)) return false;
+    pos_++;
+    return true;
+  }
+
+  bool Literal(const char* word) {
+    size_t len = strlen(word);
+    if (text_.compare(pos_, len, word) != 0) return Fail("invalid literal");
+    pos_ += len;
+    return true;
+  }
+
+  bool ParseValue(JsonValue& value, int depth) {
+    if (depth > kMaxDepth) return Fail("nesting too deep");
+    SkipSpace();
+    if (pos_ >= text_.size()) return Fail("unexpected end of input");
+
+    switch (text_[pos_]) {
+      case '{':
+        return ParseObject(value, depth);
+      case '[':
+        return ParseArray(value, depth);
+      case '"':
+        value.type = JsonValue::kString;
+        return ParseString(value.string);
+      case 't':
+        value.type = JsonValue::kBool;
+        value.boolean = true;
+        return Literal("true");
+      case 'f':
+        value.type = JsonValue::kBool;
+        value.boolean = false;
+        return Literal("false");
+      case 'n':
+        value.type = JsonValue::kNull;
+        return Literal("null");
+      default:
+        return ParseNumber(value);
+    }
+  }
+
+  bool ParseObject(JsonValue& value, int depth) {
+    value.type = JsonValue::kObject;
+    pos_++;
+    if (Expect('}')) return true;
+    do {
+      SkipSpace();
+      std::pair<std::string, JsonValue> member;
+      if ((pos_ >= text_.size()) || (text_[pos_] != '"')) return Fail("expected member name");
+      if (!ParseString(member.first)) return false;
+      if (!Expect(':')) return Fail("expected ':'");
+      if (!ParseValue(member.second, depth + 1)) return false;
+      value.object.push_back(std::move(member));
+    } while (Expect(','));
+    if (!Expect('}')) return Fail("expected ',' or '}'");
+    return true;
+  }
+
+  bool ParseArray(JsonValue& value, int depth) {
+    value.type = JsonValue::kArray;
+    pos_++;
+    if (Expect(']')) return true;
+    do {
+      value.array.emplace_back();
+      if (!ParseValue(value.array.back(), depth + 1)) return false;
+    } while (Expect(','));
+    if (!Expect(']')) return Fail("expected ',' or ']'");
+    return true;
+  }
+
+  // Escapes are decoded except \u, which is only accepted for ASCII code points.
+  bool ParseString(std::string& out) {
+    pos_++;
+    while (pos_ < text_.size()) {
+      char c = text_[pos_++];
+      if (c == '"') return true;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos_ >= text_.size()) break;
+      c = text_[pos_++];
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          out += c;
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          if (pos_ + 4 > text_.size()) return Fail("truncated escape");
+          char* end;
+          std::string hex = text_.substr(pos_, 4);
+          unsigned long code = strtoul(hex.c_str(), &end, 16);
+          if ((*end != '\0') || (code > 0x7f)) return Fail("unsupported escape");
+          out += char(code);
+          pos_ += 4;
+          break;
+        }
+        default:
+          return Fail("invalid escape");
+      }
+    }
+    return Fail("unterminated string");
+  }
+
+  bool ParseNumber(JsonValue& value) {
+    const char* start = text_.c_str() + pos_;
+    char* end;
+    value.type = JsonValue::kNumber;
+    value.number = strtod(start, &end);
+    if (end == start) return Fail("unexpected character");
+
+    std::string token(start, end - start);
+    if ((token[0] != '-') && (token.find_first_of(".eE") == std::string::npos)) {
+      value.integer = strtoull(token.c_str(), nullptr, 10);
+    } else {
+      value.integer = (value.number > 0.0) ? uint64_t(value.number) : 0;
+    }
+    pos_ += end - start;
+    return true;
+  }
+
+  const std::string& text_;
+  size_t pos_;
+  std::string error_;
+};
+
+}  // namespace
+
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error) {
+  value = JsonValue();
+  return Parser(text).Parse(value, error);
+}
+
+}  // namespace sim
+}  // namespace rocr
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HSA_RUNTIME_HSAKMT_SIM_JSON_H_
+#define HSA_RUNTIME_HSAKMT_SIM_JSON_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rocr {
+namespace sim {
+
+/// @brief Minimal JSON document model, sufficient for topology descriptions.
+/// Numbers keep their unsigned integer value when they have no fraction or
+/// exponent so that byte sizes above 2^53 survive.
+class JsonValue {
+ public:
+  enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  JsonValue() : type(kNull), boolean(false), number(0.0), integer(0) {}
+
+  /// @brief Returns the member named @p key, or nullptr if this is not an
+  /// object or has no such member.
+  const JsonValue* Find(const std::string& key) const;
+
+  /// @brief Member accessors which fall back to @p def when the member is
+  /// missing or has the wrong type.
+  uint64_t GetUint(const std::string& key, uint64_t def) const;
+  std::string GetString(const std::string& key, const std::string& def) const;
+
+  Type type;
+  bool boolean;
+  double number;
+  uint64_t integer;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+};
+
+/// @brief Parses @p text into @p value.  On failure returns false and
+/// describes the first error, with its byte offset, in @p error.
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error);
+
+}  // namespace sim
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_HSAKMT_SIM_JSON_H_
@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Driver connection, topology queries and device controls of the simulated
+// thunk.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "hsakmt_sim/sim.h"
+
+namespace rocr {
+namespace sim {
+
+namespace {
+
+// Reported interface version.  1.0 would disable interrupt signals in the
+// runtime and versions before 1.4 trigger sramecc workarounds.
+const HSAuint32 kVersionMajor = 1;
+const HSAuint32 kVersionMinor = 6;
+
+std::mutex kfd_lock;
+int open_count = 0;
+std::vector<Node> nodes;
+HSAint32 xnack_mode = 0;
+
+bool ValidNode(HSAuint32 node_id) { return node_id < nodes.size(); }
+
+}  // namespace
+
+const std::vector<Node>& Nodes() { return nodes; }
+
+uint64_t ClockNs() {
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+  return uint64_t(time.tv_sec) * 1000000000ull + uint64_t(time.tv_nsec);
+}
+
+}  // namespace sim
+}  // namespace rocr
+
+using namespace rocr::sim;
+
+HSAKMT_STATUS hsaKmtOpenKFD(void) {
+  std::lock_guard<std::mutex> lock(kfd_lock);
+  if (open_count == 0) {
+    std::string error;
+    if (!LoadTopology(nodes, error)) {
+      fprintf(stderr, "hsakmt_sim: %s\n", error.c_str());
+      nodes.clear();
+      return HSAKMT_STATUS_ERROR;
+    }
+  }
+  open_count++;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtCloseKFD(void) {
+  std::lock_guard<std::mutex> lock(kfd_lock);
+  if (open_count == 0) return HSAKMT_STATUS_ERROR;
+  if (--open_count == 0) {
+    ShutdownQueues();
+    ShutdownEvents();
+    ShutdownMemory();
+    nodes.clear();
+  }
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtGetVersion(HsaVersionInfo* VersionInfo) {
+  if (VersionInfo == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  VersionInfo->KernelInterfaceMajorVersion = kVersionMajor;
+  VersionInfo->KernelInterfaceMinorVersion = kVersionMinor;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtAcquireSystemProperties(HsaSystemProperties* SystemProperties) {
+  if (SystemProperties == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (nodes.empty()) return HSAKMT_STATUS_ERROR;
+  memset(SystemProperties, 0, sizeof(*SystemProperties));
+  SystemProperties->NumNodes = nodes.size();
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// The topology is immutable while the KFD is open, so there is no snapshot to drop.
+HSAKMT_STATUS hsaKmtReleaseSystemProperties(void) { return HSAKMT_STATUS_SUCCESS; }
+
+HSAKMT_STATUS hsaKmtGetNodeProperties(HSAuint32 NodeId, HsaNodeProperties* NodeProperties) {
+  if (NodeProperties == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (!ValidNode(NodeId)) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  *NodeProperties = nodes[NodeId].props;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtGetNodeMemoryProperties(HSAuint32 NodeId, HSAuint32 NumBanks,
+                                            HsaMemoryProperties* MemoryProperties) {
+  if (MemoryProperties == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (!ValidNode(NodeId)) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  const std::vector<HsaMemoryProperties>& memory = nodes[NodeId].memory;
+  std::copy_n(memory.begin(), std::min<size_t>(NumBanks, memory.size()), MemoryProperties);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// Caches are not modeled, every node reports NumCaches == 0.
+HSAKMT_STATUS hsaKmtGetNodeCacheProperties(HSAuint32 NodeId, HSAuint32 ProcessorId,
+                                           HSAuint32 NumCaches,
+                                           HsaCacheProperties* CacheProperties) {
+  if (!ValidNode(NodeId)) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  return (NumCaches == 0) ? HSAKMT_STATUS_SUCCESS : HSAKMT_STATUS_INVALID_PARAMETER;
+}
+
+HSAKMT_STATUS hsaKmtGetNodeIoLinkProperties(HSAuint32 NodeId, HSAuint32 NumIoLinks,
+                                            HsaIoLinkProperties* IoLinkProperties) {
+  if (IoLinkProperties == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (!ValidNode(NodeId)) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  const std::vector<HsaIoLinkProperties>& links = nodes[NodeId].links;
+  std::copy_n(links.begin(), std::min<size_t>(NumIoLinks, links.size()), IoLinkProperties);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// All clocks run at 1GHz from CLOCK_MONOTONIC_RAW, so GPU and system ticks
+// translate 1:1.
+HSAKMT_STATUS hsaKmtGetClockCounters(HSAuint32 NodeId, HsaClockCounters* Counters) {
+  if (Counters == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  const uint64_t now = ClockNs();
+  Counters->GPUClockCounter = now;
+  Counters->CPUClockCounter = now;
+  Counters->SystemClockCounter = now;
+  Counters->SystemClockFrequencyHz = 1000000000ull;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// No code runs on the simulated device, device side settings are accepted and
+// ignored.
+HSAKMT_STATUS hsaKmtSetTrapHandler(HSAuint32 NodeId, void* TrapHandlerBaseAddress,
+                                   HSAuint64 TrapHandlerSizeInBytes, void* TrapBufferBaseAddress,
+                                   HSAuint64 TrapBufferSizeInBytes) {
+  return ValidNode(NodeId) ? HSAKMT_STATUS_SUCCESS : HSAKMT_STATUS_INVALID_NODE_UNIT;
+}
+
+HSAKMT_STATUS hsaKmtSetMemoryPolicy(HSAuint32 Node, HSAuint32 DefaultPolicy,
+                                    HSAuint32 AlternatePolicy, void* MemoryAddressAlternate,
+                                    HSAuint64 MemorySizeInBytes) {
+  return ValidNode(Node) ? HSAKMT_STATUS_SUCCESS : HSAKMT_STATUS_INVALID_NODE_UNIT;
+}
+
+HSAKMT_STATUS hsaKmtGetTileConfig(HSAuint32 NodeId, HsaGpuTileConfig* config) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtSetXNACKMode(HSAint32 enable) {
+  xnack_mode = enable;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtGetXNACKMode(HSAint32* enable) {
+  if (enable == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  *enable = xnack_mode;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// Debugger support is reported as absent, the runtime then uses the
+// pre-exception-debugging queue setup.
+HSAKMT_STATUS hsaKmtRuntimeEnable(void* rDebug, bool setupTtmp) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtRuntimeDisable(void) { return HSAKMT_STATUS_SUCCESS; }
+
+// The simulated nodes do not advertise SVMAPISupported.
+HSAKMT_STATUS hsaKmtSVMSetAttr(void* start_addr, HSAuint64 size, unsigned int nattr,
+                               HSA_SVM_ATTRIBUTE* attrs) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtSVMGetAttr(void* start_addr, HSAuint64 size, unsigned int nattr,
+                               HSA_SVM_ATTRIBUTE* attrs) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
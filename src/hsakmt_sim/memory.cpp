@@ -0,0 +1,275 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Memory management of the simulated thunk.  Every heap, VRAM included, is
+// backed by anonymous host mappings, so device and host addresses are equal.
+// Allocations and registrations share one address ordered map which answers
+// pointer queries.
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <map>
+#include <mutex>
+
+#include "hsakmt_sim/sim.h"
+
+namespace rocr {
+namespace sim {
+
+namespace {
+
+const uint64_t kPageSize = 4096;
+
+struct Range {
+  uint64_t size;
+  HSAuint32 node;
+  HsaMemFlags flags;
+  HSA_POINTER_TYPE type;
+  // Registration count, user memory may be registered more than once.
+  uint32_t refs;
+  void* user_data;
+  std::vector<HSAuint32> mapped;
+};
+
+std::mutex memory_lock;
+std::map<uintptr_t, Range> ranges;
+
+// Returns the range containing @p ptr, or ranges.end().
+std::map<uintptr_t, Range>::iterator Find(const void* ptr) {
+  uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+  auto it = ranges.upper_bound(addr);
+  if (it == ranges.begin()) return ranges.end();
+  --it;
+  return (addr < it->first + it->second.size) ? it : ranges.end();
+}
+
+void MapToGpus(Range& range) {
+  range.mapped.clear();
+  const std::vector<Node>& nodes = Nodes();
+  for (HSAuint32 id = 0; id < nodes.size(); id++) {
+    if (nodes[id].IsGpu()) range.mapped.push_back(id);
+  }
+}
+
+}  // namespace
+
+bool IsTracked(const void* ptr) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  return Find(ptr) != ranges.end();
+}
+
+void ShutdownMemory() {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  for (auto& range : ranges) {
+    if (range.second.type == HSA_POINTER_ALLOCATED)
+      munmap(reinterpret_cast<void*>(range.first), range.second.size);
+  }
+  ranges.clear();
+}
+
+}  // namespace sim
+}  // namespace rocr
+
+using namespace rocr::sim;
+
+HSAKMT_STATUS hsaKmtAllocMemory(HSAuint32 PreferredNode, HSAuint64 SizeInBytes,
+                                HsaMemFlags MemFlags, void** MemoryAddress) {
+  if ((MemoryAddress == nullptr) || (SizeInBytes == 0)) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (PreferredNode >= Nodes().size()) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+
+  // Scratch and VRAM reservations can be large, only touched pages are backed.
+  const uint64_t size = (SizeInBytes + kPageSize - 1) & ~(kPageSize - 1);
+  int prot = PROT_READ | PROT_WRITE;
+  if (MemFlags.ui32.ExecuteAccess) prot |= PROT_EXEC;
+  void* ptr = mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ptr == MAP_FAILED) return HSAKMT_STATUS_NO_MEMORY;
+
+  Range range;
+  range.size = size;
+  range.node = PreferredNode;
+  range.flags = MemFlags;
+  range.type = HSA_POINTER_ALLOCATED;
+  range.refs = 1;
+  range.user_data = nullptr;
+
+  std::lock_guard<std::mutex> lock(memory_lock);
+  ranges[reinterpret_cast<uintptr_t>(ptr)] = range;
+  *MemoryAddress = ptr;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtFreeMemory(void* MemoryAddress, HSAuint64 SizeInBytes) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = ranges.find(reinterpret_cast<uintptr_t>(MemoryAddress));
+  if ((it == ranges.end()) || (it->second.type != HSA_POINTER_ALLOCATED))
+    return HSAKMT_STATUS_INVALID_PARAMETER;
+  munmap(MemoryAddress, it->second.size);
+  ranges.erase(it);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtRegisterMemoryWithFlags(void* MemoryAddress, HSAuint64 MemorySizeInBytes,
+                                            HsaMemFlags MemFlags) {
+  if ((MemoryAddress == nullptr) || (MemorySizeInBytes == 0))
+    return HSAKMT_STATUS_INVALID_PARAMETER;
+
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = ranges.find(reinterpret_cast<uintptr_t>(MemoryAddress));
+  if (it != ranges.end()) {
+    // Registering thunk allocations is a no-op, as in libhsakmt.
+    if (it->second.type != HSA_POINTER_ALLOCATED) it->second.refs++;
+    return HSAKMT_STATUS_SUCCESS;
+  }
+
+  Range range;
+  range.size = MemorySizeInBytes;
+  range.node = 0;
+  range.flags = MemFlags;
+  range.type = HSA_POINTER_REGISTERED_USER;
+  range.refs = 1;
+  range.user_data = nullptr;
+  ranges[reinterpret_cast<uintptr_t>(MemoryAddress)] = range;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtDeregisterMemory(void* MemoryAddress) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = ranges.find(reinterpret_cast<uintptr_t>(MemoryAddress));
+  if (it == ranges.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if (it->second.type == HSA_POINTER_ALLOCATED) return HSAKMT_STATUS_SUCCESS;
+  if (--it->second.refs == 0) ranges.erase(it);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtMapMemoryToGPU(void* MemoryAddress, HSAuint64 MemorySizeInBytes,
+                                   HSAuint64* AlternateVAGPU) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = Find(MemoryAddress);
+  if (it == ranges.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  MapToGpus(it->second);
+  if (AlternateVAGPU != nullptr) *AlternateVAGPU = reinterpret_cast<uintptr_t>(MemoryAddress);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtMapMemoryToGPUNodes(void* MemoryAddress, HSAuint64 MemorySizeInBytes,
+                                        HSAuint64* AlternateVAGPU, HsaMemMapFlags MemMapFlags,
+                                        HSAuint64 NumberOfNodes, HSAuint32* NodeArray) {
+  if ((NumberOfNodes != 0) && (NodeArray == nullptr)) return HSAKMT_STATUS_INVALID_PARAMETER;
+  for (HSAuint64 i = 0; i < NumberOfNodes; i++) {
+    if (NodeArray[i] >= Nodes().size()) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  }
+
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = Find(MemoryAddress);
+  if (it == ranges.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  it->second.mapped.assign(NodeArray, NodeArray + NumberOfNodes);
+  if (AlternateVAGPU != nullptr) *AlternateVAGPU = reinterpret_cast<uintptr_t>(MemoryAddress);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtUnmapMemoryToGPU(void* MemoryAddress) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = Find(MemoryAddress);
+  if (it == ranges.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  it->second.mapped.clear();
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtQueryPointerInfo(const void* Pointer, HsaPointerInfo* PointerInfo) {
+  if (PointerInfo == nullptr) return HSAKMT_STATUS_INVALID_PARAMETER;
+  memset(PointerInfo, 0, sizeof(*PointerInfo));
+
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = Find(Pointer);
+  if (it == ranges.end()) {
+    PointerInfo->Type = HSA_POINTER_UNKNOWN;
+    return HSAKMT_STATUS_ERROR;
+  }
+
+  const Range& range = it->second;
+  PointerInfo->Type = range.type;
+  PointerInfo->Node = range.node;
+  PointerInfo->MemFlags = range.flags;
+  PointerInfo->CPUAddress = reinterpret_cast<void*>(it->first);
+  PointerInfo->GPUAddress = it->first;
+  PointerInfo->SizeInBytes = range.size;
+  PointerInfo->NRegisteredNodes = range.mapped.size();
+  PointerInfo->NMappedNodes = range.mapped.size();
+  PointerInfo->RegisteredNodes = range.mapped.data();
+  PointerInfo->MappedNodes = range.mapped.data();
+  PointerInfo->UserData = range.user_data;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtSetMemoryUserData(const void* Pointer, void* UserData) {
+  std::lock_guard<std::mutex> lock(memory_lock);
+  auto it = Find(Pointer);
+  if (it == ranges.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  it->second.user_data = UserData;
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// Sharing needs a second process, and graphics interop a graphics driver, neither
+// of which the simulator models.
+HSAKMT_STATUS hsaKmtShareMemory(void* MemoryAddress, HSAuint64 SizeInBytes,
+                                HsaSharedMemoryHandle* SharedMemoryHandle) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtRegisterSharedHandle(const HsaSharedMemoryHandle* SharedMemoryHandle,
+                                         void** MemoryAddress, HSAuint64* SizeInBytes) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtRegisterSharedHandleToNodes(const HsaSharedMemoryHandle* SharedMemoryHandle,
+                                                void** MemoryAddress, HSAuint64* SizeInBytes,
+                                                HSAuint64 NumberOfNodes, HSAuint32* NodeArray) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
+
+HSAKMT_STATUS hsaKmtRegisterGraphicsHandleToNodes(HSAuint64 GraphicsResourceHandle,
+                                                  HsaGraphicsResourceInfo* GraphicsResourceInfo,
+                                                  HSAuint64 NumberOfNodes,
+                                                  HSAuint32* NodeArray) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Queue emulation for the simulated thunk.  Each AQL queue gets a packet
+// processor thread which consumes packets in order between the read and write
+// pointers given at queue creation.  Barrier packets wait for their
+// dependencies, kernel dispatch and vendor packets are retired without
+// executing anything.  Completion follows the command processor: decrement
+// the completion signal, stamp its timestamps and raise its mailbox event.
+
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "hsakmt_sim/sim.h"
+#include "inc/amd_hsa_signal.h"
+#include "inc/hsa.h"
+
+namespace rocr {
+namespace sim {
+
+namespace {
+
+class PacketProcessor {
+ public:
+  PacketProcessor(void* ring, uint64_t ring_bytes, volatile uint64_t* read_ptr,
+                  volatile uint64_t* write_ptr)
+      : ring_(reinterpret_cast<hsa_barrier_and_packet_t*>(ring)),
+        mask_(ring_bytes / sizeof(hsa_barrier_and_packet_t) - 1),
+        read_ptr_(read_ptr),
+        write_ptr_(write_ptr),
+        doorbell_(0),
+        active_(true),
+        stop_(false) {
+    thread_ = std::thread([this]() { Run(); });
+  }
+
+  ~PacketProcessor() {
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+  }
+
+  volatile uint64_t* doorbell() { return &doorbell_; }
+
+  void active(bool active) { active_.store(active, std::memory_order_release); }
+
+ private:
+  // Polling intervals.  Doorbell writes are plain stores, so an idle
+  // processor yields for a while and then falls back to short sleeps.
+  static const uint32_t kSpinIterations = 1000;
+  static const long kSleepNs = 20000;
+
+  void Run() {
+    uint32_t idle = 0;
+    while (!stop_.load(std::memory_order_acquire)) {
+      if (active_.load(std::memory_order_acquire) && ProcessPacket()) {
+        idle = 0;
+        continue;
+      }
+      if (idle < kSpinIterations) {
+        idle++;
+        sched_yield();
+      } else {
+        timespec delay = {0, kSleepNs};
+        nanosleep(&delay, nullptr);
+      }
+    }
+  }
+
+  static bool SignalIsZero(hsa_signal_t signal) {
+    const amd_signal_t* sig = reinterpret_cast<const amd_signal_t*>(signal.handle);
+    return __atomic_load_n(&sig->value, __ATOMIC_ACQUIRE) == 0;
+  }
+
+  static bool BarrierAnd(const hsa_barrier_and_packet_t* pkt) {
+    for (const hsa_signal_t& dep : pkt->dep_signal) {
+      if ((dep.handle != 0) && !SignalIsZero(dep)) return false;
+    }
+    return true;
+  }
+
+  static bool BarrierOr(const hsa_barrier_or_packet_t* pkt) {
+    bool any = false;
+    for (const hsa_signal_t& dep : pkt->dep_signal) {
+      if (dep.handle == 0) continue;
+      if (SignalIsZero(dep)) return true;
+      any = true;
+    }
+    return !any;
+  }
+
+  static void Complete(hsa_signal_t signal) {
+    if (signal.handle == 0) return;
+    amd_signal_t* sig = reinterpret_cast<amd_signal_t*>(signal.handle);
+    const uint64_t now = ClockNs();
+    sig->start_ts = now;
+    sig->end_ts = now;
+    __atomic_fetch_sub(&sig->value, 1, __ATOMIC_RELEASE);
+    if (sig->event_mailbox_ptr != 0) {
+      __atomic_store_n(reinterpret_cast<uint64_t*>(sig->event_mailbox_ptr), sig->event_id,
+                       __ATOMIC_RELEASE);
+      SignalEventId(sig->event_id);
+    }
+  }
+
+  // Retires the packet at the read pointer.  Returns false if there is none or
+  // it is a barrier whose dependencies are not yet satisfied.
+  bool ProcessPacket() {
+    const uint64_t read = __atomic_load_n(read_ptr_, __ATOMIC_ACQUIRE);
+    if (read >= __atomic_load_n(write_ptr_, __ATOMIC_ACQUIRE)) return false;
+
+    hsa_barrier_and_packet_t* pkt = &ring_[read & mask_];
+    const uint16_t header = __atomic_load_n(&pkt->header, __ATOMIC_ACQUIRE);
+    const uint32_t type =
+        (header >> HSA_PACKET_HEADER_TYPE) & ((1 << HSA_PACKET_HEADER_WIDTH_TYPE) - 1);
+
+    switch (type) {
+      case HSA_PACKET_TYPE_INVALID:
+        // Slot reserved by the producer but not yet published.
+        return false;
+      case HSA_PACKET_TYPE_BARRIER_AND:
+        if (!BarrierAnd(pkt)) return false;
+        break;
+      case HSA_PACKET_TYPE_BARRIER_OR:
+        if (!BarrierOr(reinterpret_cast<hsa_barrier_or_packet_t*>(pkt))) return false;
+        break;
+      default:
+        break;
+    }
+
+    // All AQL packet formats keep the completion signal in the last 8 bytes.
+    Complete(pkt->completion_signal);
+
+    __atomic_store_n(&pkt->header, uint16_t(HSA_PACKET_TYPE_INVALID << HSA_PACKET_HEADER_TYPE),
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(read_ptr_, read + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  hsa_barrier_and_packet_t* ring_;
+  const uint64_t mask_;
+  volatile uint64_t* read_ptr_;
+  volatile uint64_t* write_ptr_;
+  // Target of the runtime's doorbell stores.  Never read, the processor polls
+  // the write pointer instead.
+  volatile uint64_t doorbell_;
+  std::atomic<bool> active_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+std::mutex queue_lock;
+std::map<HSA_QUEUEID, std::unique_ptr<PacketProcessor>> queues;
+HSA_QUEUEID next_queue_id = 1;
+
+}  // namespace
+
+void ShutdownQueues() {
+  // Declared first so that processor threads are joined after the lock is released.
+  std::map<HSA_QUEUEID, std::unique_ptr<PacketProcessor>> stopped;
+  std::lock_guard<std::mutex> lock(queue_lock);
+  stopped.swap(queues);
+}
+
+}  // namespace sim
+}  // namespace rocr
+
+using namespace rocr::sim;
+
+// Only AQL compute queues are emulated.  SDMA creation fails, which makes the
+// runtime fall back to blit kernels for all copies.
+HSAKMT_STATUS hsaKmtCreateQueue(HSAuint32 NodeId, HSA_QUEUE_TYPE Type, HSAuint32 QueuePercentage,
+                                HSA_QUEUE_PRIORITY Priority, void* QueueAddress,
+                                HSAuint64 QueueSizeInBytes, HsaEvent* Event,
+                                HsaQueueResource* QueueResource) {
+  if ((QueueAddress == nullptr) || (QueueResource == nullptr)) return HSAKMT_STATUS_INVALID_PARAMETER;
+  if ((NodeId >= Nodes().size()) || !Nodes()[NodeId].IsGpu()) return HSAKMT_STATUS_INVALID_NODE_UNIT;
+  if (Type != HSA_QUEUE_COMPUTE_AQL) return HSAKMT_STATUS_NOT_SUPPORTED;
+
+  const uint64_t packets = QueueSizeInBytes / sizeof(hsa_barrier_and_packet_t);
+  if ((packets == 0) || ((packets & (packets - 1)) != 0) ||
+      (QueueResource->Queue_read_ptr_aql == nullptr) ||
+      (QueueResource->Queue_write_ptr_aql == nullptr))
+    return HSAKMT_STATUS_INVALID_PARAMETER;
+
+  std::unique_ptr<PacketProcessor> queue(
+      new PacketProcessor(QueueAddress, QueueSizeInBytes, QueueResource->Queue_read_ptr_aql,
+                          QueueResource->Queue_write_ptr_aql));
+  queue->active(QueuePercentage != 0);
+
+  std::lock_guard<std::mutex> lock(queue_lock);
+  QueueResource->QueueId = next_queue_id++;
+  QueueResource->Queue_DoorBell_aql = const_cast<HSAuint64*>(queue->doorbell());
+  queues[QueueResource->QueueId] = std::move(queue);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtUpdateQueue(HSA_QUEUEID QueueId, HSAuint32 QueuePercentage,
+                                HSA_QUEUE_PRIORITY Priority, void* QueueAddress,
+                                HSAuint64 QueueSize, HsaEvent* Event) {
+  std::lock_guard<std::mutex> lock(queue_lock);
+  auto it = queues.find(QueueId);
+  if (it == queues.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+  it->second->active(QueuePercentage != 0);
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+HSAKMT_STATUS hsaKmtDestroyQueue(HSA_QUEUEID QueueId) {
+  std::unique_ptr<PacketProcessor> queue;
+  {
+    std::lock_guard<std::mutex> lock(queue_lock);
+    auto it = queues.find(QueueId);
+    if (it == queues.end()) return HSAKMT_STATUS_INVALID_PARAMETER;
+    queue = std::move(it->second);
+    queues.erase(it);
+  }
+  // Joins the processor thread outside the lock.
+  queue.reset();
+  return HSAKMT_STATUS_SUCCESS;
+}
+
+// CU masks and GWS have no effect on a processor which does not execute kernels.
+HSAKMT_STATUS hsaKmtSetQueueCUMask(HSA_QUEUEID QueueId, HSAuint32 CUMaskCount,
+                                   HSAuint32* QueueCUMask) {
+  std::lock_guard<std::mutex> lock(queue_lock);
+  return (queues.count(QueueId) != 0) ? HSAKMT_STATUS_SUCCESS : HSAKMT_STATUS_INVALID_PARAMETER;
+}
+
+HSAKMT_STATUS hsaKmtAllocQueueGWS(HSA_QUEUEID QueueId, HSAuint32 nGWS, HSAuint32* firstGWS) {
+  return HSAKMT_STATUS_NOT_SUPPORTED;
+}
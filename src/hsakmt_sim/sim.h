@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Internal interfaces of the simulated thunk.  The public interface is hsakmt.h.
+
+#ifndef HSA_RUNTIME_HSAKMT_SIM_SIM_H_
+#define HSA_RUNTIME_HSAKMT_SIM_SIM_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "hsakmt.h"
+
+namespace rocr {
+namespace sim {
+
+/// @brief Simulated KFD node.  Property tables are built once when the
+/// topology is loaded and returned by copy from the topology queries.
+struct Node {
+  HsaNodeProperties props;
+  std::vector<HsaMemoryProperties> memory;
+  std::vector<HsaIoLinkProperties> links;
+
+  bool IsGpu() const { return props.NumFComputeCores != 0; }
+};
+
+/// @brief Loads the topology from the file named by HSAKMT_SIM_TOPOLOGY, or the
+/// built in description when unset.  Returns false and fills @p error when the
+/// description is malformed.
+bool LoadTopology(std::vector<Node>& nodes, std::string& error);
+
+/// @brief Returns the loaded node table.  Only valid while the KFD is open.
+const std::vector<Node>& Nodes();
+
+/// @brief Simulated GPU and system clock, in nanoseconds.
+uint64_t ClockNs();
+
+/// @brief Signals the event with the given id, as the interrupt handler does
+/// for a signal event written to its mailbox.
+void SignalEventId(uint32_t event_id);
+
+/// @brief Number of events currently created through the thunk.
+size_t LiveEvents();
+
+/// @brief Caps the number of events the thunk creates, as KFD limits signal
+/// events per process.  Creation beyond the cap fails.
+void SetEventLimit(size_t limit);
+
+/// @brief Returns true while @p ptr lies in memory allocated or registered
+/// through the thunk.  Lets tests observe the lifetime of runtime buffers.
+bool IsTracked(const void* ptr);
+
+/// @brief Releases events, queues and allocations when the KFD is closed.
+void ShutdownEvents();
+void ShutdownQueues();
+void ShutdownMemory();
+
+}  // namespace sim
+}  // namespace rocr
+
+#endif  // HSA_RUNTIME_HSAKMT_SIM_SIM_H_
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// HSA_CU_MASK on the simulated thunk.  Runs with HSA_CU_MASK restricting the
+// first GPU to CUs 0-3.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "inc/hsa_ext_amd.h"
+#include "hsakmt_sim/tests/sim_test.h"
+
+namespace {
+
+hsa_agent_t gpu;
+
+// Queues start out restricted to the HSA_CU_MASK set.
+void DefaultMaskHonoursEnv() {
+  hsa_queue_t* queue = nullptr;
+  EXPECT_SUCCESS(hsa_queue_create(gpu, 64, HSA_QUEUE_TYPE_MULTI, nullptr, nullptr, UINT32_MAX,
+                                  UINT32_MAX, &queue));
+  if (queue == nullptr) return;
+
+  uint32_t mask[2] = {0, 0};
+  EXPECT_SUCCESS(hsa_amd_queue_cu_get_mask(queue, 64, mask));
+  EXPECT(mask[0] == 0xF);
+  EXPECT(mask[1] == 0);
+
+  // Asking for every CU is clipped to the HSA_CU_MASK set.
+  const uint32_t all[2] = {UINT32_MAX, UINT32_MAX};
+  EXPECT(hsa_amd_queue_cu_set_mask(queue, 64, all) == hsa_status_t(HSA_STATUS_CU_MASK_REDUCED));
+  EXPECT_SUCCESS(hsa_amd_queue_cu_get_mask(queue, 64, mask));
+  EXPECT(mask[0] == 0xF);
+
+  EXPECT_SUCCESS(hsa_queue_destroy(queue));
+}
+
+}  // namespace
+
+int main() {
+  setenv("HSA_CU_MASK", "0:0-3", 1);
+  if (hsa_init() != HSA_STATUS_SUCCESS) {
+    fprintf(stderr, "hsa_init failed\n");
+    return 1;
+  }
+  gpu = rocr::sim::test::Gpu();
+  EXPECT(gpu.handle != 0);
+  if (gpu.handle != 0) rocr::sim::test::Run("default_mask_honours_env", DefaultMaskHonoursEnv);
+  EXPECT_SUCCESS(hsa_shut_down());
+  return rocr::sim::test::Failures();
+}
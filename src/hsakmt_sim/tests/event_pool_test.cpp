@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Interrupt event pool on the simulated thunk.  Runs with HSA_EVENT_POOL_SIZE=8,
+// runtime counters enabled and no spinning before signal waits sleep.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <thread>
+#include <vector>
+
+#include "core/inc/interrupt_signal.h"
+#include "core/util/counters.h"
+#include "hsakmt_sim/sim.h"
+#include "hsakmt_sim/tests/sim_test.h"
+#include "inc/hsa_ext_amd.h"
+
+using rocr::core::InterruptSignal;
+using rocr::core::Signal;
+namespace counters = rocr::counters;
+
+namespace {
+
+const uint32_t kPoolSize = 8;
+
+uint64_t LiveCount() {
+  return counters::Read(counters::InterruptEventAlloc) -
+      counters::Read(counters::InterruptEventFree);
+}
+
+InterruptSignal* Interrupt(hsa_signal_t signal) {
+  return static_cast<InterruptSignal*>(Signal::Convert(signal));
+}
+
+hsa_signal_t CreateSignal() {
+  hsa_signal_t signal = {0};
+  EXPECT_SUCCESS(hsa_signal_create(1, 0, nullptr, &signal));
+  return signal;
+}
+
+// Sleeps taken by a wait_any on @p signal which another thread satisfies after 100ms.
+uint64_t SleepsInWait(hsa_signal_t signal) {
+  uint64_t freq;
+  hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &freq);
+  hsa_signal_condition_t condition = HSA_SIGNAL_CONDITION_EQ;
+  hsa_signal_value_t value = 0;
+  hsa_signal_store_relaxed(signal, 1);
+  std::thread setter([signal]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    hsa_signal_store_screlease(signal, 0);
+  });
+  const uint64_t before = counters::Read(counters::SignalWaitSleep);
+  EXPECT(hsa_amd_signal_wait_any(1, &signal, &condition, &value, 5 * freq,
+                                 HSA_WAIT_STATE_BLOCKED, nullptr) == 0);
+  const uint64_t sleeps = counters::Read(counters::SignalWaitSleep) - before;
+  setter.join();
+  return sleeps;
+}
+
+// Signals take events from the pool created at init until it is empty, only then is the driver
+// entered.
+void PreSizedPool() {
+  const uint64_t live = LiveCount();
+  const size_t driver_events = rocr::sim::LiveEvents();
+
+  std::vector<hsa_signal_t> signals;
+  while ((rocr::sim::LiveEvents() == driver_events) && (signals.size() <= 2 * kPoolSize))
+    signals.push_back(CreateSignal());
+  EXPECT(rocr::sim::LiveEvents() == driver_events + 1);
+  EXPECT(signals.size() > kPoolSize - live);
+  EXPECT(LiveCount() == live + signals.size());
+  EXPECT(counters::Read(counters::InterruptEventPeak) == LiveCount());
+
+  // Released events return to the pool rather than the driver.
+  for (hsa_signal_t signal : signals) EXPECT_SUCCESS(hsa_signal_destroy(signal));
+  EXPECT(LiveCount() == live);
+  EXPECT(rocr::sim::LiveEvents() == driver_events + 1);
+}
+
+// Once the driver is out of events signals share events round robin.  Waiters on signals sharing
+// an event are all woken, and only waits involving a shared event cap their sleeps.
+void Multiplex() {
+  rocr::sim::SetEventLimit(rocr::sim::LiveEvents());
+
+  std::vector<hsa_signal_t> dedicated;
+  std::vector<hsa_signal_t> shared;
+  while ((shared.size() < 5) && (dedicated.size() < 64)) {
+    hsa_signal_t signal = CreateSignal();
+    if (Interrupt(signal)->SharedEvent())
+      shared.push_back(signal);
+    else
+      dedicated.push_back(signal);
+  }
+  EXPECT(shared.size() == 5);
+  EXPECT(!dedicated.empty());
+  EXPECT(counters::Read(counters::InterruptEventMux) == shared.size());
+  if ((shared.size() != 5) || dedicated.empty()) return;
+  EXPECT(Interrupt(shared[0])->EopEvent() == Interrupt(shared[4])->EopEvent());
+
+  hsa_signal_value_t results[2] = {1, 1};
+  std::thread first([&]() {
+    results[0] = rocr::sim::test::WaitEq(shared[0], 0) ? 0 : 1;
+  });
+  std::thread second([&]() {
+    results[1] = rocr::sim::test::WaitEq(shared[4], 0) ? 0 : 1;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  hsa_signal_store_screlease(shared[0], 0);
+  hsa_signal_store_screlease(shared[4], 0);
+  first.join();
+  second.join();
+  EXPECT(results[0] == 0);
+  EXPECT(results[1] == 0);
+
+  EXPECT(SleepsInWait(dedicated[0]) <= 2);
+  EXPECT(SleepsInWait(shared[1]) >= 10);
+
+  for (hsa_signal_t signal : dedicated) EXPECT_SUCCESS(hsa_signal_destroy(signal));
+  for (hsa_signal_t signal : shared) EXPECT_SUCCESS(hsa_signal_destroy(signal));
+}
+
+}  // namespace
+
+int main() {
+  setenv("HSA_EVENT_POOL_SIZE", "8", 1);
+  setenv("HSA_RUNTIME_COUNTERS", "1", 1);
+  setenv("HSA_SIGNAL_WAIT_SPIN_US", "0", 1);
+  if (hsa_init() != HSA_STATUS_SUCCESS) {
+    fprintf(stderr, "hsa_init failed\n");
+    return 1;
+  }
+  rocr::sim::test::Run("pre_sized_pool", PreSizedPool);
+  rocr::sim::test::Run("multiplex", Multiplex);
+  EXPECT_SUCCESS(hsa_shut_down());
+  return rocr::sim::test::Failures();
+}
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// System memory placement policies on the simulated thunk.  Runs with
+// HSA_SYSMEM_HUGE_PAGE_THRESHOLD=2MB and HSA_SYSMEM_INTERLEAVE=1, and checks
+// the kernel's view of the pages in /proc/self.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "core/inc/runtime.h"
+#include "hsakmt_sim/sim.h"
+#include "hsakmt_sim/tests/sim_test.h"
+#include "inc/hsa_ext_amd.h"
+
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+hsa_agent_t cpu;
+hsa_amd_memory_pool_t cpu_pool;
+
+hsa_status_t FindCpu(hsa_agent_t agent, void* data) {
+  hsa_device_type_t type;
+  if (hsa_agent_get_info(agent, HSA_AGENT_INFO_DEVICE, &type) != HSA_STATUS_SUCCESS ||
+      type != HSA_DEVICE_TYPE_CPU)
+    return HSA_STATUS_SUCCESS;
+  *reinterpret_cast<hsa_agent_t*>(data) = agent;
+  return HSA_STATUS_INFO_BREAK;
+}
+
+hsa_status_t FindPool(hsa_amd_memory_pool_t pool, void* data) {
+  hsa_amd_segment_t segment;
+  bool alloc_allowed;
+  if (hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_SEGMENT, &segment) !=
+          HSA_STATUS_SUCCESS ||
+      hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_RUNTIME_ALLOC_ALLOWED,
+                                   &alloc_allowed) != HSA_STATUS_SUCCESS)
+    return HSA_STATUS_SUCCESS;
+  if ((segment != HSA_AMD_SEGMENT_GLOBAL) || !alloc_allowed) return HSA_STATUS_SUCCESS;
+  *reinterpret_cast<hsa_amd_memory_pool_t*>(data) = pool;
+  return HSA_STATUS_INFO_BREAK;
+}
+
+// Returns the first line of @p path, or an empty string if it can not be read.
+std::string ReadLine(const char* path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+// Returns the AnonHugePages size in kB of the mapping containing @p ptr.
+size_t AnonHugePagesKb(const void* ptr) {
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_vma = false;
+  while (std::getline(smaps, line)) {
+    uintptr_t start, end;
+    if (sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2) {
+      in_vma = (start <= addr) && (addr < end);
+      continue;
+    }
+    size_t kb;
+    if (in_vma && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1) return kb;
+  }
+  return 0;
+}
+
+// Returns the /proc/self/numa_maps line of the mapping starting at @p ptr.
+std::string NumaMapsLine(const void* ptr) {
+  char prefix[32];
+  snprintf(prefix, sizeof(prefix), "%lx ", reinterpret_cast<unsigned long>(ptr));
+  std::ifstream maps("/proc/self/numa_maps");
+  std::string line;
+  while (std::getline(maps, line))
+    if (line.compare(0, strlen(prefix), prefix) == 0) return line;
+  return std::string();
+}
+
+// Counts the nodes listed in a sysfs node list such as "0-1,3".
+int NodeCount(const std::string& list) {
+  int count = 0;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    int first, last;
+    const int fields = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (fields == 2)
+      count += last - first + 1;
+    else if (fields == 1)
+      count++;
+  }
+  return count;
+}
+
+void ExpectPoolPointer(void* ptr) {
+  hsa_amd_pointer_info_t info;
+  info.size = sizeof(info);
+  EXPECT_SUCCESS(hsa_amd_pointer_info(ptr, &info, nullptr, nullptr, nullptr));
+  EXPECT(info.type == HSA_EXT_POINTER_TYPE_HSA);
+  EXPECT(info.agentOwner.handle == cpu.handle);
+}
+
+// Huge page advice is applied before the pages are first touched, so the kernel backs them with
+// transparent huge pages.
+void HugePagesBeforeTouch() {
+  const size_t size = 2 * kHugePageSize;
+  void* ptr = nullptr;
+  EXPECT_SUCCESS(hsa_amd_memory_pool_allocate(cpu_pool, size, 0, &ptr));
+  if (ptr == nullptr) return;
+  EXPECT((reinterpret_cast<uintptr_t>(ptr) & (kHugePageSize - 1)) == 0);
+  EXPECT(rocr::sim::IsTracked(ptr));
+
+  memset(ptr, 0x5a, size);
+  const std::string thp = ReadLine("/sys/kernel/mm/transparent_hugepage/enabled");
+  if (!thp.empty() && thp.find("[never]") == std::string::npos)
+    EXPECT(AnonHugePagesKb(ptr) >= kHugePageSize / 1024);
+  ExpectPoolPointer(ptr);
+
+  EXPECT_SUCCESS(hsa_amd_memory_pool_free(ptr));
+  EXPECT(!rocr::sim::IsTracked(ptr));
+}
+
+// Allocations below the threshold are still made by the thunk.
+void SmallAllocation() {
+  void* ptr = nullptr;
+  EXPECT_SUCCESS(hsa_amd_memory_pool_allocate(cpu_pool, 64 * 1024, 0, &ptr));
+  if (ptr == nullptr) return;
+  EXPECT(rocr::sim::IsTracked(ptr));
+  EXPECT(AnonHugePagesKb(ptr) == 0);
+  ExpectPoolPointer(ptr);
+  EXPECT_SUCCESS(hsa_amd_memory_pool_free(ptr));
+  EXPECT(!rocr::sim::IsTracked(ptr));
+}
+
+// The runtime's own system memory carries the interleave policy.  The policy is only visible in
+// numa_maps on machines with more than one memory node.
+void InterleaveBeforeTouch() {
+  rocr::core::Runtime* runtime = rocr::core::Runtime::runtime_singleton_;
+  const size_t size = 64 * 1024;
+  void* ptr = runtime->system_allocator()(size, 0, 0);
+  EXPECT(ptr != nullptr);
+  if (ptr == nullptr) return;
+  EXPECT(rocr::sim::IsTracked(ptr));
+  memset(ptr, 0, size);
+  ExpectPoolPointer(ptr);
+
+  if (NodeCount(ReadLine("/sys/devices/system/node/has_memory")) > 1)
+    EXPECT(NumaMapsLine(ptr).find("interleave") != std::string::npos);
+
+  runtime->system_deallocator()(ptr);
+  EXPECT(!rocr::sim::IsTracked(ptr));
+}
+
+}  // namespace
+
+int main() {
+  setenv("HSA_SYSMEM_HUGE_PAGE_THRESHOLD", "2097152", 1);
+  setenv("HSA_SYSMEM_INTERLEAVE", "1", 1);
+  if (hsa_init() != HSA_STATUS_SUCCESS) {
+    fprintf(stderr, "hsa_init failed\n");
+    return 1;
+  }
+  cpu.handle = 0;
+  cpu_pool.handle = 0;
+  hsa_iterate_agents(FindCpu, &cpu);
+  EXPECT(cpu.handle != 0);
+  if (cpu.handle != 0) hsa_amd_agent_iterate_memory_pools(cpu, FindPool, &cpu_pool);
+  EXPECT(cpu_pool.handle != 0);
+  if (cpu_pool.handle != 0) {
+    rocr::sim::test::Run("huge_pages_before_touch", HugePagesBeforeTouch);
+    rocr::sim::test::Run("small_allocation", SmallAllocation);
+    rocr::sim::test::Run("interleave_before_touch", InterleaveBeforeTouch);
+  }
+  EXPECT_SUCCESS(hsa_shut_down());
+  return rocr::sim::test::Failures();
+}
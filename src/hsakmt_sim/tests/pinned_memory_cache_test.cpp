@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// PinnedMemoryCache driven by a mock thunk.  Host addresses are never
+// dereferenced, registrations are recorded in the mock.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core/inc/amd_pinned_memory_cache.h"
+#include "core/util/counters.h"
+#include "hsakmt_sim/tests/sim_test.h"
+
+using rocr::AMD::PinnedMemoryCache;
+
+namespace {
+
+const uintptr_t kAgentOffset = uintptr_t(1) << 44;
+const size_t kSize = 64 * 1024;
+
+struct MockThunk {
+  std::vector<void*> registered;
+  std::vector<void*> deregistered;
+  uint32_t register_calls = 0;
+  // Registrations fail while this many or more are live, as when the pinning limit is reached.
+  size_t max_live = SIZE_MAX;
+
+  void* Register(void* ptr) {
+    register_calls++;
+    if (registered.size() >= max_live) return nullptr;
+    registered.push_back(ptr);
+    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ptr) + kAgentOffset);
+  }
+
+  void Deregister(void* ptr) {
+    auto it = std::find(registered.begin(), registered.end(), ptr);
+    EXPECT(it != registered.end());
+    if (it != registered.end()) registered.erase(it);
+    deregistered.push_back(ptr);
+  }
+
+  bool IsRegistered(void* ptr) const {
+    return std::find(registered.begin(), registered.end(), ptr) != registered.end();
+  }
+};
+
+struct Fixture {
+  MockThunk thunk;
+  PinnedMemoryCache cache;
+  int owner;
+
+  explicit Fixture(size_t budget)
+      : cache([this](const void*, void* ptr, size_t, const std::vector<uint32_t>&) {
+                return thunk.Register(ptr);
+              },
+              [this](void* ptr) { thunk.Deregister(ptr); }) {
+    cache.budget(budget);
+  }
+
+  ~Fixture() { cache.Flush(nullptr, 0); }
+
+  void* Lock(uintptr_t addr, size_t size, const std::vector<uint32_t>& nodes) {
+    return cache.Lock(&owner, reinterpret_cast<void*>(addr), size, nodes);
+  }
+
+  bool Unlock(uintptr_t addr) { return cache.Unlock(reinterpret_cast<void*>(addr)); }
+};
+
+void* Agent(uintptr_t addr) { return reinterpret_cast<void*>(addr + kAgentOffset); }
+
+void* Host(uintptr_t addr) { return reinterpret_cast<void*>(addr); }
+
+void SubRangeHit() {
+  Fixture f(16 * kSize);
+  const uintptr_t base = 0x10000000;
+  rocr::counters::Reset();
+
+  EXPECT(f.Lock(base, kSize, {1}) == Agent(base));
+  EXPECT(f.Unlock(base));
+  EXPECT(f.thunk.IsRegistered(Host(base)));
+
+  // An idle registration covering the range serves the lock at the matching offset.
+  EXPECT(f.Lock(base + 0x1000, 0x2000, {1}) == Agent(base + 0x1000));
+  EXPECT(f.thunk.register_calls == 1);
+
+  // A locked registration also serves further locks.
+  EXPECT(f.Lock(base + 0x3000, 0x100, {1}) == Agent(base + 0x3000));
+  EXPECT(f.thunk.register_calls == 1);
+
+  // A range running past the registration misses.
+  EXPECT(f.Lock(base + kSize - 0x1000, 0x2000, {1}) != nullptr);
+  EXPECT(f.thunk.register_calls == 2);
+
+  EXPECT(f.Unlock(base + 0x1000));
+  EXPECT(f.Unlock(base + 0x3000));
+  EXPECT(f.Unlock(base + kSize - 0x1000));
+  EXPECT(!f.Unlock(base + 0x1000));
+
+  EXPECT(rocr::counters::Read(rocr::counters::PinnedCacheHit) == 2);
+  EXPECT(rocr::counters::Read(rocr::counters::PinnedCacheMiss) == 2);
+}
+
+void NodeSuperset() {
+  Fixture f(16 * kSize);
+  const uintptr_t base = 0x20000000;
+
+  EXPECT(f.Lock(base, kSize, {1, 2, 3}) != nullptr);
+  EXPECT(f.Unlock(base));
+
+  // Any subset of the mapped nodes is served by the registration.
+  EXPECT(f.Lock(base, kSize, {2}) == Agent(base));
+  EXPECT(f.Lock(base, kSize, {1, 3}) == Agent(base));
+  EXPECT(f.thunk.register_calls == 1);
+  EXPECT(f.Unlock(base));
+  EXPECT(f.Unlock(base));
+
+  // A node outside the set needs a new registration, the idle one is dropped first since pages
+  // may only be registered once.
+  EXPECT(f.Lock(base, kSize, {2, 4}) == Agent(base));
+  EXPECT(f.thunk.register_calls == 2);
+  EXPECT(f.thunk.deregistered.size() == 1);
+  EXPECT(f.thunk.registered.size() == 1);
+  EXPECT(f.Unlock(base));
+}
+
+void LruTrim() {
+  Fixture f(2 * kSize);
+  const uintptr_t a = 0x30000000, b = a + 0x100000, c = b + 0x100000;
+
+  EXPECT(f.Lock(a, kSize, {1}) != nullptr);
+  EXPECT(f.Lock(b, kSize, {1}) != nullptr);
+  EXPECT(f.Lock(c, kSize, {1}) != nullptr);
+
+  EXPECT(f.Unlock(a));
+  EXPECT(f.Unlock(b));
+  EXPECT(f.thunk.deregistered.empty());
+
+  // Touching a makes b the least recently used.
+  EXPECT(f.Lock(a, kSize, {1}) == Agent(a));
+  EXPECT(f.Unlock(a));
+
+  // Releasing c exceeds the budget by one registration.
+  EXPECT(f.Unlock(c));
+  EXPECT(f.thunk.deregistered.size() == 1);
+  EXPECT(!f.thunk.IsRegistered(Host(b)));
+  EXPECT(f.thunk.IsRegistered(Host(a)));
+  EXPECT(f.thunk.IsRegistered(Host(c)));
+
+  // Lowering the budget trims immediately.
+  f.cache.budget(kSize);
+  EXPECT(!f.thunk.IsRegistered(Host(a)));
+  EXPECT(f.thunk.IsRegistered(Host(c)));
+}
+
+void FlushPageOverlap() {
+  Fixture f(16 * kSize);
+  const uintptr_t page = 0x40000000;
+
+  // A registration in the middle of a page.
+  EXPECT(f.Lock(page + 0x100, 0x100, {1}) != nullptr);
+  EXPECT(f.Unlock(page + 0x100));
+
+  // Ranges on the neighbouring pages leave it alone.
+  f.cache.Flush(Host(page + 0x1000), 0x10);
+  f.cache.Flush(Host(page - 0x10), 0x10);
+  EXPECT(f.thunk.IsRegistered(Host(page + 0x100)));
+
+  // Any byte of the same page flushes it, even outside the registered bytes.
+  f.cache.Flush(Host(page + 0xff0), 0x10);
+  EXPECT(!f.thunk.IsRegistered(Host(page + 0x100)));
+
+  // Locked registrations are never flushed.
+  EXPECT(f.Lock(page, kSize, {1}) != nullptr);
+  f.cache.Flush(Host(page), kSize);
+  f.cache.Flush(nullptr, 0);
+  EXPECT(f.thunk.IsRegistered(Host(page)));
+  EXPECT(f.Unlock(page));
+  f.cache.Flush(Host(page + kSize - 1), 1);
+  EXPECT(!f.thunk.IsRegistered(Host(page)));
+}
+
+void FlushAndRetry() {
+  Fixture f(16 * kSize);
+  const uintptr_t a = 0x50000000, b = a + 0x100000, c = b + 0x100000;
+  f.thunk.max_live = 2;
+
+  EXPECT(f.Lock(a, kSize, {1}) != nullptr);
+  EXPECT(f.Lock(b, kSize, {1}) != nullptr);
+  EXPECT(f.Unlock(a));
+
+  // The first registration fails on the limit, the idle registration of a is released and the
+  // retry succeeds.
+  EXPECT(f.Lock(c, kSize, {1}) == Agent(c));
+  EXPECT(f.thunk.register_calls == 4);
+  EXPECT(!f.thunk.IsRegistered(Host(a)));
+
+  // With nothing idle to release the failure is returned without a retry.
+  const uint32_t calls = f.thunk.register_calls;
+  EXPECT(f.Lock(a, kSize, {1}) == nullptr);
+  EXPECT(f.thunk.register_calls == calls + 1);
+
+  EXPECT(f.Unlock(b));
+  EXPECT(f.Unlock(c));
+}
+
+}  // namespace
+
+int main() {
+  rocr::counters::Enable(true);
+  rocr::sim::test::Run("sub_range_hit", SubRangeHit);
+  rocr::sim::test::Run("node_superset", NodeSuperset);
+  rocr::sim::test::Run("lru_trim", LruTrim);
+  rocr::sim::test::Run("flush_page_overlap", FlushPageOverlap);
+  rocr::sim::test::Run("flush_and_retry", FlushAndRetry);
+  return rocr::sim::test::Failures();
+}
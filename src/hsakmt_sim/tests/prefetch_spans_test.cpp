@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Runtime::CoalescePrefetchSpans, which merges the ranges of a batch of SVM
+// prefetches before they are issued to the driver.
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "core/inc/runtime.h"
+#include "hsakmt_sim/tests/sim_test.h"
+
+using rocr::core::Runtime;
+
+namespace {
+
+typedef Runtime::PrefetchSpan Span;
+
+const uintptr_t kPage = 0x1000;
+
+bool Equal(const std::vector<Span>& spans, const std::vector<Span>& expected) {
+  if (spans.size() != expected.size()) return false;
+  for (size_t i = 0; i < spans.size(); i++) {
+    if ((spans[i].base != expected[i].base) || (spans[i].bytes != expected[i].bytes) ||
+        (spans[i].node_id != expected[i].node_id))
+      return false;
+  }
+  return true;
+}
+
+void Empty() {
+  std::vector<Span> spans;
+  Runtime::CoalescePrefetchSpans(spans);
+  EXPECT(spans.empty());
+}
+
+// Disjoint spans are only sorted.
+void SortsDisjoint() {
+  std::vector<Span> spans = {{8 * kPage, kPage, 1}, {0, kPage, 1}, {4 * kPage, 2 * kPage, 1}};
+  Runtime::CoalescePrefetchSpans(spans);
+  EXPECT(Equal(spans, {{0, kPage, 1}, {4 * kPage, 2 * kPage, 1}, {8 * kPage, kPage, 1}}));
+}
+
+// Touching and overlapping spans to one node become a single span, including chains and spans
+// contained in another.
+void MergesSameNode() {
+  std::vector<Span> spans = {{2 * kPage, kPage, 1},
+                             {0, 2 * kPage, 1},
+                             {kPage, 4 * kPage, 1},
+                             {2 * kPage, kPage, 1},
+                             {5 * kPage, kPage, 1}};
+  Runtime::CoalescePrefetchSpans(spans);
+  EXPECT(Equal(spans, {{0, 6 * kPage, 1}}));
+}
+
+// Spans to different nodes are kept apart even when they touch.
+void KeepsNodesApart() {
+  std::vector<Span> spans = {
+      {kPage, kPage, 2}, {0, kPage, 1}, {2 * kPage, kPage, 2}, {3 * kPage, kPage, 1}};
+  Runtime::CoalescePrefetchSpans(spans);
+  EXPECT(Equal(spans, {{0, kPage, 1}, {kPage, 2 * kPage, 2}, {3 * kPage, kPage, 1}}));
+}
+
+}  // namespace
+
+int main() {
+  rocr::sim::test::Run("empty", Empty);
+  rocr::sim::test::Run("sorts_disjoint", SortsDisjoint);
+  rocr::sim::test::Run("merges_same_node", MergesSameNode);
+  rocr::sim::test::Run("keeps_nodes_apart", KeepsNodesApart);
+  return rocr::sim::test::Failures();
+}
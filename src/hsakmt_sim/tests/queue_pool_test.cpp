@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// AQL queue ring buffer pooling on the simulated thunk.  Runs with
+// HSA_QUEUE_POOL_SIZE=2 and creates queues of a single size on one GPU.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "hsakmt_sim/sim.h"
+#include "hsakmt_sim/tests/sim_test.h"
+
+namespace {
+
+const uint32_t kQueueSize = 64;
+const uint32_t kPoolSize = 2;
+
+hsa_agent_t gpu;
+
+hsa_queue_t* CreateQueue() {
+  hsa_queue_t* queue = nullptr;
+  EXPECT_SUCCESS(hsa_queue_create(gpu, kQueueSize, HSA_QUEUE_TYPE_MULTI, nullptr, nullptr,
+                                  UINT32_MAX, UINT32_MAX, &queue));
+  return queue;
+}
+
+// A recreated queue must not see packets or indices of the queue whose ring it reuses.
+void ReuseResetsRing() {
+  hsa_queue_t* queue = CreateQueue();
+  if (queue == nullptr) return;
+  void* ring = queue->base_address;
+
+  // Wrap the ring so the indices are well past zero.
+  hsa_signal_t signal;
+  EXPECT_SUCCESS(hsa_signal_create(1, 0, nullptr, &signal));
+  for (uint32_t i = 0; i < kQueueSize + kQueueSize / 2; i++) {
+    hsa_signal_store_relaxed(signal, 1);
+    rocr::sim::test::SubmitBarrier(queue, signal);
+    EXPECT(rocr::sim::test::WaitEq(signal, 0));
+  }
+
+  // Leave valid looking headers in every slot.  The packet processor is idle, the write index
+  // is not advanced.
+  hsa_barrier_and_packet_t* packets = reinterpret_cast<hsa_barrier_and_packet_t*>(ring);
+  for (uint32_t i = 0; i < kQueueSize; i++)
+    __atomic_store_n(&packets[i].header,
+                     uint16_t(HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE),
+                     __ATOMIC_RELEASE);
+  EXPECT_SUCCESS(hsa_queue_destroy(queue));
+  EXPECT(rocr::sim::IsTracked(ring));
+
+  queue = CreateQueue();
+  if (queue == nullptr) return;
+  EXPECT(queue->base_address == ring);
+  EXPECT(hsa_queue_load_read_index_relaxed(queue) == 0);
+  EXPECT(hsa_queue_load_write_index_relaxed(queue) == 0);
+  uint32_t invalid = 0;
+  for (uint32_t i = 0; i < kQueueSize; i++) {
+    const uint16_t header = __atomic_load_n(&packets[i].header, __ATOMIC_ACQUIRE);
+    if (((header >> HSA_PACKET_HEADER_TYPE) & ((1 << HSA_PACKET_HEADER_WIDTH_TYPE) - 1)) ==
+        HSA_PACKET_TYPE_INVALID)
+      invalid++;
+  }
+  EXPECT(invalid == kQueueSize);
+
+  // The reused queue processes packets from index zero.  A stale read index past the write index
+  // would leave the barrier unprocessed.
+  hsa_signal_store_relaxed(signal, 1);
+  rocr::sim::test::SubmitBarrier(queue, signal);
+  EXPECT(rocr::sim::test::WaitEq(signal, 0));
+
+  EXPECT_SUCCESS(hsa_signal_destroy(signal));
+  EXPECT_SUCCESS(hsa_queue_destroy(queue));
+}
+
+// Destroyed queues beyond HSA_QUEUE_POOL_SIZE free their rings, and parked rings are handed out
+// most recently parked first.
+void PoolSizeBound() {
+  const uint32_t kQueues = kPoolSize + 2;
+  std::vector<hsa_queue_t*> queues;
+  std::vector<void*> rings;
+  for (uint32_t i = 0; i < kQueues; i++) {
+    hsa_queue_t* queue = CreateQueue();
+    if (queue == nullptr) return;
+    queues.push_back(queue);
+    rings.push_back(queue->base_address);
+  }
+
+  for (hsa_queue_t* queue : queues) EXPECT_SUCCESS(hsa_queue_destroy(queue));
+  for (uint32_t i = 0; i < kQueues; i++) EXPECT(rocr::sim::IsTracked(rings[i]) == (i < kPoolSize));
+
+  queues.clear();
+  for (uint32_t i = 0; i < kPoolSize; i++) {
+    hsa_queue_t* queue = CreateQueue();
+    if (queue == nullptr) return;
+    queues.push_back(queue);
+    EXPECT(queue->base_address == rings[kPoolSize - 1 - i]);
+  }
+  for (hsa_queue_t* queue : queues) EXPECT_SUCCESS(hsa_queue_destroy(queue));
+}
+
+}  // namespace
+
+int main() {
+  setenv("HSA_QUEUE_POOL_SIZE", "2", 1);
+  if (hsa_init() != HSA_STATUS_SUCCESS) {
+    fprintf(stderr, "hsa_init failed\n");
+    return 1;
+  }
+  gpu = rocr::sim::test::Gpu();
+  EXPECT(gpu.handle != 0);
+  if (gpu.handle != 0) {
+    rocr::sim::test::Run("reuse_resets_ring", ReuseResetsRing);
+    rocr::sim::test::Run("pool_size_bound", PoolSizeBound);
+  }
+  EXPECT_SUCCESS(hsa_shut_down());
+  return rocr::sim::test::Failures();
+}
@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Checks shared by the hsakmt_sim tests.  A failed check is reported and
+// counted, and the test continues.  main returns the failure count.
+
+#ifndef HSA_RUNTIME_HSAKMT_SIM_TESTS_SIM_TEST_H_
+#define HSA_RUNTIME_HSAKMT_SIM_TESTS_SIM_TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#include "inc/hsa.h"
+
+namespace rocr {
+namespace sim {
+namespace test {
+
+inline int& Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline void Fail(const char* file, int line, const char* what) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  Failures()++;
+}
+
+// Runs a test case and reports whether it added failures.
+inline void Run(const char* name, void (*test)()) {
+  const int before = Failures();
+  test();
+  printf("%s %s\n", (Failures() == before) ? "PASS" : "FAIL", name);
+}
+
+inline hsa_status_t FindGpu(hsa_agent_t agent, void* data) {
+  hsa_device_type_t type;
+  if (hsa_agent_get_info(agent, HSA_AGENT_INFO_DEVICE, &type) != HSA_STATUS_SUCCESS ||
+      type != HSA_DEVICE_TYPE_GPU)
+    return HSA_STATUS_SUCCESS;
+  *reinterpret_cast<hsa_agent_t*>(data) = agent;
+  return HSA_STATUS_INFO_BREAK;
+}
+
+// Returns the first GPU agent, or a null handle.
+inline hsa_agent_t Gpu() {
+  hsa_agent_t gpu = {0};
+  hsa_iterate_agents(FindGpu, &gpu);
+  return gpu;
+}
+
+// Publishes a barrier-AND packet with no dependencies and rings the doorbell.
+inline void SubmitBarrier(hsa_queue_t* queue, hsa_signal_t completion) {
+  const uint64_t index = hsa_queue_add_write_index_screlease(queue, 1);
+  while (index - hsa_queue_load_read_index_scacquire(queue) >= queue->size) {
+  }
+
+  hsa_barrier_and_packet_t* packet =
+      reinterpret_cast<hsa_barrier_and_packet_t*>(queue->base_address) +
+      (index & (queue->size - 1));
+  memset(reinterpret_cast<uint8_t*>(packet) + sizeof(packet->header), 0,
+         sizeof(*packet) - sizeof(packet->header));
+  packet->completion_signal = completion;
+
+  const uint16_t header = (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) |
+      (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE) |
+      (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE);
+  __atomic_store_n(&packet->header, header, __ATOMIC_RELEASE);
+  hsa_signal_store_screlease(queue->doorbell_signal, index);
+}
+
+// Waits up to five seconds for @p signal to reach @p value.
+inline bool WaitEq(hsa_signal_t signal, hsa_signal_value_t value) {
+  uint64_t freq;
+  hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &freq);
+  return hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_EQ, value, 5 * freq,
+                                   HSA_WAIT_STATE_BLOCKED) == value;
+}
+
+}  // namespace test
+}  // namespace sim
+}  // namespace rocr
+
+#define EXPECT(cond)                                                      \
+  do {                                                                    \
+    if (!(cond)) rocr::sim::test::Fail(__FILE__, __LINE__, #cond);        \
+  } while (false)
+
+#define EXPECT_SUCCESS(call) EXPECT((call) == HSA_STATUS_SUCCESS)
+
+#endif  // HSA_RUNTIME_HSAKMT_SIM_TESTS_SIM_TEST_H_
@@ -0,0 +1,341 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// The University of Illinois/NCSA
+// Open Source License (NCSA)
+//
+// Copyright (c) 2014-2020, Advanced Micro Devices, Inc. All rights reserved.
+//
+// Developed by:
+//
+//                 AMD Research and AMD HSA Software Development
+//
+//                 Advanced Micro Devices, Inc.
+//
+//                 www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+//  - Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//  - Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimers in
+//    the documentation and/or other materials provided with the distribution.
+//  - Neither the names of Advanced Micro Devices, Inc,
+//    nor the names of its contributors may be used to endorse or promote
+//    products derived from this Software without specific prior written
+//    permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS WITH THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Topology description for the simulated thunk.
+//
+// HSAKMT_SIM_TOPOLOGY names a JSON file of the form:
+//
+// {
+//   "nodes": [
+//     { "type": "cpu", "cores": 16, "memory": 34359738368 },
+//     { "type": "gpu", "gfx": "gfx90a", "compute_units": 104, "vram": 68719476736 }
+//   ],
+//   "links": [ { "from": 0, "to": 1, "type": "pcie", "weight": 20 } ]
+// }
+//
+// Node ids are array indices.  CPU nodes default to the host core count and
+// memory size.  GPU nodes accept gfx, compute_units, simds_per_cu,
+// waves_per_simd, wavefront_size, lds_kb, vram, clock_mhz, device_id,
+// sdma_engines and name.  Without "links" every GPU is linked to the first CPU
+// node over PCIe in both directions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "hsakmt_sim/json.h"
+#include "hsakmt_sim/sim.h"
+
+namespace rocr {
+namespace sim {
+
+namespace {
+
+// Used when HSAKMT_SIM_TOPOLOGY is not set: the host CPU and one gfx900.
+const char kDefaultTopology[] =
+    "{ \"nodes\": [ { \"type\": \"cpu\" },"
+    "  { \"type\": \"gpu\", \"gfx\": \"gfx900\", \"compute_units\": 64, \"vram\": 8589934592 } ] }";
+
+// Group and private segment apertures reported by KFD on 64-bit gfx9+ targets.
+const uint64_t kLdsAperture = 0x1000000000000ull;
+const uint64_t kScratchAperture = 0x2000000000000ull;
+const uint64_t kScratchApertureSize = 1ull << 32;
+
+void SetName(HsaNodeProperties& props, const std::string& name) {
+  size_t len = std::min(name.size(), size_t(HSA_PUBLIC_NAME_SIZE - 1));
+  for (size_t i = 0; i < len; i++) {
+    props.AMDName[i] = HSAuint8(name[i]);
+    props.MarketingName[i] = HSAuint16(name[i]);
+  }
+}
+
+// Splits "gfxMMmS" into major, minor and stepping.  Minor and stepping are
+// single hex digits, as in target names such as gfx90a.
+bool ParseGfx(const std::string& gfx, uint32_t& major, uint32_t& minor, uint32_t& stepping) {
+  if ((gfx.compare(0, 3, "gfx") != 0) || (gfx.size() < 6)) return false;
+  std::string digits = gfx.substr(3);
+  char* end;
+  major = strtoul(digits.substr(0, digits.size() - 2).c_str(), &end, 10);
+  if (*end != '\0') return false;
+  minor = strtoul(digits.substr(digits.size() - 2, 1).c_str(), &end, 16);
+  if (*end != '\0') return false;
+  stepping = strtoul(digits.substr(digits.size() - 1).c_str(), &end, 16);
+  return *end == '\0';
+}
+
+// Rejects members of the wrong type, which would otherwise silently fall back
+// to their defaults.  Everything other than the names below is a count or size.
+bool CheckFields(const JsonValue& desc, std::string& error) {
+  if (desc.type != JsonValue::kObject) {
+    error = "expected an object";
+    return false;
+  }
+  for (const auto& member : desc.object) {
+    const bool text = (member.first == "type") || (member.first == "gfx") ||
+        (member.first == "name");
+    const JsonValue::Type expected = text ? JsonValue::kString : JsonValue::kNumber;
+    if ((member.second.type != expected) ||
+        (!text && (double(member.second.integer) != member.second.number))) {
+      error = "\"" + member.first + "\" must be " +
+          (text ? "a string" : "a non-negative integer");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BuildCpu(const JsonValue& desc, uint32_t& cpu_id_base, Node& node, std::string& error) {
+  const uint64_t host_memory = uint64_t(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+  HsaNodeProperties& props = node.props;
+
+  props.NumCPUCores = desc.GetUint("cores", sysconf(_SC_NPROCESSORS_ONLN));
+  if (props.NumCPUCores == 0) {
+    error = "cpu node has no cores";
+    return false;
+  }
+  props.CComputeIdLo = cpu_id_base;
+  cpu_id_base += props.NumCPUCores;
+  props.MaxEngineClockMhzCCompute = desc.GetUint("clock_mhz", 3000);
+  SetName(props, desc.GetString("name", "Simulated CPU"));
+
+  HsaMemoryProperties mem;
+  memset(&mem, 0, sizeof(mem));
+  mem.HeapType = HSA_HEAPTYPE_SYSTEM;
+  mem.SizeInBytes = desc.GetUint("memory", host_memory);
+  node.memory.push_back(mem);
+  return true;
+}
+
+bool BuildGpu(const JsonValue& desc, uint32_t node_id, uint32_t gpu_index, Node& node,
+              std::string& error) {
+  HsaNodeProperties& props = node.props;
+  const std::string gfx = desc.GetString("gfx", "gfx900");
+  uint32_t major, minor, stepping;
+  if (!ParseGfx(gfx, major, minor, stepping)) {
+    error = "gpu node has invalid gfx target \"" + gfx + "\"";
+    return false;
+  }
+  // Only AQL doorbell semantics are emulated, older targets need the legacy
+  // doorbell and double mapped ring buffers.
+  if (major < 9) {
+    error = gfx + " is not supported, the simulator requires gfx9 or later";
+    return false;
+  }
+
+  const uint32_t cus = desc.GetUint("compute_units", 64);
+  const uint32_t simds = desc.GetUint("simds_per_cu", 4);
+  if ((cus == 0) || (simds == 0)) {
+    error = "gpu node has no compute units";
+    return false;
+  }
+
+  props.NumFComputeCores = cus * simds;
+  props.NumSIMDPerCU = simds;
+  props.MaxWavesPerSIMD = desc.GetUint("waves_per_simd", 10);
+  props.WaveFrontSize = desc.GetUint("wavefront_size", 64);
+  props.LDSSizeInKB = desc.GetUint("lds_kb", 64);
+  props.NumShaderBanks = (cus >= 4) ? 4 : 1;
+  props.NumArrays = 1;
+  props.NumCUPerArray = cus / props.NumShaderBanks;
+  props.MaxSlotsScratchCU = 32;
+  props.FComputeIdLo = 0x80000000u + node_id * 0x1000u;
+  props.Capability.ui32.DoorbellType = 2;
+  props.EngineId.ui32.uCode = 400;
+  props.EngineId.ui32.Major = major;
+  props.EngineId.ui32.Minor = minor;
+  props.EngineId.ui32.Stepping = stepping;
+  props.VendorId = 0x1002;
+  props.DeviceId = desc.GetUint("device_id", 0x687f);
+  props.LocationId = (gpu_index + 1) << 8;
+  props.Domain = 0;
+  props.DrmRenderMinor = 128 + gpu_index;
+  props.UniqueID = uint64_t(node_id) + 1;
+  props.LocalMemSize = desc.GetUint("vram", 8ull << 30);
+  props.MaxEngineClockMhzFCompute = desc.GetUint("clock_mhz", 1500);
+  props.NumSdmaEngines = desc.GetUint("sdma_engines", 2);
+  SetName(props, desc.GetString("name", "Simulated " + gfx));
+
+  // VRAM is host memory, the runtime only needs the heap to report a size.
+  HsaMemoryProperties mem;
+  memset(&mem, 0, sizeof(mem));
+  mem.HeapType = HSA_HEAPTYPE_FRAME_BUFFER_PUBLIC;
+  mem.SizeInBytes = props.LocalMemSize;
+  mem.Width = 2048;
+  mem.MemoryClockMax = 1000;
+  node.memory.push_back(mem);
+
+  memset(&mem, 0, sizeof(mem));
+  mem.HeapType = HSA_HEAPTYPE_GPU_LDS;
+  mem.SizeInBytes = props.LDSSizeInKB * 1024;
+  mem.VirtualBaseAddress = kLdsAperture;
+  node.memory.push_back(mem);
+
+  memset(&mem, 0, sizeof(mem));
+  mem.HeapType = HSA_HEAPTYPE_GPU_SCRATCH;
+  mem.SizeInBytes = kScratchApertureSize;
+  mem.VirtualBaseAddress = kScratchAperture;
+  node.memory.push_back(mem);
+  return true;
+}
+
+bool AddLink(std::vector<Node>& nodes, uint32_t from, uint32_t to, const std::string& type,
+             uint32_t weight, std::string& error) {
+  if ((from >= nodes.size()) || (to >= nodes.size()) || (from == to)) {
+    error = "link " + std::to_string(from) + " -> " + std::to_string(to) + " is invalid";
+    return false;
+  }
+
+  HsaIoLinkProperties link;
+  memset(&link, 0, sizeof(link));
+  if (type == "pcie") {
+    link.IoLinkType = HSA_IOLINKTYPE_PCIEXPRESS;
+  } else if (type == "xgmi") {
+    link.IoLinkType = HSA_IOLINK_TYPE_XGMI;
+  } else {
+    error = "link type \"" + type + "\" is not supported";
+    return false;
+  }
+  link.NodeFrom = from;
+  link.NodeTo = to;
+  link.Weight = weight;
+
+  nodes[from].links.push_back(link);
+  nodes[from].props.NumIOLinks = nodes[from].links.size();
+  return true;
+}
+
+bool ReadFile(const char* path, std::string& text) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::stringstream stream;
+  stream << file.rdbuf();
+  text = stream.str();
+  return true;
+}
+
+}  // namespace
+
+bool LoadTopology(std::vector<Node>& nodes, std::string& error) {
+  std::string text = kDefaultTopology;
+  const char* path = getenv("HSAKMT_SIM_TOPOLOGY");
+  if ((path != nullptr) && (*path != '\0') && !ReadFile(path, text)) {
+    error = std::string("could not read ") + path;
+    return false;
+  }
+
+  JsonValue root;
+  if (!ParseJson(text, root, error)) return false;
+
+  const JsonValue* list = root.Find("nodes");
+  if ((list == nullptr) || (list->type != JsonValue::kArray) || list->array.empty()) {
+    error = "topology has no \"nodes\" array";
+    return false;
+  }
+
+  nodes.clear();
+  nodes.resize(list->array.size());
+  uint32_t cpu_id_base = 0;
+  uint32_t gpus = 0;
+  int first_cpu = -1;
+  for (uint32_t id = 0; id < nodes.size(); id++) {
+    const JsonValue& desc = list->array[id];
+    memset(&nodes[id].props, 0, sizeof(nodes[id].props));
+
+    const std::string type = desc.GetString("type", "");
+    bool ok;
+    if (!CheckFields(desc, error)) {
+      ok = false;
+    } else if (type == "cpu") {
+      ok = BuildCpu(desc, cpu_id_base, nodes[id], error);
+      if (first_cpu < 0) first_cpu = id;
+    } else if (type == "gpu") {
+      ok = BuildGpu(desc, id, gpus++, nodes[id], error);
+    } else {
+      error = "node type must be \"cpu\" or \"gpu\"";
+      ok = false;
+    }
+    if (!ok) {
+      error = "node " + std::to_string(id) + ": " + error;
+      return false;
+    }
+    nodes[id].props.NumMemoryBanks = nodes[id].memory.size();
+  }
+
+  // The runtime's system allocator lives on the first CPU agent.
+  if (first_cpu < 0) {
+    error = "topology has no cpu node";
+    return false;
+  }
+
+  const JsonValue* links = root.Find("links");
+  if (links == nullptr) {
+    for (uint32_t id = 0; id < nodes.size(); id++) {
+      if (!nodes[id].IsGpu()) continue;
+      if (!AddLink(nodes, first_cpu, id, "pcie", 20, error) ||
+          !AddLink(nodes, id, first_cpu, "pcie", 20, error))
+        return false;
+    }
+  } else {
+    if (links->type != JsonValue::kArray) {
+      error = "\"links\" must be an array";
+      return false;
+    }
+    for (const JsonValue& link : links->array) {
+      if (!CheckFields(link, error)) {
+        error = "link: " + error;
+        return false;
+      }
+      if (!AddLink(nodes, link.GetUint("from", UINT32_MAX), link.GetUint("to", UINT32_MAX),
+                   link.GetString("type", "pcie"), link.GetUint("weight", 20), error))
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace sim
+}  // namespace rocr
@@ -187,6 +187,18 @@ struct AmdExtTable {
   decltype(hsa_amd_svm_attributes_get)* hsa_amd_svm_attributes_get_fn;
   decltype(hsa_amd_svm_prefetch_async)* hsa_amd_svm_prefetch_async_fn;
   decltype(hsa_amd_queue_cu_get_mask)* hsa_amd_queue_cu_get_mask_fn;
+  decltype(hsa_amd_runtime_counters_enable)* hsa_amd_runtime_counters_enable_fn;
+  decltype(hsa_amd_runtime_counters_get)* hsa_amd_runtime_counters_get_fn;
+  decltype(hsa_amd_runtime_counters_get_histogram)* hsa_amd_runtime_counters_get_histogram_fn;
+  decltype(hsa_amd_runtime_counters_reset)* hsa_amd_runtime_counters_reset_fn;
+  decltype(hsa_amd_profiling_convert_ticks_to_system_domain)* hsa_amd_profiling_convert_ticks_to_system_domain_fn;
+  decltype(hsa_amd_queue_latency_get_histogram)* hsa_amd_queue_latency_get_histogram_fn;
+  decltype(hsa_amd_runtime_config_set)* hsa_amd_runtime_config_set_fn;
+  decltype(hsa_amd_runtime_config_get)* hsa_amd_runtime_config_get_fn;
+  decltype(hsa_amd_memory_lock_cache_flush)* hsa_amd_memory_lock_cache_flush_fn;
+  decltype(hsa_amd_memory_fill_async)* hsa_amd_memory_fill_async_fn;
+  decltype(hsa_amd_queue_cu_set_mask_batch)* hsa_amd_queue_cu_set_mask_batch_fn;
+  decltype(hsa_amd_executable_get_kernel_dispatch_info)* hsa_amd_executable_get_kernel_dispatch_info_fn;
 };
 
 // Table to export HSA Core Runtime Apis
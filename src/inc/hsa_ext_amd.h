@@ -982,6 +982,18 @@ typedef enum {
   * is size_t.
   */
   HSA_AMD_MEMORY_POOL_INFO_ALLOC_MAX_SIZE = 16,
+  /**
+  * Bytes currently allocated from this pool by the application and the
+  * runtime. The type of this attribute is size_t.
+  */
+  HSA_AMD_MEMORY_POOL_INFO_ALLOCATED_SIZE = 17,
+  /**
+  * Bytes of ::HSA_AMD_MEMORY_POOL_INFO_ALLOCATED_SIZE in allocations which
+  * were advised to use transparent huge pages. Only system memory pools report
+  * a non-zero value, see HSA_SYSMEM_HUGE_PAGE_THRESHOLD. The type of this
+  * attribute is size_t.
+  */
+  HSA_AMD_MEMORY_POOL_INFO_HUGE_PAGE_SIZE = 18,
 } hsa_amd_memory_pool_info_t;
 
 /**
@@ -2354,6 +2366,466 @@ hsa_status_t hsa_amd_svm_prefetch_async(void* ptr, size_t size, hsa_agent_t agen
                                         uint32_t num_dep_signals, const hsa_signal_t* dep_signals,
                                         hsa_signal_t completion_signal);
 
+/**
+ * @brief Runtime event counters.
+ */
+typedef enum {
+  /**
+   * Signal waits satisfied without sleeping in the kernel driver.
+   */
+  HSA_AMD_RUNTIME_COUNTER_SIGNAL_WAIT_SPIN = 0,
+  /**
+   * Sleeps on kernel driver events during signal waits.
+   */
+  HSA_AMD_RUNTIME_COUNTER_SIGNAL_WAIT_SLEEP = 1,
+  /**
+   * Runtime internal queue submissions which stalled on a full ring.
+   */
+  HSA_AMD_RUNTIME_COUNTER_QUEUE_RING_FULL = 2,
+  /**
+   * Shared signal pool block allocations.
+   */
+  HSA_AMD_RUNTIME_COUNTER_SIGNAL_POOL_GROW = 3,
+  /**
+   * Queue scratch requests served from the scratch cache.
+   */
+  HSA_AMD_RUNTIME_COUNTER_SCRATCH_CACHE_HIT = 4,
+  /**
+   * Queue scratch requests which required a new scratch allocation.
+   */
+  HSA_AMD_RUNTIME_COUNTER_SCRATCH_CACHE_MISS = 5,
+  /**
+   * Block allocations made by runtime sub-allocators.
+   */
+  HSA_AMD_RUNTIME_COUNTER_HEAP_BLOCK_ALLOC = 6,
+  /**
+   * Packets deferred by intercept queues because the hardware queue was full.
+   */
+  HSA_AMD_RUNTIME_COUNTER_INTERCEPT_OVERFLOW = 7,
+  /**
+   * Host memory locks served by a cached registration.
+   */
+  HSA_AMD_RUNTIME_COUNTER_PINNED_CACHE_HIT = 8,
+  /**
+   * Host memory locks which required a new registration.
+   */
+  HSA_AMD_RUNTIME_COUNTER_PINNED_CACHE_MISS = 9,
+  /**
+   * Dedicated interrupt events assigned to signals.  Subtracting
+   * HSA_AMD_RUNTIME_COUNTER_INTERRUPT_EVENT_FREE gives the events in use.
+   */
+  HSA_AMD_RUNTIME_COUNTER_INTERRUPT_EVENT_ALLOC = 10,
+  /**
+   * Dedicated interrupt events released by signals.
+   */
+  HSA_AMD_RUNTIME_COUNTER_INTERRUPT_EVENT_FREE = 11,
+  /**
+   * Increments each time the number of dedicated interrupt events in use
+   * reaches a new maximum, so the value is the peak number in use.
+   */
+  HSA_AMD_RUNTIME_COUNTER_INTERRUPT_EVENT_PEAK = 12,
+  /**
+   * Signals multiplexed onto a shared interrupt event because the kernel driver
+   * ran out of events.
+   */
+  HSA_AMD_RUNTIME_COUNTER_INTERRUPT_EVENT_MUX = 13,
+  /**
+   * Number of counters.
+   */
+  HSA_AMD_RUNTIME_COUNTER_COUNT = 14
+} hsa_amd_runtime_counter_t;
+
+/**
+ * @brief Runtime latency histograms.  Bucket i counts samples in the range
+ * [2^i, 2^(i+1)) nanoseconds, bucket 0 also counts zero length samples and
+ * the last bucket is open ended.
+ */
+typedef enum {
+  /**
+   * Time spent in signal waits.
+   */
+  HSA_AMD_RUNTIME_HISTOGRAM_SIGNAL_WAIT_TIME = 0,
+  /**
+   * Number of histograms.
+   */
+  HSA_AMD_RUNTIME_HISTOGRAM_COUNT = 1
+} hsa_amd_runtime_histogram_t;
+
+/**
+ * @brief Maximum number of buckets in a runtime histogram.
+ */
+#define HSA_AMD_RUNTIME_HISTOGRAM_BUCKETS 40
+
+/**
+ * @brief Enable or disable collection of runtime counters and histograms.
+ *
+ * @details Collection is disabled by default unless the HSA_RUNTIME_COUNTERS
+ * environment variable is set to 1.  Disabling collection retains the values
+ * gathered so far.
+ *
+ * @param[in] enable True to enable collection.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_counters_enable(bool enable);
+
+/**
+ * @brief Read runtime counters.
+ *
+ * @param[in] num_counters Number of entries in @p values.  Counters beyond
+ * HSA_AMD_RUNTIME_COUNTER_COUNT are set to zero.
+ *
+ * @param[out] values Array indexed by ::hsa_amd_runtime_counter_t.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p values is NULL.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_counters_get(uint32_t num_counters, uint64_t* values);
+
+/**
+ * @brief Read a runtime histogram.
+ *
+ * @param[in] histogram Histogram to read.
+ *
+ * @param[in] num_buckets Number of entries in @p buckets.  Buckets beyond
+ * HSA_AMD_RUNTIME_HISTOGRAM_BUCKETS are set to zero.
+ *
+ * @param[out] buckets Sample count per bucket.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p histogram is invalid or
+ * @p buckets is NULL.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_counters_get_histogram(hsa_amd_runtime_histogram_t histogram,
+                                                            uint32_t num_buckets,
+                                                            uint64_t* buckets);
+
+/**
+ * @brief Reset all runtime counters and histograms to zero.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_counters_reset();
+
+/**
+ * @brief Converts an array of agent ticks to HSA system domain ticks.
+ *
+ * @details Equivalent to calling
+ * ::hsa_amd_profiling_convert_tick_to_system_domain on each element, but all
+ * ticks are translated against a single clock calibration snapshot.
+ *
+ * @param[in] agent The agent used to retrieve the agent ticks. It is user's
+ * responsibility to make sure the ticks are from this agent, otherwise, the
+ * behavior is undefined.
+ *
+ * @param[in] count Number of entries in @p agent_ticks and @p system_ticks.
+ *
+ * @param[in] agent_ticks Tick counts retrieved from the specified @p agent.
+ *
+ * @param[out] system_ticks The translated HSA system domain clock counter
+ * ticks.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_AGENT The agent is invalid.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p agent_ticks or
+ * @p system_ticks is NULL;
+ */
+hsa_status_t HSA_API hsa_amd_profiling_convert_ticks_to_system_domain(hsa_agent_t agent,
+                                                                      uint32_t count,
+                                                                      const uint64_t* agent_ticks,
+                                                                      uint64_t* system_ticks);
+
+/**
+ * @brief Queue dispatch latencies.
+ */
+typedef enum {
+  /**
+   * Time from the doorbell ring which submitted a kernel dispatch to the start
+   * of the kernel.
+   */
+  HSA_AMD_QUEUE_LATENCY_SUBMIT_TO_START = 0,
+  /**
+   * Time from kernel start to kernel end.
+   */
+  HSA_AMD_QUEUE_LATENCY_START_TO_END = 1
+} hsa_amd_queue_latency_t;
+
+/**
+ * @brief Read a dispatch latency histogram of a queue.
+ *
+ * @details Histograms are collected for GPU queues created while the
+ * environment variable HSA_QUEUE_LATENCY_STATS=1 is set.  Such queues have
+ * profiling enabled.  Bucket i counts completed kernel dispatches whose
+ * latency in nanoseconds lies in [2^i, 2^(i+1)).  Bucket 0 also counts zero
+ * latencies and the last bucket is open ended.
+ *
+ * @param[in] queue Queue to query.
+ *
+ * @param[in] latency Latency to read.
+ *
+ * @param[in] num_buckets Number of entries in @p buckets. At most
+ * HSA_AMD_RUNTIME_HISTOGRAM_BUCKETS entries are written.
+ *
+ * @param[out] buckets Histogram bucket counts.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_QUEUE @p queue is invalid or is not
+ * collecting latency histograms.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p buckets is NULL or
+ * @p latency is invalid.
+ */
+hsa_status_t HSA_API hsa_amd_queue_latency_get_histogram(const hsa_queue_t* queue,
+                                                         hsa_amd_queue_latency_t latency,
+                                                         uint32_t num_buckets, uint64_t* buckets);
+
+/**
+ * @brief Adjust a runtime configuration value while the runtime is running.
+ *
+ * @details Configuration values are normally read once at ::hsa_init from
+ * environment variables or from the file named by HSA_CONFIG_FILE.  The
+ * following values, named after their environment variables, may also be
+ * changed at runtime:
+ *
+ * HSA_FORCE_SDMA_SIZE: copies on a single GPU smaller than this many bytes use
+ * the engine selected for device to host copies.  At most 2^40.
+ *
+ * HSA_SIGNAL_WAIT_SPIN_US: microseconds a signal wait spins before
+ * sleeping.  At most 1000000.
+ *
+ * @param[in] name Name of the value to set.
+ *
+ * @param[in] value New value.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p name is NULL, is not runtime
+ * adjustable, or @p value is out of range.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_config_set(const char* name, uint64_t value);
+
+/**
+ * @brief Read a runtime adjustable configuration value.
+ *
+ * @param[in] name Name of the value, see ::hsa_amd_runtime_config_set.
+ *
+ * @param[out] value Current value.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p name or @p value is NULL, or
+ * @p name is not runtime adjustable.
+ */
+hsa_status_t HSA_API hsa_amd_runtime_config_get(const char* name, uint64_t* value);
+
+/**
+ * @brief Release cached host memory registrations.
+ *
+ * @details When HSA_PINNED_CACHE_BYTES is set, ::hsa_amd_memory_unlock keeps
+ * the registration of the unlocked memory pinned, up to that many bytes, so
+ * that a later ::hsa_amd_memory_lock of the same memory is served without a
+ * kernel driver round trip.  Applications must flush a range before
+ * unmapping or freeing memory which may have been locked.  Ranges which are
+ * still locked are not affected.
+ *
+ * @param[in] host_ptr Start of the range to flush.  NULL flushes all cached
+ * registrations.
+ *
+ * @param[in] size Size of the range in bytes.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ */
+hsa_status_t HSA_API hsa_amd_memory_lock_cache_flush(void* host_ptr, size_t size);
+
+/**
+ * @brief Asynchronously sets the first @p count of uint32_t of the block of
+ * memory pointed by @p ptr to the specified @p value.
+ *
+ * @details The fill starts once every dependency signal has the value 0 and
+ * @p completion_signal is decremented by one when it is done.  Fills of
+ * runtime allocated device memory are performed by the owning GPU, fills of
+ * system memory by the host.  The fill runs on a runtime worker thread, not
+ * on the thread which handles asynchronous signal events.  If the fill fails
+ * after it has been scheduled, @p completion_signal is set to a negative value
+ * instead of being decremented.
+ *
+ * @param[in] ptr Pointer to the block of memory to fill.
+ *
+ * @param[in] value Value to be set.
+ *
+ * @param[in] count Number of uint32_t element to be set to the value.
+ *
+ * @param[in] num_dep_signals Number of dependency signals.
+ *
+ * @param[in] dep_signals List of signals that must be waited on before the
+ * fill starts.
+ *
+ * @param[in] completion_signal Signal decremented when the fill has
+ * completed.  May have a zero handle.
+ *
+ * @retval HSA_STATUS_SUCCESS The fill has been scheduled.
+ *
+ * @retval HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval HSA_STATUS_ERROR_INVALID_ARGUMENT @p ptr is NULL or not 4 bytes
+ * aligned, or @p dep_signals is NULL while @p num_dep_signals is not 0.
+ *
+ * @retval HSA_STATUS_ERROR_INVALID_ALLOCATION @p ptr to @p ptr + @p count * 4
+ * is not within a single allocation known to the runtime.
+ */
+hsa_status_t HSA_API hsa_amd_memory_fill_async(void* ptr, uint32_t value, size_t count,
+                                               uint32_t num_dep_signals,
+                                               const hsa_signal_t* dep_signals,
+                                               hsa_signal_t completion_signal);
+
+/**
+ * @brief Set the CU affinity mask of several queues.
+ *
+ * @details Equivalent to calling ::hsa_amd_queue_cu_set_mask on each queue in
+ * @p queues with the same mask.  Every queue is validated before any mask is
+ * applied.  Queues whose effective mask is already the requested one are not
+ * reprogrammed.
+ *
+ * @param[in] num_queues Number of queues in @p queues.
+ *
+ * @param[in] queues List of pointers to HSA queues.
+ *
+ * @param[in] num_cu_mask_count Size of CUMask bit array passed in, in bits.
+ *
+ * @param[in] cu_mask Bit-vector representing the CU mask.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_CU_MASK_REDUCED The mask was applied to every queue but
+ * attempted to enable a CU disabled by HSA_CU_MASK on at least one of them.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_QUEUE A queue in @p queues is NULL or
+ * invalid.  No mask was applied.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p queues is NULL while
+ * @p num_queues is not 0, @p num_cu_mask_count is not a multiple of 32 or
+ * @p num_cu_mask_count is not 0 and cu_mask is NULL.
+ *
+ * @retval ::HSA_STATUS_ERROR Applying the mask failed on a queue.  Queues
+ * earlier in @p queues may have been updated.
+ */
+hsa_status_t HSA_API hsa_amd_queue_cu_set_mask_batch(uint32_t num_queues,
+                                                     const hsa_queue_t* const* queues,
+                                                     uint32_t num_cu_mask_count,
+                                                     const uint32_t* cu_mask);
+
+/**
+ * @brief Dispatch parameters of a kernel in an executable.
+ *
+ * @details Entries are built by the loader when a code object is loaded and
+ * hold the values ::hsa_executable_symbol_get_info reports for the
+ * corresponding kernel symbol.
+ */
+typedef struct hsa_amd_kernel_dispatch_info_s {
+  /**
+   * Agent the kernel was loaded for.
+   */
+  hsa_agent_t agent;
+  /**
+   * Executable symbol of the kernel.
+   */
+  hsa_executable_symbol_t symbol;
+  /**
+   * Kernel object handle, as HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_OBJECT.
+   */
+  uint64_t kernel_object;
+  /**
+   * Kernarg segment size in bytes.
+   */
+  uint32_t kernarg_segment_size;
+  /**
+   * Kernarg segment alignment in bytes.
+   */
+  uint32_t kernarg_segment_alignment;
+  /**
+   * Statically allocated group segment size in bytes.
+   */
+  uint32_t group_segment_size;
+  /**
+   * Statically allocated private segment size in bytes per work-item.
+   */
+  uint32_t private_segment_size;
+  /**
+   * Wavefront size the kernel was compiled for.
+   */
+  uint32_t wavefront_size;
+  /**
+   * Non-zero if the kernel uses a dynamically sized call stack.
+   */
+  uint8_t is_dynamic_callstack;
+  uint8_t reserved[3];
+} hsa_amd_kernel_dispatch_info_t;
+
+/**
+ * @brief Retrieve the dispatch parameters of every kernel in an executable.
+ *
+ * @details Fills @p kernels with one entry per kernel symbol, in load order,
+ * so that launchers can gather all dispatch parameters with a single call
+ * instead of one ::hsa_executable_symbol_get_info call per attribute.  Call
+ * with @p kernels NULL to query the number of entries.
+ *
+ * @param[in] executable Executable.
+ *
+ * @param[in,out] num_kernels On input, the number of entries @p kernels can
+ * hold.  On output, the number of kernels in @p executable.  At most the input
+ * value of entries is written.
+ *
+ * @param[out] kernels Array receiving the entries.  May be NULL.
+ *
+ * @retval ::HSA_STATUS_SUCCESS The function has been executed successfully.
+ *
+ * @retval ::HSA_STATUS_ERROR_NOT_INITIALIZED The HSA runtime has not been
+ * initialized.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_EXECUTABLE The executable is invalid.
+ *
+ * @retval ::HSA_STATUS_ERROR_INVALID_ARGUMENT @p num_kernels is NULL.
+ */
+hsa_status_t HSA_API hsa_amd_executable_get_kernel_dispatch_info(
+    hsa_executable_t executable, uint32_t* num_kernels,
+    hsa_amd_kernel_dispatch_info_t* kernels);
+
 #ifdef __cplusplus
 }  // end extern "C" block
 #endif
@@ -1702,31 +1702,145 @@ namespace code {
       return false;
     }
 
+      static uint64_t ContentHash(const void* buffer, size_t size)
+      {
+        // FNV-1a; equal hashes are confirmed with memcmp before sharing.
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer);
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; ++i) {
+          hash = (hash ^ p[i]) * 1099511628211ULL;
+        }
+        return hash;
+      }
+
+      // Requires lock to be held.
+      AmdHsaCodeManager::Entry* AmdHsaCodeManager::FindContent(uint64_t hash, const void* buffer, size_t size)
+      {
+        auto range = contentMap.equal_range(hash);
+        for (auto i = range.first; i != range.second; ++i) {
+          Entry* entry = i->second.get();
+          if (entry->size == size && memcmp(entry->image.get(), buffer, size) == 0) {
+            return entry;
+          }
+        }
+        return nullptr;
+      }
+
+      AmdHsaCodeManager::Entry* AmdHsaCodeManager::Parse(const void* buffer)
+      {
+        size_t size = amd::elf::ElfSize(buffer);
+        if (size == 0) { return nullptr; }
+        uint64_t hash = ContentHash(buffer, size);
+
+        {
+          std::lock_guard<std::mutex> l(lock);
+          Entry* entry = FindContent(hash, buffer, size);
+          if (entry) {
+            entry->refs++;
+            return entry;
+          }
+        }
+
+        // Parse outside the registry lock so unrelated handles proceed.
+        std::unique_ptr<Entry> entry(new Entry());
+        entry->hash = hash;
+        entry->size = size;
+        entry->image.reset(new char[size]);
+        memcpy(entry->image.get(), buffer, size);
+        entry->code.reset(new AmdHsaCode());
+        if (!entry->code->InitAsBuffer(entry->image.get(), size)) {
+          return nullptr;
+        }
+
+        std::lock_guard<std::mutex> l(lock);
+        // Another handle with the same contents may have finished first.
+        Entry* existing = FindContent(hash, buffer, size);
+        if (existing) {
+          existing->refs++;
+          return existing;
+        }
+        entry->refs = 1;
+        Entry* result = entry.get();
+        contentMap.emplace(hash, std::move(entry));
+        return result;
+      }
+
+      // Requires lock to be held.
+      void AmdHsaCodeManager::Release(Entry* entry)
+      {
+        assert(entry->refs > 0);
+        if (--entry->refs != 0) { return; }
+        auto range = contentMap.equal_range(entry->hash);
+        for (auto i = range.first; i != range.second; ++i) {
+          if (i->second.get() == entry) {
+            contentMap.erase(i);
+            return;
+          }
+        }
+        assert(false && "Code object entry missing from content map.");
+      }
+
       AmdHsaCode* AmdHsaCodeManager::FromHandle(hsa_code_object_t c)
       {
-        CodeMap::iterator i = codeMap.find(c.handle);
-        if (i == codeMap.end()) {
-          AmdHsaCode* code = new AmdHsaCode();
-          const void* buffer = reinterpret_cast<const void*>(c.handle);
-          if (!code->InitAsBuffer(buffer, 0)) {
-            delete code;
-            return 0;
+        using namespace amd::hsa::common;
+        std::shared_ptr<Slot> slot;
+        {
+          ReaderLockGuard<ReaderWriterLock> reader(handleLock);
+          HandleMap::iterator i = handleMap.find(c.handle);
+          if (i != handleMap.end()) {
+            Entry* entry = i->second->entry.load(std::memory_order_acquire);
+            if (entry) { return entry->code.get(); }
+            slot = i->second;
           }
-          codeMap[c.handle] = code;
-          return code;
         }
-        return i->second;
+        if (!slot) {
+          WriterLockGuard<ReaderWriterLock> writer(handleLock);
+          std::shared_ptr<Slot>& s = handleMap[c.handle];
+          if (!s) { s.reset(new Slot()); }
+          slot = s;
+        }
+
+        std::lock_guard<std::mutex> parse(slot->parseLock);
+        if (slot->destroyed) { return nullptr; }
+        Entry* entry = slot->entry.load(std::memory_order_relaxed);
+        if (!entry) {
+          entry = Parse(reinterpret_cast<const void*>(c.handle));
+          if (!entry) {
+            // Keep no slot for a handle that does not parse; a later lookup
+            // starts over.
+            slot->destroyed = true;
+            WriterLockGuard<ReaderWriterLock> writer(handleLock);
+            HandleMap::iterator i = handleMap.find(c.handle);
+            if (i != handleMap.end() && i->second == slot) { handleMap.erase(i); }
+            return nullptr;
+          }
+          slot->entry.store(entry, std::memory_order_release);
+        }
+        return entry->code.get();
       }
 
       bool AmdHsaCodeManager::Destroy(hsa_code_object_t c)
       {
-        CodeMap::iterator i = codeMap.find(c.handle);
-        if (i == codeMap.end()) {
-          // Currently, we do not always create map entry for every code object buffer.
-          return true;
+        std::shared_ptr<Slot> slot;
+        {
+          amd::hsa::common::WriterLockGuard<amd::hsa::common::ReaderWriterLock> writer(handleLock);
+          HandleMap::iterator i = handleMap.find(c.handle);
+          if (i == handleMap.end()) {
+            // Currently, we do not always create map entry for every code object buffer.
+            return true;
+          }
+          slot = i->second;
+          handleMap.erase(i);
+        }
+
+        // Wait out any parse in flight so its reference is not leaked.
+        std::lock_guard<std::mutex> parse(slot->parseLock);
+        slot->destroyed = true;
+        Entry* entry = slot->entry.exchange(nullptr, std::memory_order_relaxed);
+        if (entry) {
+          std::lock_guard<std::mutex> l(lock);
+          Release(entry);
         }
-        delete i->second;
-        codeMap.erase(i);
         return true;
       }
 
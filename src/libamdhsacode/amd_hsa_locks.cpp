@@ -47,47 +47,85 @@ namespace amd {
 namespace hsa {
 namespace common {
 
+static std::atomic<size_t> next_reader_slot(0);
+
+size_t ReaderWriterLock::ReaderSlotIndex()
+{
+  static thread_local size_t index = size_t(-1);
+  if (index == size_t(-1)) {
+    index = next_reader_slot.fetch_add(1, std::memory_order_relaxed) % kReaderSlots;
+  }
+  return index;
+}
+
+intptr_t ReaderWriterLock::ReadersCount() const
+{
+  // Unlock may run on another thread than lock, only the sum is meaningful.
+  intptr_t count = 0;
+  for (size_t i = 0; i < kReaderSlots; ++i) {
+    count += readers_[i].count.load(std::memory_order_seq_cst);
+  }
+  return count;
+}
+
+void ReaderWriterLock::NotifyWriters()
+{
+  if (0 < writers_waiting_.load(std::memory_order_seq_cst)) {
+    std::lock_guard<std::mutex> lock(internal_lock_);
+    writers_condition_.notify_all();
+  }
+}
+
 void ReaderWriterLock::ReaderLock()
 {
-  internal_lock_.lock();
-  while (0 < writers_count_) {
-    readers_condition_.wait(internal_lock_);
+  std::atomic<intptr_t> &count = readers_[ReaderSlotIndex()].count;
+  while (true) {
+    count.fetch_add(1, std::memory_order_seq_cst);
+    if (0 == writer_.load(std::memory_order_seq_cst)) {
+      return;
+    }
+
+    // A writer holds or is acquiring the lock, back off until it is done.
+    count.fetch_sub(1, std::memory_order_seq_cst);
+    NotifyWriters();
+    std::unique_lock<std::mutex> lock(internal_lock_);
+    while (0 < writer_.load(std::memory_order_relaxed)) {
+      readers_condition_.wait(lock);
+    }
   }
-  readers_count_ += 1;
-  internal_lock_.unlock();
 }
 
 void ReaderWriterLock::ReaderUnlock()
 {
-  internal_lock_.lock();
-  readers_count_ -= 1;
-  if (0 == readers_count_ && 0 < writers_waiting_) {
-    writers_condition_.notify_one();
-  }
-  internal_lock_.unlock();
+  readers_[ReaderSlotIndex()].count.fetch_sub(1, std::memory_order_seq_cst);
+  NotifyWriters();
 }
 
 void ReaderWriterLock::WriterLock()
 {
-  internal_lock_.lock();
-  writers_waiting_ += 1;
-  while (0 < readers_count_ || 0 < writers_count_) {
-    writers_condition_.wait(internal_lock_);
+  std::unique_lock<std::mutex> lock(internal_lock_);
+  writers_waiting_.fetch_add(1, std::memory_order_seq_cst);
+  while (true) {
+    if (0 == writer_.load(std::memory_order_relaxed)) {
+      writer_.store(1, std::memory_order_seq_cst);
+      if (0 == ReadersCount()) {
+        break;
+      }
+      // Readers are present, withdraw so that they may nest read locks.
+      writer_.store(0, std::memory_order_seq_cst);
+      readers_condition_.notify_all();
+    }
+    writers_condition_.wait(lock);
   }
-  writers_count_ += 1;
-  writers_waiting_ -= 1;
-  internal_lock_.unlock();
+  writers_waiting_.fetch_sub(1, std::memory_order_seq_cst);
 }
 
 void ReaderWriterLock::WriterUnlock()
 {
-  internal_lock_.lock();
-  writers_count_ -= 1;
-  if (0 < writers_waiting_) {
-    writers_condition_.notify_one();
-  }
+  std::lock_guard<std::mutex> lock(internal_lock_);
+  writer_.store(0, std::memory_order_seq_cst);
+  writers_condition_.notify_all();
   readers_condition_.notify_all();
-  internal_lock_.unlock();
 }
 
 } // namespace common
@@ -43,9 +43,12 @@
 #ifndef AMD_HSA_LOCKS_HPP
 #define AMD_HSA_LOCKS_HPP
 
+#include <atomic>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <new>
 
 namespace rocr {
 namespace amd {
@@ -94,10 +97,28 @@ private:
   LockType &lock_;
 };
 
+/// @brief Reader biased reader/writer lock.
+///
+/// Readers count themselves in one of several cache line aligned slots picked
+/// per thread, so uncontended read locking writes no cache line other threads
+/// write.  A writer publishes itself through writer_ and then checks that all
+/// slots sum to zero.  If readers are present it withdraws and waits for a
+/// reader to leave, so a thread holding a read lock may take it again while a
+/// writer is waiting.
 class ReaderWriterLock final {
 public:
   ReaderWriterLock():
-    readers_count_(0), writers_count_(0), writers_waiting_(0) {}
+    writer_(0), writers_waiting_(0)
+  {
+    // The lock may be embedded at any offset, so align the slots by hand.
+    uintptr_t storage = reinterpret_cast<uintptr_t>(readers_storage_);
+    readers_ = reinterpret_cast<ReaderSlot*>(
+      (storage + kCacheLineSize - 1) & ~uintptr_t(kCacheLineSize - 1));
+    for (size_t i = 0; i < kReaderSlots; ++i) {
+      new (&readers_[i]) ReaderSlot();
+      readers_[i].count.store(0, std::memory_order_relaxed);
+    }
+  }
 
   ~ReaderWriterLock() {}
 
@@ -113,9 +134,30 @@ private:
   ReaderWriterLock(const ReaderWriterLock&);
   ReaderWriterLock& operator=(const ReaderWriterLock&);
 
-  size_t readers_count_;
-  size_t writers_count_;
-  size_t writers_waiting_;
+  static const size_t kReaderSlots = 64;
+  static const size_t kCacheLineSize = 64;
+
+  struct ReaderSlot {
+    std::atomic<intptr_t> count;
+    char pad[kCacheLineSize - sizeof(std::atomic<intptr_t>)];
+  };
+  static_assert(sizeof(ReaderSlot) == kCacheLineSize, "Reader slots must fill a cache line.");
+
+  /// @brief Returns the calling thread's slot.
+  static size_t ReaderSlotIndex();
+
+  /// @brief Number of readers currently holding the lock.
+  intptr_t ReadersCount() const;
+
+  /// @brief Wakes a writer waiting for readers to leave.
+  void NotifyWriters();
+
+  /// @brief Slot storage, one line larger than needed so that readers_ can
+  /// start on a cache line boundary.
+  char readers_storage_[(kReaderSlots + 1) * kCacheLineSize];
+  ReaderSlot *readers_;
+  std::atomic<uint32_t> writer_;
+  std::atomic<uint32_t> writers_waiting_;
   std::mutex internal_lock_;
   std::condition_variable_any readers_condition_;
   std::condition_variable_any writers_condition_;
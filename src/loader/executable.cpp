@@ -54,6 +54,7 @@
 #include <iostream>
 #include <atomic>
 #include <fstream>
+#include <functional>
 #include "inc/amd_hsa_elf.h"
 #include "inc/amd_hsa_kernel_code.h"
 #include "core/inc/amd_hsa_code.hpp"
@@ -698,6 +699,73 @@ void Segment::Copy(uint64_t addr, const void* src, size_t size)
   }
 }
 
+void RelocationBatch::Resolve(uint32_t index, uint64_t address)
+{
+  if (index >= resolved_.size()) {
+    addresses_.resize(index + 1, 0);
+    resolved_.resize(index + 1, 0);
+  }
+  addresses_[index] = address;
+  resolved_[index] = 1;
+}
+
+void RelocationBatch::Write(Segment *seg, uint64_t vaddr, const void *src, size_t size)
+{
+  assert(seg && size <= sizeof(uint64_t));
+  PendingWrite write;
+  write.seg = seg;
+  write.vaddr = vaddr;
+  write.value = 0;
+  memcpy(&write.value, src, size);
+  write.size = uint32_t(size);
+  write.order = uint32_t(writes_.size());
+  writes_.push_back(write);
+}
+
+void RelocationBatch::Flush()
+{
+  std::less<Segment*> seg_less;
+  std::sort(writes_.begin(), writes_.end(),
+            [&](const PendingWrite &lhs, const PendingWrite &rhs) {
+              if (lhs.seg != rhs.seg) { return seg_less(lhs.seg, rhs.seg); }
+              if (lhs.vaddr != rhs.vaddr) { return lhs.vaddr < rhs.vaddr; }
+              return lhs.order < rhs.order;
+            });
+
+  std::vector<char> buffer;
+  size_t i = 0;
+  while (i < writes_.size()) {
+    const uint64_t start = writes_[i].vaddr;
+    uint64_t end = start + writes_[i].size;
+    bool overlap = false;
+    size_t j = i + 1;
+    while (j < writes_.size() && writes_[j].seg == writes_[i].seg && writes_[j].vaddr <= end) {
+      overlap |= writes_[j].vaddr < end;
+      end = std::max(end, writes_[j].vaddr + writes_[j].size);
+      ++j;
+    }
+
+    if (j == i + 1) {
+      writes_[i].seg->Copy(start, &writes_[i].value, writes_[i].size);
+    } else {
+      // Overlapping writes are applied in relocation order so the last one wins.
+      if (overlap) {
+        std::sort(writes_.begin() + i, writes_.begin() + j,
+                  [](const PendingWrite &lhs, const PendingWrite &rhs) {
+                    return lhs.order < rhs.order;
+                  });
+      }
+      buffer.resize(end - start);
+      for (size_t k = i; k < j; ++k) {
+        memcpy(&buffer[writes_[k].vaddr - start], &writes_[k].value, writes_[k].size);
+      }
+      writes_[i].seg->Copy(start, buffer.data(), buffer.size());
+    }
+    i = j;
+  }
+  writes_.clear();
+}
+
 void Segment::Print(std::ostream& out)
 {
   out << "Segment" << std::endl
@@ -990,6 +1058,20 @@ size_t ExecutableImpl::QuerySegmentDescriptors(
   return i - first_empty_segment_descriptor;
 }
 
+void ExecutableImpl::GetKernelDispatchInfo(
+  uint32_t *num_kernels, hsa_amd_kernel_dispatch_info_t *kernels)
+{
+  ReaderLockGuard<ReaderWriterLock> reader_lock(rw_lock_);
+  assert(num_kernels);
+
+  uint32_t total = uint32_t(kernel_table_.size());
+  if (kernels && *num_kernels) {
+    uint32_t count = std::min(*num_kernels, total);
+    memcpy(kernels, kernel_table_.data(), count * sizeof(*kernels));
+  }
+  *num_kernels = total;
+}
+
 hsa_agent_t LoadedCodeObjectImpl::getAgent() const {
   assert(loaded_segments.size() == 1 && "Only supports code objects v2+");
   return loaded_segments.front()->Agent();
@@ -1261,6 +1343,7 @@ hsa_status_t ExecutableImpl::LoadCodeObject(
 
   status = LoadSegments(agent, code.get(), majorVersion);
   if (status != HSA_STATUS_SUCCESS) return status;
+  BuildSegmentIndex();
 
   for (size_t i = 0; i < code->SymbolCount(); ++i) {
     if (majorVersion >= 2 &&
@@ -1396,6 +1479,14 @@ bool string_ends_with(const std::string &str, const std::string &suf) {
   return str.size() >= suf.size() ? str.compare(str.size() - suf.size(), suf.size(), suf) == 0 : false;
 }
 
+// V3+ kernel descriptors are "<kernel>.kd" objects of exactly the descriptor
+// size; the cheap checks run first so other symbols skip the name lookup.
+bool IsKernelDescriptor(code::Symbol* sym, uint32_t majorVersion) {
+  return majorVersion >= 3 &&
+         sym->Size() == sizeof(llvm::amdhsa::kernel_descriptor_t) &&
+         string_ends_with(sym->Name(), ".kd");
+}
+
 }
 
 hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
@@ -1422,7 +1513,7 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
 
   uint64_t address = SymbolAddress(agent, sym);
   SymbolImpl *symbol = nullptr;
-  if (string_ends_with(sym->GetSymbolName(), ".kd")) {
+  if (IsKernelDescriptor(sym, majorVersion)) {
     // V3.
     llvm::amdhsa::kernel_descriptor_t kd;
     sym->GetSection()->getData(sym->SectionOffset(), &kd, sizeof(kd));
@@ -1431,7 +1522,12 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
     uint32_t kernarg_segment_alignment = 16;         // FIXME: Use the minumum HSA required alignment.
     uint32_t group_segment_size = kd.group_segment_fixed_size;
     uint32_t private_segment_size = kd.private_segment_fixed_size;
-    bool is_dynamic_callstack = false;
+    bool is_dynamic_callstack =
+      AMDHSA_BITS_GET(kd.kernel_code_properties,
+                      llvm::amdhsa::KERNEL_CODE_PROPERTY_USES_DYNAMIC_STACK) ? true : false;
+    uint32_t wavefront_size =
+      AMDHSA_BITS_GET(kd.kernel_code_properties,
+                      llvm::amdhsa::KERNEL_CODE_PROPERTY_ENABLE_WAVEFRONT_SIZE32) ? 32 : 64;
 
     uint64_t size = sym->Size();
 
@@ -1447,6 +1543,7 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
                                     is_dynamic_callstack,
                                     size,
                                     64,
+                                    wavefront_size,
                                     address);
     symbol = kernel_symbol;
   } else if (sym->IsVariableSymbol()) {
@@ -1476,6 +1573,8 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
         uint32_t(akc.workitem_private_segment_byte_size);
       bool is_dynamic_callstack =
         AMD_HSA_BITS_GET(akc.kernel_code_properties, AMD_KERNEL_CODE_PROPERTIES_IS_DYNAMIC_CALLSTACK) ? true : false;
+      uint32_t wavefront_size =
+        uint32_t(1 << akc.wavefront_size);
 
       uint64_t size = sym->Size();
 
@@ -1496,6 +1595,7 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
                                       is_dynamic_callstack,
                                       size,
                                       256,
+                                      wavefront_size,
                                       address);
       kernel_symbol->debug_info.elf_raw = code->ElfData();
       kernel_symbol->debug_info.elf_size = code->ElfSize();
@@ -1520,6 +1620,21 @@ hsa_status_t ExecutableImpl::LoadDefinitionSymbol(hsa_agent_t agent,
   } else {
     program_symbols_.insert(std::make_pair(sym->Name(), symbol));
   }
+
+  if (symbol->IsKernel()) {
+    KernelSymbol *kernel_symbol = static_cast<KernelSymbol*>(symbol);
+    hsa_amd_kernel_dispatch_info_t info = {};
+    info.agent = symbol->agent;
+    info.symbol = Symbol::Handle(symbol);
+    info.kernel_object = kernel_symbol->address;
+    info.kernarg_segment_size = kernel_symbol->kernarg_segment_size;
+    info.kernarg_segment_alignment = kernel_symbol->kernarg_segment_alignment;
+    info.group_segment_size = kernel_symbol->group_segment_size;
+    info.private_segment_size = kernel_symbol->private_segment_size;
+    info.wavefront_size = kernel_symbol->wavefront_size;
+    info.is_dynamic_callstack = kernel_symbol->is_dynamic_callstack ? 1 : 0;
+    kernel_table_.push_back(info);
+  }
   return HSA_STATUS_SUCCESS;
 }
 
@@ -1540,14 +1655,27 @@ hsa_status_t ExecutableImpl::LoadDeclarationSymbol(hsa_agent_t agent,
   return HSA_STATUS_SUCCESS;
 }
 
+void ExecutableImpl::BuildSegmentIndex()
+{
+  segment_index_ = loaded_code_objects.back()->LoadedSegments();
+  std::stable_sort(segment_index_.begin(), segment_index_.end(),
+                   [](const Segment *lhs, const Segment *rhs) {
+                     return lhs->VAddr() < rhs->VAddr();
+                   });
+}
+
 Segment* ExecutableImpl::VirtualAddressSegment(uint64_t vaddr)
 {
-  for (auto &seg : loaded_code_objects.back()->LoadedSegments()) {
-    if (seg->IsAddressInSegment(vaddr)) {
-      return seg;
-    }
+  // Last segment starting at or below vaddr.
+  auto it = std::upper_bound(segment_index_.begin(), segment_index_.end(), vaddr,
+                             [](uint64_t addr, const Segment *seg) {
+                               return addr < seg->VAddr();
+                             });
+  if (it == segment_index_.begin()) {
+    return 0;
   }
-  return 0;
+  --it;
+  return (*it)->IsAddressInSegment(vaddr) ? *it : 0;
 }
 
 uint64_t ExecutableImpl::SymbolAddress(hsa_agent_t agent, code::Symbol* sym)
@@ -1572,12 +1700,7 @@ Segment* ExecutableImpl::SymbolSegment(hsa_agent_t agent, code::Symbol* sym)
 
 Segment* ExecutableImpl::SectionSegment(hsa_agent_t agent, code::Section* sec)
 {
-  for (Segment* seg : loaded_code_objects.back()->LoadedSegments()) {
-    if (seg->IsAddressInSegment(sec->addr())) {
-      return seg;
-    }
-  }
-  return 0;
+  return VirtualAddressSegment(sec->addr());
 }
 
 hsa_status_t ExecutableImpl::ApplyRelocations(hsa_agent_t agent, amd::hsa::code::AmdHsaCode *c)
@@ -1609,21 +1732,26 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocationSection(hsa_agent_t agent, amd
 {
   // Skip link-time relocations (if any).
   if (!(sec->targetSection()->flags() & SHF_ALLOC)) { return HSA_STATUS_SUCCESS; }
+  // All relocations of the section patch the same target segment.
+  Segment* rseg = SectionSegment(agent, sec->targetSection());
+  if (!rseg) { return HSA_STATUS_ERROR_INVALID_CODE_OBJECT; }
+  RelocationBatch batch;
   hsa_status_t status = HSA_STATUS_SUCCESS;
   for (size_t i = 0; i < sec->relocationCount(); ++i) {
-    status = ApplyStaticRelocation(agent, sec->relocation(i));
+    status = ApplyStaticRelocation(agent, sec->relocation(i), rseg, batch);
     if (status != HSA_STATUS_SUCCESS) { return status; }
   }
+  batch.Flush();
   return HSA_STATUS_SUCCESS;
 }
 
-hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel)
+hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel,
+                                                   Segment *rseg, RelocationBatch &batch)
 {
   hsa_status_t status = HSA_STATUS_SUCCESS;
   amd::elf::Symbol* sym = rel->symbol();
   code::RelocationSection* rsec = rel->section();
   code::Section* sec = rsec->targetSection();
-  Segment* rseg = SectionSegment(agent, sec);
   size_t reladdr = sec->addr() + rel->offset();
   switch (rel->type()) {
     case R_AMDGPU_32_LOW:
@@ -1631,29 +1759,32 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::
     case R_AMDGPU_64:
     {
       uint64_t addr;
-      switch (sym->type()) {
-        case STT_OBJECT:
-        case STT_SECTION:
-        case STT_AMDGPU_HSA_KERNEL:
-        case STT_AMDGPU_HSA_INDIRECT_FUNCTION:
-          addr = SymbolAddress(agent, sym);
-          if (!addr) { return HSA_STATUS_ERROR_INVALID_CODE_OBJECT; }
-          break;
-        case STT_COMMON: {
-          hsa_agent_t *sagent = &agent;
-          if (STA_AMDGPU_HSA_GLOBAL_PROGRAM == ELF64_ST_AMDGPU_ALLOCATION(sym->other())) {
-            sagent = nullptr;
-          }
-          SymbolImpl* esym = (SymbolImpl*) GetSymbolInternal(sym->name().c_str(), sagent);
-          if (!esym) {
-            logger_ << "LoaderError: symbol \"" << sym->name() << "\" is undefined\n";
-            return HSA_STATUS_ERROR_VARIABLE_UNDEFINED;
+      if (!batch.Lookup(rel->symbolIndex(), &addr)) {
+        switch (sym->type()) {
+          case STT_OBJECT:
+          case STT_SECTION:
+          case STT_AMDGPU_HSA_KERNEL:
+          case STT_AMDGPU_HSA_INDIRECT_FUNCTION:
+            addr = SymbolAddress(agent, sym);
+            if (!addr) { return HSA_STATUS_ERROR_INVALID_CODE_OBJECT; }
+            break;
+          case STT_COMMON: {
+            hsa_agent_t *sagent = &agent;
+            if (STA_AMDGPU_HSA_GLOBAL_PROGRAM == ELF64_ST_AMDGPU_ALLOCATION(sym->other())) {
+              sagent = nullptr;
+            }
+            SymbolImpl* esym = (SymbolImpl*) GetSymbolInternal(sym->name().c_str(), sagent);
+            if (!esym) {
+              logger_ << "LoaderError: symbol \"" << sym->name() << "\" is undefined\n";
+              return HSA_STATUS_ERROR_VARIABLE_UNDEFINED;
+            }
+            addr = esym->address;
+            break;
           }
-          addr = esym->address;
-          break;
+          default:
+            return HSA_STATUS_ERROR_INVALID_CODE_OBJECT;
         }
-        default:
-          return HSA_STATUS_ERROR_INVALID_CODE_OBJECT;
+        batch.Resolve(rel->symbolIndex(), addr);
       }
       addr += rel->addend();
 
@@ -1661,14 +1792,14 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::
       switch (rel->type()) {
         case R_AMDGPU_32_HIGH:
           addr32 = uint32_t((addr >> 32) & 0xFFFFFFFF);
-          rseg->Copy(reladdr, &addr32, sizeof(addr32));
+          batch.Write(rseg, reladdr, &addr32, sizeof(addr32));
           break;
         case R_AMDGPU_32_LOW:
           addr32 = uint32_t(addr & 0xFFFFFFFF);
-          rseg->Copy(reladdr, &addr32, sizeof(addr32));
+          batch.Write(rseg, reladdr, &addr32, sizeof(addr32));
           break;
         case R_AMDGPU_64:
-          rseg->Copy(reladdr, &addr, sizeof(addr));
+          batch.Write(rseg, reladdr, &addr, sizeof(addr));
           break;
         default:
           return HSA_STATUS_ERROR_INVALID_CODE_OBJECT;
@@ -1703,7 +1834,7 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::
       status = context_->SamplerCreate(agent, &hsa_sampler_descriptor, &hsa_sampler);
       if (status != HSA_STATUS_SUCCESS) { return status; }
       assert(hsa_sampler.handle);
-      rseg->Copy(reladdr, &hsa_sampler, sizeof(hsa_sampler));
+      batch.Write(rseg, reladdr, &hsa_sampler, sizeof(hsa_sampler));
       break;
     }
 
@@ -1766,7 +1897,7 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::
                                   NULL, // TODO: image_data?
                                   &hsa_image);
       if (status != HSA_STATUS_SUCCESS) { return status; }
-      rseg->Copy(reladdr, &hsa_image, sizeof(hsa_image));
+      batch.Write(rseg, reladdr, &hsa_image, sizeof(hsa_image));
       break;
     }
 
@@ -1779,43 +1910,60 @@ hsa_status_t ExecutableImpl::ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::
 
 hsa_status_t ExecutableImpl::ApplyDynamicRelocationSection(hsa_agent_t agent, amd::hsa::code::RelocationSection* sec)
 {
+  RelocationBatch batch;
   hsa_status_t status = HSA_STATUS_SUCCESS;
   for (size_t i = 0; i < sec->relocationCount(); ++i) {
-    status = ApplyDynamicRelocation(agent, sec->relocation(i));
+    status = ApplyDynamicRelocation(agent, sec->relocation(i), batch);
     if (status != HSA_STATUS_SUCCESS) { return status; }
   }
+  batch.Flush();
   return HSA_STATUS_SUCCESS;
 }
 
-hsa_status_t ExecutableImpl::ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel)
+hsa_status_t ExecutableImpl::ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel,
+                                                    RelocationBatch &batch)
 {
   Segment* relSeg = VirtualAddressSegment(rel->offset());
+  if (!relSeg) { return HSA_STATUS_ERROR_INVALID_CODE_OBJECT; }
+
+  // RELATIVE64 does not reference a symbol.
+  if (rel->type() == R_AMDGPU_RELATIVE64) {
+    int64_t baseDelta = reinterpret_cast<uint64_t>(relSeg->Address(0)) - relSeg->VAddr();
+    uint64_t relocatedAddr = baseDelta + rel->addend();
+    batch.Write(relSeg, rel->offset(), &relocatedAddr, sizeof(relocatedAddr));
+    return HSA_STATUS_SUCCESS;
+  }
+
   uint64_t symAddr = 0;
-  switch (rel->symbol()->type()) {
-    case STT_OBJECT:
-    case STT_AMDGPU_HSA_KERNEL:
-    case STT_FUNC:
-    {
-      Segment* symSeg = VirtualAddressSegment(rel->symbol()->value());
-      symAddr = reinterpret_cast<uint64_t>(symSeg->Address(rel->symbol()->value()));
-      break;
-    }
+  if (!batch.Lookup(rel->symbolIndex(), &symAddr)) {
+    switch (rel->symbol()->type()) {
+      case STT_OBJECT:
+      case STT_AMDGPU_HSA_KERNEL:
+      case STT_FUNC:
+      {
+        Segment* symSeg = VirtualAddressSegment(rel->symbol()->value());
+        if (!symSeg) { return HSA_STATUS_ERROR_INVALID_CODE_OBJECT; }
+        symAddr = reinterpret_cast<uint64_t>(symSeg->Address(rel->symbol()->value()));
+        break;
+      }
 
-    // External symbols, they must be defined prior loading.
-    case STT_NOTYPE:
-    {
-      // TODO: Only agent allocation variables are supported in v2.1. How will
-      // we distinguish between program allocation and agent allocation
-      // variables?
-      auto agent_symbol = agent_symbols_.find(std::make_pair(rel->symbol()->name(), agent));
-      if (agent_symbol != agent_symbols_.end())
-        symAddr = agent_symbol->second->address;
-      break;
-    }
+      // External symbols, they must be defined prior loading.
+      case STT_NOTYPE:
+      {
+        // TODO: Only agent allocation variables are supported in v2.1. How will
+        // we distinguish between program allocation and agent allocation
+        // variables?
+        auto agent_symbol = agent_symbols_.find(std::make_pair(rel->symbol()->name(), agent));
+        if (agent_symbol != agent_symbols_.end())
+          symAddr = agent_symbol->second->address;
+        break;
+      }
 
-    default:
-      // Only objects and kernels are supported in v2.1.
-      return HSA_STATUS_ERROR_INVALID_CODE_OBJECT;
+      default:
+        // Only objects and kernels are supported in v2.1.
+        return HSA_STATUS_ERROR_INVALID_CODE_OBJECT;
+    }
+    batch.Resolve(rel->symbolIndex(), symAddr);
   }
   symAddr += rel->addend();
 
@@ -1828,7 +1976,7 @@ hsa_status_t ExecutableImpl::ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa:
       }
 
       uint32_t symAddr32 = uint32_t((symAddr >> 32) & 0xFFFFFFFF);
-      relSeg->Copy(rel->offset(), &symAddr32, sizeof(symAddr32));
+      batch.Write(relSeg, rel->offset(), &symAddr32, sizeof(symAddr32));
       break;
     }
 
@@ -1840,7 +1988,7 @@ hsa_status_t ExecutableImpl::ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa:
       }
 
       uint32_t symAddr32 = uint32_t(symAddr & 0xFFFFFFFF);
-      relSeg->Copy(rel->offset(), &symAddr32, sizeof(symAddr32));
+      batch.Write(relSeg, rel->offset(), &symAddr32, sizeof(symAddr32));
       break;
     }
 
@@ -1851,15 +1999,7 @@ hsa_status_t ExecutableImpl::ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa:
         return HSA_STATUS_ERROR_VARIABLE_UNDEFINED;
       }
 
-      relSeg->Copy(rel->offset(), &symAddr, sizeof(symAddr));
-      break;
-    }
-
-    case R_AMDGPU_RELATIVE64:
-    {
-      int64_t baseDelta = reinterpret_cast<uint64_t>(relSeg->Address(0)) - relSeg->VAddr();
-      uint64_t relocatedAddr = baseDelta + rel->addend();
-      relSeg->Copy(rel->offset(), &relocatedAddr, sizeof(relocatedAddr));
+      batch.Write(relSeg, rel->offset(), &symAddr, sizeof(symAddr));
       break;
     }
 
@@ -1875,10 +2015,27 @@ hsa_status_t ExecutableImpl::Freeze(const char *options) {
     return HSA_STATUS_ERROR_FROZEN_EXECUTABLE;
   }
 
+  // Hand all segments to the context at once so their uploads can overlap.
+  std::vector<Context::SegmentFreezeRequest> requests;
+  std::vector<Segment*> segments;
   for (auto &lco : loaded_code_objects) {
     for (auto &ls : lco->LoadedSegments()) {
-      ls->Freeze();
-    }
+      if (ls->IsFrozen()) { continue; }
+      Context::SegmentFreezeRequest request;
+      request.segment = ls->ElfSegment();
+      request.agent = ls->Agent();
+      request.seg = ls->Ptr();
+      request.size = ls->Size();
+      request.frozen = false;
+      requests.push_back(request);
+      segments.push_back(ls);
+    }
+  }
+  if (!requests.empty()) {
+    context_->SegmentsFreeze(requests.data(), requests.size());
+  }
+  for (size_t i = 0; i < segments.size(); ++i) {
+    segments[i]->SetFrozen(requests[i].frozen);
   }
 
   state_ = HSA_EXECUTABLE_STATE_FROZEN;
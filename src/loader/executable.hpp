@@ -144,6 +144,7 @@ public:
                const bool &_is_dynamic_callstack,
                const uint32_t &_size,
                const uint32_t &_alignment,
+               const uint32_t &_wavefront_size,
                const uint64_t &_address = 0)
     : SymbolImpl(_is_loaded,
                  HSA_SYMBOL_KIND_KERNEL,
@@ -159,7 +160,8 @@ public:
     , private_segment_size(_private_segment_size)
     , is_dynamic_callstack(_is_dynamic_callstack)
     , size(_size)
-    , alignment(_alignment) {}
+    , alignment(_alignment)
+    , wavefront_size(_wavefront_size) {}
 
   ~KernelSymbol() {}
 
@@ -173,6 +175,7 @@ public:
   bool is_dynamic_callstack;
   uint32_t size;
   uint32_t alignment;
+  uint32_t wavefront_size;
   amd_runtime_loader_debug_info_t debug_info;
 
 private:
@@ -358,12 +361,54 @@ public:
 
   bool Freeze();
 
+  bool IsFrozen() const { return frozen; }
+  void SetFrozen(bool frozen_) { frozen = frozen_; }
+
   bool IsAddressInSegment(uint64_t addr);
   void Copy(uint64_t addr, const void* src, size_t size);
   void Print(std::ostream& out) override;
   void Destroy() override;
 };
 
+/// @brief State shared by the relocations of one relocation section.
+///
+/// Symbol addresses are resolved once per ELF symbol index and kept in a dense
+/// array.  Writes are recorded and copied into their segments by Flush, with
+/// adjacent writes to the same segment coalesced into a single copy.
+class RelocationBatch final {
+public:
+  RelocationBatch() {}
+
+  /// @brief Returns true and sets @p address if symbol @p index was resolved.
+  bool Lookup(uint32_t index, uint64_t *address) const {
+    if (index >= resolved_.size() || !resolved_[index]) { return false; }
+    *address = addresses_[index];
+    return true;
+  }
+
+  void Resolve(uint32_t index, uint64_t address);
+
+  void Write(Segment *seg, uint64_t vaddr, const void *src, size_t size);
+
+  void Flush();
+
+private:
+  RelocationBatch(const RelocationBatch&);
+  RelocationBatch& operator=(const RelocationBatch&);
+
+  struct PendingWrite {
+    Segment *seg;
+    uint64_t vaddr;
+    uint64_t value;
+    uint32_t size;
+    uint32_t order;
+  };
+
+  std::vector<uint64_t> addresses_;
+  std::vector<uint8_t> resolved_;
+  std::vector<PendingWrite> writes_;
+};
+
 class Sampler : public ExecutableObject {
 private:
   hsa_ext_sampler_t samp;
@@ -498,6 +543,9 @@ public:
     size_t total_num_segment_descriptors,
     size_t first_empty_segment_descriptor) override;
 
+  void GetKernelDispatchInfo(
+    uint32_t *num_kernels, hsa_amd_kernel_dispatch_info_t *kernels) override;
+
   uint64_t FindHostAddress(uint64_t device_address) override;
 
   void EnableReadOnlyMode();
@@ -533,9 +581,14 @@ private:
 
   hsa_status_t ApplyRelocations(hsa_agent_t agent, amd::hsa::code::AmdHsaCode *c);
   hsa_status_t ApplyStaticRelocationSection(hsa_agent_t agent, amd::hsa::code::RelocationSection* sec);
-  hsa_status_t ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel);
+  hsa_status_t ApplyStaticRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel,
+                                     Segment *rseg, RelocationBatch &batch);
   hsa_status_t ApplyDynamicRelocationSection(hsa_agent_t agent, amd::hsa::code::RelocationSection* sec);
-  hsa_status_t ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel);
+  hsa_status_t ApplyDynamicRelocation(hsa_agent_t agent, amd::hsa::code::Relocation *rel,
+                                      RelocationBatch &batch);
+
+  // Sorts the segments of the code object being loaded by virtual address.
+  void BuildSegmentIndex();
 
   Segment* VirtualAddressSegment(uint64_t vaddr);
   uint64_t SymbolAddress(hsa_agent_t agent, amd::hsa::code::Symbol* sym);
@@ -556,6 +609,10 @@ private:
   std::vector<ExecutableObject*> objects;
   Segment *program_allocation_segment;
   std::vector<LoadedCodeObjectImpl*> loaded_code_objects;
+  // Dispatch parameters of every kernel symbol, in load order.
+  std::vector<hsa_amd_kernel_dispatch_info_t> kernel_table_;
+  // Segments of loaded_code_objects.back() ordered by VAddr.
+  std::vector<Segment*> segment_index_;
 };
 
 class AmdHsaCodeLoader : public Loader {